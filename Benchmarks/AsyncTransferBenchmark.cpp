@@ -0,0 +1,191 @@
+// File Name: AsyncTransferBenchmark.cpp
+// Date: 2026-10
+// File Description:
+//      -- Concurrent transfers on one thread. Starts --transfers pairs of AsyncConnections over loopback, each with
+//      -- a sender coroutine (AsyncSession::SendFile) and a receiver coroutine (AsyncSession::ReceiveFile), and runs
+//      -- them all on one EventLoop. Reports how long the whole set took, the CPU time it cost, and how many files
+//      -- arrived intact, as one JSON line.
+//      -- Usage: AsyncTransferBenchmark [--transfers 100] [--size 16384] [--rate 30] [--port 33000] [--out <build dir>/async_results.jsonl|-]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AsyncTransfer.h"
+#include "BenchmarkData.h"
+#include "Log.h"
+
+using namespace std;
+using namespace net;
+
+
+const unsigned int ProtocolId = 0x11223344;
+const float TimeOut = 10.0f;
+const char* OutputDirectory = "rudp_async_received";
+
+
+// Both ends of one transfer
+struct TransferPair
+{
+    TransferPair(EventLoop& loop, const AsyncTransferOptions& options)
+        : sender(loop, ProtocolId, TimeOut), receiver(loop, ProtocolId, TimeOut),
+          sending(sender, options), receiving(receiver, options)
+    {
+    }
+
+    AsyncConnection sender;
+    AsyncConnection receiver;
+    AsyncSession sending;
+    AsyncSession receiving;
+    string fileName;
+    int sent = 1;           // SendFile / ReceiveFile results (1: still running)
+    int received = 1;
+};
+
+
+// Function Name: Send / Receive
+// Function Description: Spawned per pair; record the session results
+static Task<> Send(TransferPair& pair)
+{
+    pair.sent = co_await pair.sending.SendFile(pair.fileName);
+}
+
+static Task<> Receive(TransferPair& pair)
+{
+    pair.received = co_await pair.receiving.ReceiveFile();
+}
+
+
+// Function Name: WriteTestFile
+// Function Description: size bytes of pseudo-random data; returns 0 or -1
+static int WriteTestFile(const string& fileName, int size, unsigned int seed)
+{
+    vector<char> data(size);
+    for (int i = 0; i < size; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = (char)(seed >> 16);
+    }
+    ofstream file(fileName, ios::binary | ios::trunc);
+    file.write(data.data(), data.size());
+    return file ? 0 : -1;
+}
+
+
+
+int main(int argc, char* argv[])
+{
+    int transfers = 100;
+    int size = 16384;
+    int port = 33000;
+    const char* outPath = BENCHMARK_OUTPUT_DIR "/async_results.jsonl";
+    AsyncTransferOptions options;
+    options.outputDirectory = OutputDirectory;
+
+    // one line per connection start and file would drown the result
+    LogSetLevel(LOG_LEVEL_WARN);
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* value = i + 1 < argc ? argv[i + 1] : "";
+
+        if (strcmp(argv[i], "--transfers") == 0) { transfers = atoi(value); i++; }
+        else if (strcmp(argv[i], "--size") == 0) { size = atoi(value); i++; }
+        else if (strcmp(argv[i], "--rate") == 0) { options.sendRate = (float)atof(value); i++; }
+        else if (strcmp(argv[i], "--port") == 0) { port = atoi(value); i++; }
+        else if (strcmp(argv[i], "--out") == 0) { outPath = value; i++; }
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (transfers <= 0 || size <= 0 || options.sendRate <= 0.0f || port <= 0 || port + 2 * transfers > 65535)
+    {
+        fprintf(stderr, "Need positive --transfers, --size and --rate, and 2 ports per transfer from --port on\n");
+        return 1;
+    }
+
+    if (!InitializeSockets())
+    {
+        fprintf(stderr, "Failed to initialize sockets\n");
+        return 1;
+    }
+
+    error_code error;
+    filesystem::create_directory(OutputDirectory, error);
+
+    EventLoop loop;
+    vector<unique_ptr<TransferPair>> pairs;
+    for (int i = 0; i < transfers; ++i)
+    {
+        pairs.emplace_back(new TransferPair(loop, options));
+        TransferPair& pair = *pairs.back();
+        pair.fileName = "rudp_async_" + to_string(port) + "_" + to_string(i) + ".bin";
+        if (WriteTestFile(pair.fileName, size, (unsigned int)i + 1) != 0)
+        {
+            fprintf(stderr, "Cannot write %s\n", pair.fileName.c_str());
+            return 1;
+        }
+
+        const int senderPort = port + 2 * i;
+        if (!pair.sender.Start(senderPort) || !pair.receiver.Start(senderPort + 1))
+        {
+            fprintf(stderr, "Cannot bind ports %d and %d (open file limit?)\n", senderPort, senderPort + 1);
+            return 1;
+        }
+        pair.receiver.Listen();
+        pair.sender.Connect(Address(127, 0, 0, 1, (unsigned short)(senderPort + 1)));
+        loop.Spawn(Receive(pair));
+        loop.Spawn(Send(pair));
+    }
+
+    const auto wallStart = chrono::steady_clock::now();
+    const clock_t cpuStart = clock();
+    loop.Run();
+    const double wallSec = chrono::duration<double>(chrono::steady_clock::now() - wallStart).count();
+    const double cpuSec = (double)(clock() - cpuStart) / CLOCKS_PER_SEC;
+
+    int verified = 0;
+    double slowest = 0.0;
+    for (unique_ptr<TransferPair>& pair : pairs)
+    {
+        if (pair->sent == 0 && pair->received == 0)
+            verified++;
+        slowest = max(slowest, pair->receiving.GetTransferSeconds());
+        remove(pair->fileName.c_str());
+        remove((string(OutputDirectory) + "/" + pair->fileName).c_str());
+    }
+    pairs.clear();
+    filesystem::remove(OutputDirectory, error);
+
+    FILE* out = stdout;
+    if (strcmp(outPath, "-") != 0)
+    {
+#pragma warning(suppress : 4996)
+        out = fopen(outPath, "w");
+        if (!out)
+        {
+            fprintf(stderr, "Cannot open %s\n", outPath);
+            return 1;
+        }
+    }
+    fprintf(out, "{\"benchmark\":\"async_transfer\",\"transfers\":%d,\"size\":%d,\"rate\":%.1f,\"verified\":%d,\"wall_sec\":%.3f,\"cpu_sec\":%.3f,\"slowest_sec\":%.3f}\n",
+        transfers, size, options.sendRate, verified, wallSec, cpuSec, slowest);
+    if (out != stdout)
+        fclose(out);
+
+    fprintf(stderr, "%d transfers of %d B at %.0f packets/s on one thread: %d verified, wall %.2f s, cpu %.2f s, slowest %.2f s\n",
+        transfers, size, options.sendRate, verified, wallSec, cpuSec, slowest);
+
+    ShutdownSockets();
+    return verified == transfers ? 0 : 1;
+}
@@ -0,0 +1,47 @@
+// File Name: BenchmarkData.h
+// Date: 2026-10
+// File Description:
+//      -- Deterministic input data and the default output directory shared by the benchmark targets.
+
+#ifndef _BENCHMARK_DATA_H_
+#define _BENCHMARK_DATA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Directory the benchmark drivers write their result records to by default. CMake sets it to the build directory,
+// so a run from the source tree does not leave its records there; without CMake it is the working directory.
+#ifndef BENCHMARK_OUTPUT_DIR
+#define BENCHMARK_OUTPUT_DIR "."
+#endif
+
+
+// Function Name: MakeBenchmarkData
+// Function Description:
+//      -- Data that compresses roughly like source code: words from a small vocabulary plus 1/16 random bytes.
+//      -- The same seed always gives the same bytes.
+inline std::vector<uint8_t> MakeBenchmarkData(size_t size, uint32_t seed)
+{
+    static const char* words[] = { "packet ", "block ", "sequence ", "return ", "if (", ") {\n", "}\n", "uint64_t ",
+        "connection", "->", "size", "0x", "// ", "\n    ", "= ", "; " };
+
+    std::vector<uint8_t> data(size);
+    uint32_t state = seed;
+    size_t pos = 0;
+    while (pos < size)
+    {
+        state = state * 1664525u + 1013904223u;
+        if ((state >> 28) == 0)
+        {
+            data[pos++] = static_cast<uint8_t>(state >> 16);
+            continue;
+        }
+        const char* word = words[(state >> 24) & 15];
+        for (size_t i = 0; word[i] != '\0' && pos < size; i++)
+            data[pos++] = static_cast<uint8_t>(word[i]);
+    }
+    return data;
+}
+
+#endif // !_BENCHMARK_DATA_H_
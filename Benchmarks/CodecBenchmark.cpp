@@ -0,0 +1,241 @@
+// File Name: CodecBenchmark.cpp
+// Date: 2026-10
+// File Description:
+//      -- Throughput of the per-file processing stages that run outside the network loop:
+//      -- MD5, LZ4 wire image encode/decode, FEC group encode/decode and delta encode/apply.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "BenchmarkData.h"
+#include "Compress.h"
+#include "Delta.h"
+#include "Fec.h"
+#include "Protocol.h"
+#include "md5.h"
+
+using namespace std;
+
+
+static void BM_Md5(benchmark::State& state)
+{
+    vector<uint8_t> data = MakeBenchmarkData(static_cast<size_t>(state.range(0)), 1);
+    for (auto _ : state)
+    {
+        MD5Context ctx;
+        md5Init(&ctx);
+        md5Update(&ctx, data.data(), data.size());
+        md5Finalize(&ctx);
+        benchmark::DoNotOptimize(ctx.digest);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Md5)->Arg(1 << 20);
+
+
+static void BM_CompressEncode(benchmark::State& state)
+{
+    vector<uint8_t> data = MakeBenchmarkData(static_cast<size_t>(state.range(0)), 2);
+    vector<uint8_t> wire;
+    for (auto _ : state)
+    {
+        EncodeWireImage(data, wire);
+        benchmark::DoNotOptimize(wire.data());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+    state.counters["ratio"] = static_cast<double>(wire.size()) / data.size();
+}
+BENCHMARK(BM_CompressEncode)->Arg(1 << 20);
+
+
+static void BM_CompressDecode(benchmark::State& state)
+{
+    vector<uint8_t> data = MakeBenchmarkData(static_cast<size_t>(state.range(0)), 3);
+    vector<uint8_t> wire;
+    EncodeWireImage(data, wire);
+
+    vector<uint8_t> out(data.size());
+    for (auto _ : state)
+    {
+        if (DecodeWireImage(wire, out) != 0)
+            state.SkipWithError("decode failed");
+        benchmark::DoNotOptimize(out.data());
+    }
+    if (out != data)
+        state.SkipWithError("decoded data differs from the source");
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CompressDecode)->Arg(1 << 20);
+
+
+// range(0) = scheme, range(1) = group size, range(2) = parity count
+static void BM_FecEncode(benchmark::State& state)
+{
+    const uint8_t scheme = static_cast<uint8_t>(state.range(0));
+    const int groupSize = static_cast<int>(state.range(1));
+    const int parityCount = static_cast<int>(state.range(2));
+
+    vector<uint8_t> data = MakeBenchmarkData(static_cast<size_t>(groupSize) * PAYLOAD_SIZE, 4);
+    vector<uint8_t> parity(static_cast<size_t>(parityCount) * PAYLOAD_SIZE);
+    vector<const uint8_t*> dataBlocks(groupSize);
+    vector<uint8_t*> parityBlocks(parityCount);
+    for (int i = 0; i < groupSize; i++)
+        dataBlocks[i] = data.data() + i * PAYLOAD_SIZE;
+    for (int j = 0; j < parityCount; j++)
+        parityBlocks[j] = parity.data() + j * PAYLOAD_SIZE;
+
+    for (auto _ : state)
+    {
+        FecEncodeGroup(scheme, dataBlocks.data(), groupSize, parityBlocks.data(), parityCount, PAYLOAD_SIZE);
+        benchmark::DoNotOptimize(parity.data());
+    }
+    state.SetBytesProcessed(state.iterations() * groupSize * PAYLOAD_SIZE);
+}
+BENCHMARK(BM_FecEncode)->Args({ FEC_XOR, 8, 1 })->Args({ FEC_REED_SOLOMON, 16, 2 })->Args({ FEC_REED_SOLOMON, 32, 4 });
+
+
+// Function Name: CheckFecRecovery
+// Function Description:
+//      -- Erases patterns random data and parity blocks of a Reed-Solomon group, never more than parityCount in
+//      -- all, and checks that every erased data block is rebuilt to the source bytes; returns the patterns that failed
+static int CheckFecRecovery(const vector<uint8_t>& source, int groupSize, int parityCount, int patterns)
+{
+    vector<uint8_t> data(source.size());
+    vector<uint8_t> parity(static_cast<size_t>(parityCount) * PAYLOAD_SIZE);
+    vector<uint8_t*> dataBlocks(groupSize);
+    vector<uint8_t*> parityBlocks(parityCount);
+    for (int i = 0; i < groupSize; i++)
+        dataBlocks[i] = data.data() + i * PAYLOAD_SIZE;
+    for (int j = 0; j < parityCount; j++)
+        parityBlocks[j] = parity.data() + j * PAYLOAD_SIZE;
+
+    int failed = 0;
+    uint32_t random = 7;
+    for (int pattern = 0; pattern < patterns; pattern++)
+    {
+        data = source;
+        FecEncodeGroup(FEC_REED_SOLOMON, dataBlocks.data(), groupSize, parityBlocks.data(), parityCount, PAYLOAD_SIZE);
+
+        bool present[FEC_MAX_GROUP_SIZE + FEC_MAX_PARITY_COUNT];
+        for (int k = 0; k < groupSize + parityCount; k++)
+            present[k] = true;
+        const int erasures = 1 + pattern % parityCount;
+        for (int e = 0; e < erasures; )
+        {
+            random = random * 1664525u + 1013904223u;
+            const int k = (int)((random >> 8) % (uint32_t)(groupSize + parityCount));
+            if (!present[k])
+                continue;
+            present[k] = false;
+            memset(k < groupSize ? dataBlocks[k] : parityBlocks[k - groupSize], 0, PAYLOAD_SIZE);
+            e++;
+        }
+
+        if (!FecDecodeGroup(FEC_REED_SOLOMON, dataBlocks.data(), present, groupSize, parityBlocks.data(), present + groupSize, parityCount, PAYLOAD_SIZE) || data != source)
+            failed++;
+    }
+    return failed;
+}
+
+
+// Rebuilds parityCount lost data blocks of a Reed-Solomon group
+static void BM_FecDecode(benchmark::State& state)
+{
+    const int groupSize = static_cast<int>(state.range(0));
+    const int parityCount = static_cast<int>(state.range(1));
+
+    const vector<uint8_t> source = MakeBenchmarkData(static_cast<size_t>(groupSize) * PAYLOAD_SIZE, 5);
+    vector<uint8_t> data = source;
+    vector<uint8_t> parity(static_cast<size_t>(parityCount) * PAYLOAD_SIZE);
+    vector<uint8_t*> dataBlocks(groupSize);
+    vector<uint8_t*> parityBlocks(parityCount);
+    for (int i = 0; i < groupSize; i++)
+        dataBlocks[i] = data.data() + i * PAYLOAD_SIZE;
+    for (int j = 0; j < parityCount; j++)
+        parityBlocks[j] = parity.data() + j * PAYLOAD_SIZE;
+    FecEncodeGroup(FEC_REED_SOLOMON, dataBlocks.data(), groupSize, parityBlocks.data(), parityCount, PAYLOAD_SIZE);
+
+    bool dataPresent[FEC_MAX_GROUP_SIZE];
+    bool parityPresent[FEC_MAX_PARITY_COUNT];
+    for (int i = 0; i < groupSize; i++)
+        dataPresent[i] = i >= parityCount;
+    for (int j = 0; j < parityCount; j++)
+        parityPresent[j] = true;
+
+    // the lost blocks are zeroed before every decode, so each iteration has to rebuild them
+    for (auto _ : state)
+    {
+        for (int i = 0; i < parityCount; i++)
+            memset(dataBlocks[i], 0, PAYLOAD_SIZE);
+        if (!FecDecodeGroup(FEC_REED_SOLOMON, dataBlocks.data(), dataPresent, groupSize, parityBlocks.data(), parityPresent, parityCount, PAYLOAD_SIZE))
+            state.SkipWithError("decode failed");
+        benchmark::DoNotOptimize(data.data());
+    }
+    if (data != source)
+        state.SkipWithError("rebuilt blocks differ from the source");
+    else if (CheckFecRecovery(source, groupSize, parityCount, 600) != 0)
+        state.SkipWithError("a random erasure pattern was not recovered");
+    state.SetBytesProcessed(state.iterations() * parityCount * PAYLOAD_SIZE);
+}
+BENCHMARK(BM_FecDecode)->Args({ 16, 2 })->Args({ 32, 4 });
+
+
+// The new file is the base with a few scattered edits and an insertion
+static void MakeDeltaPair(size_t size, vector<uint8_t>& base, vector<uint8_t>& file)
+{
+    base = MakeBenchmarkData(size, 6);
+    file = base;
+    for (size_t at = 4096; at + 16 < file.size(); at += size / 8)
+        memset(file.data() + at, 'x', 16);
+    file.insert(file.begin() + file.size() / 2, 300, 'y');
+}
+
+static void BM_DeltaEncode(benchmark::State& state)
+{
+    vector<uint8_t> base, file;
+    MakeDeltaPair(static_cast<size_t>(state.range(0)), base, file);
+
+    vector<BlockSignature> signatures;
+    ComputeSignatures(base, signatures);
+    vector<uint8_t> known(signatures.size(), 1);
+
+    vector<uint8_t> delta;
+    for (auto _ : state)
+    {
+        EncodeDelta(file, signatures, known, delta);
+        benchmark::DoNotOptimize(delta.data());
+    }
+    state.SetBytesProcessed(state.iterations() * file.size());
+    state.counters["deltaBytes"] = static_cast<double>(delta.size());
+}
+BENCHMARK(BM_DeltaEncode)->Arg(1 << 20);
+
+static void BM_DeltaApply(benchmark::State& state)
+{
+    vector<uint8_t> base, file;
+    MakeDeltaPair(static_cast<size_t>(state.range(0)), base, file);
+
+    vector<BlockSignature> signatures;
+    ComputeSignatures(base, signatures);
+    vector<uint8_t> known(signatures.size(), 1);
+    vector<uint8_t> delta;
+    EncodeDelta(file, signatures, known, delta);
+
+    vector<uint8_t> out(file.size());
+    for (auto _ : state)
+    {
+        if (ApplyDelta(base, delta, out) != 0)
+            state.SkipWithError("apply failed");
+        benchmark::DoNotOptimize(out.data());
+    }
+    if (out != file)
+        state.SkipWithError("rebuilt file differs from the new file");
+    state.SetBytesProcessed(state.iterations() * file.size());
+}
+BENCHMARK(BM_DeltaApply)->Arg(1 << 20);
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,320 @@
+// File Name: LoopbackTransfer.cpp
+// Date: 2026-10
+// File Description:
+//      -- In-process loopback transfer used by TransferDriver and TransferBenchmark: a sender and a receiver
+//      -- TransferSession on simulated time over emulated links, and the machine-readable result writers.
+
+#include "LoopbackTransfer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "BenchmarkData.h"
+#include "TransferSession.h"
+
+using namespace std;
+using namespace net;
+
+
+
+// Function Name: MakeLinkConditions
+// Function Description: Translates the scenario into the emulator settings of one direction
+static LinkConditions MakeLinkConditions(const TransferScenario& scenario, unsigned int seed)
+{
+    LinkConditions conditions;
+    conditions.loss = (float)(scenario.lossPercent / 100.0);
+    conditions.burstEnter = (float)(scenario.burstEnterPercent / 100.0);
+    conditions.burstExit = (float)(scenario.burstExitPercent / 100.0);
+    conditions.burstLoss = (float)(scenario.burstLossPercent / 100.0);
+    conditions.latency = (float)(scenario.latencyMs / 1000.0);
+    conditions.jitter = (float)(scenario.jitterMs / 1000.0);
+    conditions.reorder = (float)(scenario.reorderPercent / 100.0);
+    conditions.reorderDelay = (float)(scenario.reorderDelayMs / 1000.0);
+    conditions.duplicate = (float)(scenario.duplicatePercent / 100.0);
+    conditions.bandwidth = (float)(scenario.bandwidthKbps * 1000.0 / 8.0);
+    conditions.queueLimit = scenario.queueLimitBytes;
+    conditions.seed = seed;
+    return conditions;
+}
+
+
+// Function Name: SavedFileMatches
+// Function Description: True if the file at path holds exactly data
+static bool SavedFileMatches(const string& path, const vector<uint8_t>& data)
+{
+    ifstream file(path, ios::binary);
+    if (!file)
+        return false;
+    const vector<uint8_t> saved((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    return saved == data;
+}
+
+
+
+// Function Name: RunLoopbackTransfer
+// Parameters:
+//   - const TransferScenario& scenario: what to transfer and how to impair the link
+//   - LoopbackResult& result: measurements of the run
+// Return Value: int - 0 if the scenario ran, -1 if a data file or a session could not be set up
+// Function Description:
+//      -- Each transfer is one Send of the sender session. Between two frames the session's frame wait advances the
+//      -- simulated clock by one frame and runs a frame of the other session, so both ends take turns on this thread
+//      -- and nothing sleeps. Once Send is out, the receiver's Receive finishes the transfer. A file counts as
+//      -- verified when the receiver's completion callback reports it saved with a matching MD5, on a stream of
+//      -- the transfer's own group, the sender reported it too, and the saved bytes are the ones generated.
+int RunLoopbackTransfer(const TransferScenario& scenario, LoopbackResult& result)
+{
+    result = LoopbackResult();
+    const int transfers = max(scenario.transfers, 1);
+
+    // the files to send, one per transfer, and where the receiver saves them
+    const string prefix = "rudp_bench_" + to_string(scenario.basePort);
+    const string outputDirectory = prefix + "_received";
+    vector<string> fileNames;
+    vector<vector<uint8_t>> contents;
+    for (int k = 0; k < transfers; k++)
+    {
+        fileNames.push_back(prefix + "_" + to_string(k) + ".bin");
+        contents.push_back(MakeBenchmarkData(static_cast<size_t>(scenario.fileSize), scenario.seed + k));
+        ofstream file(fileNames.back(), ios::binary | ios::trunc);
+        file.write(reinterpret_cast<const char*>(contents.back().data()), contents.back().size());
+        if (!file)
+        {
+            fprintf(stderr, "Cannot write benchmark file %s\n", fileNames.back().c_str());
+            return -1;
+        }
+    }
+    error_code error;
+    filesystem::create_directories(outputDirectory, error);
+
+    const auto wallStart = chrono::steady_clock::now();
+    const clock_t cpuStart = clock();
+
+    int status = 0;
+    {
+        TransferOptions options;
+        options.clientPort = scenario.basePort;
+        options.serverPort = scenario.basePort + 1;
+        options.compress = scenario.compress;
+        options.fecScheme = scenario.fecScheme;
+        options.fecGroupSize = scenario.fecGroupSize;
+        options.fecParityCount = scenario.fecParityCount;
+        options.sendRate = (float)scenario.sendRate;
+        options.outputDirectory = outputDirectory;
+
+        // both ends run on simulated time, so a run does not depend on how fast this machine is
+        ManualClock simulated;
+        TransferSession sender(TransferSender, options);
+        TransferSession receiver(TransferReceiver, options);
+        sender.SetClock(simulated);
+        receiver.SetClock(simulated);
+
+        if (receiver.Start() != 0 || sender.Start(Address(127, 0, 0, 1, 0)) != 0)
+        {
+            fprintf(stderr, "Cannot open the loopback ports %d and %d\n", scenario.basePort, scenario.basePort + 1);
+            status = -1;
+        }
+        else
+        {
+            // each direction gets its own random sequence
+            sender.GetConnection().SetLinkConditions(MakeLinkConditions(scenario, scenario.seed * 2u + 1u));
+            receiver.GetConnection().SetLinkConditions(MakeLinkConditions(scenario, scenario.seed * 2u + 2u));
+        }
+
+        vector<TransferResult> sent;
+        vector<TransferResult> received;
+        vector<uint64_t> receivedAt;
+        sender.SetCompletionCallback([&sent](const TransferResult& file) { sent.push_back(file); });
+        receiver.SetCompletionCallback([&](const TransferResult& file) {
+            received.push_back(file);
+            receivedAt.push_back(simulated.Now());
+        });
+
+        const uint64_t frameNs = SecondsToNs(scenario.frameMs / 1000.0);
+        const uint64_t timeLimitNs = SecondsToNs(scenario.timeLimitSec);
+        uint64_t transferStart = 0;
+        uint64_t receiveDeadline = 0;
+        sender.SetFrameWait([&]() {
+            simulated.Advance(frameNs);
+            receiver.Poll();
+            if (simulated.Now() - transferStart >= timeLimitNs)
+                sender.Cancel();
+        });
+        receiver.SetFrameWait([&]() {
+            simulated.Advance(frameNs);
+            sender.Poll();
+            if (simulated.Now() >= receiveDeadline)
+                receiver.Cancel(); // the receiver has no way to ask for missing blocks
+        });
+
+        const shared_ptr<ConnectionMetrics> senderMetrics = status == 0 ? sender.GetConnection().GetMetrics() : nullptr;
+        bool verified = status == 0;
+        for (int k = 0; k < transfers && status == 0; k++)
+        {
+            // a pause between two transfers, where only Poll keeps the connections alive
+            for (uint64_t idle = 0; k > 0 && idle < SecondsToNs(scenario.idleSec); idle += frameNs)
+            {
+                simulated.Advance(frameNs);
+                sender.Poll();
+                receiver.Poll();
+            }
+
+            transferStart = simulated.Now();
+            const size_t sentBefore = sent.size();
+            const size_t receivedBefore = received.size();
+            const uint64_t packetsBefore = senderMetrics->packetsSent.Get();
+            const uint64_t retransmitsBefore = senderMetrics->retransmits.Get();
+
+            const int sendStatus = sender.Send({ fileNames[k] });
+            result.packetsSent += senderMetrics->packetsSent.Get() - packetsBefore;
+            result.packetsRetransmitted += senderMetrics->retransmits.Get() - retransmitsBefore;
+
+            receiveDeadline = min(simulated.Now() + SecondsToNs(scenario.drainSec), transferStart + timeLimitNs);
+            const int receiveStatus = sendStatus == 0 ? receiver.Receive() : -1;
+
+            // an unfinished receive leaves its streams behind, so the next transfer is not run
+            if (received.size() != receivedBefore + 1)
+                break;
+            const TransferResult& file = received.back();
+            const double seconds = NsToSeconds(receivedAt.back() - transferStart);
+            if (k == 0)
+                result.timeToFirstByteSec = max(0.0, seconds - file.seconds);
+            result.timeToCompleteSec += seconds;
+            result.blocksRecovered += file.blocksRecovered;
+
+            verified = verified && receiveStatus == 0 && file.status == 0 && file.fileName == fileNames[k]
+                && file.stream / MaxStreams == k % MaxTransferGroups && file.fileSize == scenario.fileSize
+                && sent.size() == sentBefore + 1 && sent.back().fileName == fileNames[k]
+                && SavedFileMatches(outputDirectory + "/" + fileNames[k], contents[k]);
+            result.transfersCompleted++;
+            if (receiveStatus != 0)
+                break;
+        }
+        result.completed = status == 0 && result.transfersCompleted == transfers;
+        result.verified = result.completed && verified;
+        if (!result.completed)
+            result.timeToCompleteSec = NsToSeconds(simulated.Now());
+
+        if (status == 0)
+        {
+            ReliabilitySystem& reliability = sender.GetConnection().GetReliabilitySystem();
+            result.rttMs = reliability.GetRoundTripTime() * 1000.0;
+            result.packetsLostReported = reliability.GetLostPackets();
+            result.acksSent = receiver.GetConnection().GetMetrics()->acksSent.Get();
+            const LinkStats& forward = sender.GetConnection().GetLinkEmulator().GetStats();
+            const LinkStats& backward = receiver.GetConnection().GetLinkEmulator().GetStats();
+            result.packetsLostByLink = forward.lost + forward.queueDrops + backward.lost + backward.queueDrops;
+        }
+    }
+
+    result.wallSec = chrono::duration<double>(chrono::steady_clock::now() - wallStart).count();
+    result.cpuSec = (double)(clock() - cpuStart) / CLOCKS_PER_SEC;
+
+    const double bytes = (double)scenario.fileSize * transfers;
+    if (result.verified && result.timeToCompleteSec > 0.0)
+        result.goodputMbps = bytes * 8.0 / (result.timeToCompleteSec * 1e6);
+    if (bytes > 0.0)
+        result.cpuSecPerGB = result.cpuSec / (bytes / 1e9);
+    if (result.packetsSent > 0)
+        result.retransmitRatio = (double)result.packetsRetransmitted / result.packetsSent;
+
+    for (const string& fileName : fileNames)
+        remove(fileName.c_str());
+    filesystem::remove_all(outputDirectory, error);
+    return status;
+}
+
+
+
+// Function Name: DescribeScenario
+std::string DescribeScenario(const TransferScenario& scenario)
+{
+    char name[160];
+    const char* fec = scenario.fecScheme == FEC_XOR ? "xor" : scenario.fecScheme == FEC_REED_SOLOMON ? "rs" : "none";
+    snprintf(name, sizeof(name), "size=%llu/loss=%g/latency=%g/reorder=%g/fec=%s:%d:%d/compress=%d/rate=%g",
+        (unsigned long long)scenario.fileSize, scenario.lossPercent, scenario.latencyMs, scenario.reorderPercent,
+        fec, scenario.fecGroupSize, scenario.fecParityCount, scenario.compress ? 1 : 0, scenario.sendRate);
+    string description = name;
+
+    // the less common impairments only appear in the key when they are used
+    if (scenario.burstEnterPercent > 0.0)
+    {
+        snprintf(name, sizeof(name), "/burst=%g:%g:%g", scenario.burstEnterPercent, scenario.burstExitPercent, scenario.burstLossPercent);
+        description += name;
+    }
+    if (scenario.jitterMs > 0.0)
+    {
+        snprintf(name, sizeof(name), "/jitter=%g", scenario.jitterMs);
+        description += name;
+    }
+    if (scenario.duplicatePercent > 0.0)
+    {
+        snprintf(name, sizeof(name), "/duplicate=%g", scenario.duplicatePercent);
+        description += name;
+    }
+    if (scenario.bandwidthKbps > 0.0)
+    {
+        snprintf(name, sizeof(name), "/bandwidth=%g:%d", scenario.bandwidthKbps, scenario.queueLimitBytes);
+        description += name;
+    }
+    if (scenario.transfers > 1)
+    {
+        snprintf(name, sizeof(name), "/transfers=%d", scenario.transfers);
+        description += name;
+    }
+    return description;
+}
+
+
+
+// Function Name: WriteResultJson
+// Function Description: Writes one JSON object on a single line (JSON Lines)
+void WriteResultJson(FILE* out, const TransferScenario& scenario, const LoopbackResult& result)
+{
+    fprintf(out,
+        "{\"scenario\":\"%s\",\"fileSize\":%llu,\"packetSize\":%d,\"payloadSize\":%d,"
+        "\"lossPercent\":%g,\"latencyMs\":%g,\"reorderPercent\":%g,\"sendRate\":%g,"
+        "\"fecScheme\":%d,\"fecGroupSize\":%d,\"fecParityCount\":%d,\"compress\":%s,\"seed\":%u,"
+        "\"completed\":%s,\"verified\":%s,\"timeToFirstByteSec\":%.6f,\"timeToCompleteSec\":%.6f,\"goodputMbps\":%.6f,"
+        "\"wallSec\":%.6f,\"cpuSec\":%.6f,\"cpuSecPerGB\":%.3f,\"rttMs\":%.3f,"
+        "\"packetsSent\":%llu,\"packetsRetransmitted\":%llu,\"retransmitRatio\":%.6f,\"acksSent\":%llu,"
+        "\"packetsLostByLink\":%llu,\"packetsLostReported\":%llu,\"blocksRecovered\":%llu,\"transfers\":%d,\"transfersCompleted\":%d}\n",
+        DescribeScenario(scenario).c_str(), (unsigned long long)scenario.fileSize, (int)PACKET_SIZE, (int)PAYLOAD_SIZE,
+        scenario.lossPercent, scenario.latencyMs, scenario.reorderPercent, scenario.sendRate,
+        scenario.fecScheme, scenario.fecGroupSize, scenario.fecParityCount, scenario.compress ? "true" : "false", scenario.seed,
+        result.completed ? "true" : "false", result.verified ? "true" : "false", result.timeToFirstByteSec, result.timeToCompleteSec, result.goodputMbps,
+        result.wallSec, result.cpuSec, result.cpuSecPerGB, result.rttMs,
+        (unsigned long long)result.packetsSent, (unsigned long long)result.packetsRetransmitted, result.retransmitRatio, (unsigned long long)result.acksSent,
+        (unsigned long long)result.packetsLostByLink, (unsigned long long)result.packetsLostReported,
+        (unsigned long long)result.blocksRecovered, max(scenario.transfers, 1), result.transfersCompleted);
+}
+
+
+// Function Name: WriteResultCsvHeader
+void WriteResultCsvHeader(FILE* out)
+{
+    fprintf(out, "scenario,fileSize,packetSize,lossPercent,latencyMs,reorderPercent,sendRate,fecScheme,fecGroupSize,fecParityCount,"
+        "compress,seed,completed,verified,timeToFirstByteSec,timeToCompleteSec,goodputMbps,wallSec,cpuSec,cpuSecPerGB,rttMs,"
+        "packetsSent,packetsRetransmitted,retransmitRatio,acksSent,packetsLostByLink,packetsLostReported,blocksRecovered,transfers,transfersCompleted\n");
+}
+
+
+// Function Name: WriteResultCsv
+void WriteResultCsv(FILE* out, const TransferScenario& scenario, const LoopbackResult& result)
+{
+    fprintf(out, "%s,%llu,%d,%g,%g,%g,%g,%d,%d,%d,%d,%u,%d,%d,%.6f,%.6f,%.6f,%.6f,%.6f,%.3f,%.3f,%llu,%llu,%.6f,%llu,%llu,%llu,%llu,%d,%d\n",
+        DescribeScenario(scenario).c_str(), (unsigned long long)scenario.fileSize, (int)PACKET_SIZE,
+        scenario.lossPercent, scenario.latencyMs, scenario.reorderPercent, scenario.sendRate,
+        scenario.fecScheme, scenario.fecGroupSize, scenario.fecParityCount, scenario.compress ? 1 : 0, scenario.seed,
+        result.completed ? 1 : 0, result.verified ? 1 : 0, result.timeToFirstByteSec, result.timeToCompleteSec, result.goodputMbps,
+        result.wallSec, result.cpuSec, result.cpuSecPerGB, result.rttMs,
+        (unsigned long long)result.packetsSent, (unsigned long long)result.packetsRetransmitted, result.retransmitRatio, (unsigned long long)result.acksSent,
+        (unsigned long long)result.packetsLostByLink, (unsigned long long)result.packetsLostReported,
+        (unsigned long long)result.blocksRecovered, max(scenario.transfers, 1), result.transfersCompleted);
+}
@@ -0,0 +1,88 @@
+// File Name: LoopbackTransfer.h
+// Date: 2026-10
+// File Description:
+//      -- Runs complete file transfers between a sender and a receiver TransferSession inside the current process
+//      -- over loopback, so the benchmark measures the session the tool runs: its frame loop, streams, ack
+//      -- frequency, callbacks and saved files. Both connections send through net::LinkEmulator, which injects
+//      -- loss (random or Gilbert-Elliott bursts), latency, jitter, reordering, duplication and a bandwidth cap.
+//      -- Time is simulated: the sessions share a net::ManualClock that advances by one frame between two frames
+//      -- and nothing sleeps, so the wall clock and CPU time measure the cost of the code, and the simulated clock
+//      -- measures the behaviour of the protocol. Several transfers of a scenario run back to back over the same
+//      -- pair of sessions.
+
+#ifndef _LOOPBACK_TRANSFER_H_
+#define _LOOPBACK_TRANSFER_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+
+// One point of the benchmark matrix
+struct TransferScenario
+{
+    uint64_t  fileSize = 64 * 1024;      // bytes of generated file data
+    double    lossPercent = 0.0;         // independent loss per datagram, each direction
+    double    burstEnterPercent = 0.0;   // Gilbert-Elliott burst loss: chance per datagram of a burst starting
+    double    burstExitPercent = 25.0;   // chance per datagram of the burst ending
+    double    burstLossPercent = 100.0;  // loss inside a burst
+    double    latencyMs = 0.0;           // one-way delay
+    double    jitterMs = 0.0;            // extra uniform delay per datagram
+    double    reorderPercent = 0.0;      // datagrams held back by reorderDelayMs so later ones overtake them
+    double    reorderDelayMs = 5.0;
+    double    duplicatePercent = 0.0;
+    double    bandwidthKbps = 0.0;       // link capacity each direction, 0 = unlimited
+    int       queueLimitBytes = 0;       // bytes waiting for the bandwidth cap before tail drop, 0 = unlimited
+    double    sendRate = 2000.0;         // packets per second sent by each end (TransferOptions::sendRate)
+    double    frameMs = 1.0;             // simulated time between two frames of the sessions
+    double    timeLimitSec = 120.0;      // simulated time after which a transfer counts as failed
+    double    drainSec = 2.0;            // how long the receiver may still finish after the sender's last packet
+    int       transfers = 1;             // files sent one after another over the same pair of sessions
+    double    idleSec = 0.5;             // pause between two transfers, where the sessions only Poll
+    uint8_t   fecScheme = 0;             // FEC_NONE / FEC_XOR / FEC_REED_SOLOMON
+    uint8_t   fecGroupSize = 0;
+    uint8_t   fecParityCount = 0;
+    bool      compress = false;
+    uint32_t  seed = 1;                  // data and impairment are fully determined by the seed (transfer k sends data seed + k)
+    int       basePort = 31000;          // sender binds basePort, receiver basePort + 1
+};
+
+
+// Measurements of one run
+struct LoopbackResult
+{
+    bool      completed = false;         // receiver saw every transfer end within timeLimitSec / drainSec
+    bool      verified = false;          // and saved every file with a matching MD5, as both completion callbacks reported
+    int       transfersCompleted = 0;
+    double    timeToFirstByteSec = -1.0; // simulated time from the first Send to the receiver's first packet of the file (-1: none)
+    double    timeToCompleteSec = 0.0;   // simulated time from each Send to the file being saved, summed over the transfers
+    double    goodputMbps = 0.0;         // file bytes per simulated second
+    double    wallSec = 0.0;             // real time of the whole run (load, transfer, verify)
+    double    cpuSec = 0.0;              // process CPU time of the whole run
+    double    cpuSecPerGB = 0.0;
+    double    rttMs = 0.0;               // sender's smoothed RTT at the end
+    uint64_t  packetsSent = 0;           // datagrams sent by the sender during its Sends, heartbeats included
+    uint64_t  acksSent = 0;              // ack-only datagrams sent by the receiver
+    uint64_t  packetsRetransmitted = 0;  // sender datagrams that repeated an earlier block/parity/meta packet (retransmits metric)
+    double    retransmitRatio = 0.0;     // packetsRetransmitted / packetsSent
+    uint64_t  packetsLostByLink = 0;     // datagrams dropped by the emulated link, both directions
+    uint64_t  packetsLostReported = 0;   // sender datagrams the ReliabilitySystem counted as lost
+    uint64_t  blocksRecovered = 0;       // blocks the receiver rebuilt from FEC parity
+};
+
+
+// Function Name: RunLoopbackTransfer
+// Function Description: Runs the scenario once; returns 0 if it could be run (even if the transfer failed), -1 on a setup error
+int RunLoopbackTransfer(const TransferScenario& scenario, LoopbackResult& result);
+
+// Function Name: DescribeScenario
+// Function Description: Short stable name of a scenario, used as the key for regression tracking
+std::string DescribeScenario(const TransferScenario& scenario);
+
+// Function Name: WriteResultJson / WriteResultCsv
+// Function Description: One line per run; WriteResultCsvHeader writes the matching column names
+void WriteResultJson(FILE* out, const TransferScenario& scenario, const LoopbackResult& result);
+void WriteResultCsvHeader(FILE* out);
+void WriteResultCsv(FILE* out, const TransferScenario& scenario, const LoopbackResult& result);
+
+#endif // !_LOOPBACK_TRANSFER_H_
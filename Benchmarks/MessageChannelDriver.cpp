@@ -0,0 +1,323 @@
+// File Name: MessageChannelDriver.cpp
+// Date: 2026-10
+// File Description:
+//      -- Loopback check of the message channels. A MessageConnection on each of two ReliableConnections, on
+//      -- simulated time over emulated links, sends --count messages on a reliable-ordered, a reliable-unordered
+//      -- and an unreliable-sequenced channel, and the driver checks what the other end delivers:
+//      --   reliable-ordered: every message exactly once, in the order sent
+//      --   reliable-unordered: every message exactly once
+//      --   unreliable-sequenced: never a message older than one already delivered
+//      -- It runs three links: a clean one, where nothing may be resent; one that only loses messages on the way
+//      -- out, where messages are resent but none that had arrived (the receiver sees no duplicates); and one
+//      -- with loss and reordering both ways. Exits with 1 if any check fails.
+//      -- Usage: MessageChannelDriver [--count 2000] [--loss 5] [--reorder 10] [--latency 20] [--seed 1] [--port 37000]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Log.h"
+#include "MessageChannel.h"
+
+using namespace std;
+using namespace net;
+
+
+const unsigned int ProtocolId = 0x11223344;
+const float TimeOut = 10.0f;
+const double FrameSec = 0.001;          // simulated time of one loop iteration
+const double TimeLimitSec = 120.0;      // simulated time a run may take
+const double DrainSec = 1.0;            // time given to the last unreliable messages once the reliable ones are done
+const int MessagesPerFrame = 4;         // messages queued per channel and frame while there are any left
+const int ChannelCount = 3;             // ordered, unordered, sequenced, added in this order on both ends
+
+
+// The links of one run; the percentages and the latency are those of the options
+struct MessageLink
+{
+    const char* name;
+    double forwardLossPercent;
+    double backwardLossPercent;
+    double reorderPercent;
+    bool resends;                       // messages must be resent (something is lost)
+    bool duplicates;                    // the receiver may see duplicates (lost acks, reordering)
+};
+
+
+// What a run delivered
+struct MessageRun
+{
+    bool completed = false;
+    bool corrupted = false;             // a message arrived with other bytes than were sent
+    double seconds = 0.0;
+    vector<int> delivered[ChannelCount];    // message numbers in the order Receive handed them out
+    MessageStats sender;
+    MessageStats receiver;
+    unsigned int lostByLink = 0;
+};
+
+
+// Function Name: MakeLink
+// Function Description: Emulator settings of one direction
+static LinkConditions MakeLink(double lossPercent, double reorderPercent, double latencyMs, unsigned int seed)
+{
+    LinkConditions conditions;
+    conditions.loss = (float)(lossPercent / 100.0);
+    conditions.reorder = (float)(reorderPercent / 100.0);
+    conditions.latency = (float)(latencyMs / 1000.0);
+    conditions.seed = seed;
+    return conditions;
+}
+
+
+// Function Name: MakeMessage
+// Function Description:
+//      -- Message number of channel: the number, then number % 29 bytes derived from both, so the bundles mix
+//      -- message sizes and a message that arrives with the bytes of another is noticed. Returns its size.
+static int MakeMessage(int channel, int number, unsigned char* message)
+{
+    memcpy(message, &number, sizeof(number));
+    const int size = (int)sizeof(number) + number % 29;
+    for (int i = (int)sizeof(number); i < size; i++)
+        message[i] = (unsigned char)(number * 7 + channel * 13 + i);
+    return size;
+}
+
+
+// Function Name: RunMessages
+// Parameters:
+//   - const MessageLink& link, double latencyMs, unsigned int seed: the emulated links
+//   - int count: messages per channel
+//   - unsigned short port: the sender binds port, the receiver port + 1
+//   - MessageRun& run: what was delivered
+// Return Value: int - 0 if the run took place, -1 if a socket could not be opened
+static int RunMessages(const MessageLink& link, double latencyMs, unsigned int seed, int count, unsigned short port, MessageRun& run)
+{
+    ReliableConnection client(ProtocolId, TimeOut);
+    ReliableConnection server(ProtocolId, TimeOut);
+    if (!server.Start(port + 1) || !client.Start(port))
+    {
+        fprintf(stderr, "Cannot open the loopback ports %d and %d\n", port, port + 1);
+        return -1;
+    }
+    server.Listen();
+    client.Connect(Address(127, 0, 0, 1, port + 1));
+
+    // each direction gets its own random sequence; both ends run on simulated time
+    client.SetLinkConditions(MakeLink(link.forwardLossPercent, link.reorderPercent, latencyMs, seed * 2u + 1u));
+    server.SetLinkConditions(MakeLink(link.backwardLossPercent, link.reorderPercent, latencyMs, seed * 2u + 2u));
+    ManualClock simulated;
+    client.SetClock(simulated);
+    server.SetClock(simulated);
+
+    MessageConnection sender(client);
+    MessageConnection receiver(server);
+    const MessageChannelType types[ChannelCount] = { ChannelReliableOrdered, ChannelReliableUnordered, ChannelUnreliableSequenced };
+    for (int c = 0; c < ChannelCount; c++)
+    {
+        sender.AddChannel(types[c]);
+        receiver.AddChannel(types[c]);
+    }
+
+    int queued[ChannelCount] = { 0 };
+    double now = 0.0;
+    double reliableDoneAt = -1.0;
+    while (now < TimeLimitSec)
+    {
+        // a reliable channel whose window is full takes the rest on a later frame
+        for (int c = 0; c < ChannelCount; c++)
+        {
+            for (int k = 0; k < MessagesPerFrame && queued[c] < count; k++)
+            {
+                unsigned char message[MaxMessageSize];
+                const int size = MakeMessage(c, queued[c], message);
+                if (!sender.Send(c, message, size))
+                    break;
+                queued[c]++;
+            }
+        }
+
+        sender.ReceivePackets();
+        receiver.ReceivePackets();
+        sender.Update();
+        receiver.Update();
+
+        int channel = 0;
+        unsigned char message[MaxMessageSize];
+        int size;
+        while ((size = receiver.Receive(channel, message, sizeof(message))) > 0)
+        {
+            int number = -1;
+            if (size >= (int)sizeof(number))
+                memcpy(&number, message, sizeof(number));
+            unsigned char expected[MaxMessageSize];
+            if (channel < 0 || channel >= ChannelCount || number < 0 || number >= count
+                || MakeMessage(channel, number, expected) != size || memcmp(expected, message, size) != 0)
+            {
+                run.corrupted = true;
+                continue;
+            }
+            run.delivered[channel].push_back(number);
+        }
+
+        // done once both reliable channels are delivered and acked, plus a little time for the sequenced channel
+        const bool reliableDone = (int)run.delivered[0].size() >= count && (int)run.delivered[1].size() >= count
+            && sender.GetStats().messagesAcked >= 2ull * count;
+        if (reliableDone && reliableDoneAt < 0.0)
+            reliableDoneAt = now;
+        if (reliableDoneAt >= 0.0 && now - reliableDoneAt >= DrainSec)
+        {
+            run.completed = true;
+            break;
+        }
+
+        simulated.Advance(SecondsToNs(FrameSec));
+        client.Update();
+        server.Update();
+        now += FrameSec;
+    }
+
+    run.seconds = run.completed ? reliableDoneAt : now;
+    run.sender = sender.GetStats();
+    run.receiver = receiver.GetStats();
+    run.lostByLink = client.GetLinkEmulator().GetStats().lost + server.GetLinkEmulator().GetStats().lost;
+    return 0;
+}
+
+
+// Function Name: CheckRun
+// Function Description: Prints why the run breaks the channels' guarantees, one line each; returns true if it does not
+static bool CheckRun(const MessageLink& link, int count, const MessageRun& run)
+{
+    bool ok = true;
+    auto fail = [&ok, &link](const string& reason) {
+        fprintf(stderr, "%s: %s\n", link.name, reason.c_str());
+        ok = false;
+    };
+
+    if (!run.completed)
+        fail("the reliable messages were not all delivered and acked within " + to_string((int)TimeLimitSec) + " s");
+    if (run.corrupted)
+        fail("a message arrived with bytes that were not sent");
+
+    // reliable-ordered: 0, 1, 2, ... count - 1
+    const vector<int>& ordered = run.delivered[0];
+    for (size_t i = 0; i < ordered.size(); i++)
+    {
+        if (ordered[i] != (int)i)
+        {
+            fail("ordered channel delivered message " + to_string(ordered[i]) + " as number " + to_string(i));
+            break;
+        }
+    }
+    if (ordered.size() != (size_t)count)
+        fail("ordered channel delivered " + to_string(ordered.size()) + " of " + to_string(count) + " messages");
+
+    // reliable-unordered: each message once
+    vector<int> times(count, 0);
+    for (int number : run.delivered[1])
+        times[number]++;
+    for (int number = 0; number < count; number++)
+    {
+        if (times[number] != 1)
+        {
+            fail("unordered channel delivered message " + to_string(number) + " " + to_string(times[number]) + " times");
+            break;
+        }
+    }
+
+    // unreliable-sequenced: only newer messages, and at least some of them
+    const vector<int>& sequenced = run.delivered[2];
+    for (size_t i = 1; i < sequenced.size(); i++)
+    {
+        if (sequenced[i] <= sequenced[i - 1])
+        {
+            fail("sequenced channel delivered message " + to_string(sequenced[i]) + " after " + to_string(sequenced[i - 1]));
+            break;
+        }
+    }
+    if (sequenced.empty())
+        fail("sequenced channel delivered nothing");
+
+    // resends: none on a clean link; on a lossy one they happen, and without lost acks or reordering only for
+    // messages that had not arrived, so the receiver never sees a copy of one it has
+    if (!link.resends && run.sender.messagesResent > 0)
+        fail(to_string(run.sender.messagesResent) + " messages resent although nothing was lost");
+    if (link.resends && run.sender.messagesResent == 0)
+        fail("nothing was resent although " + to_string(run.lostByLink) + " datagrams were lost");
+    if (!link.duplicates && run.receiver.duplicates > 0)
+        fail(to_string(run.receiver.duplicates) + " messages resent after they had arrived");
+    return ok;
+}
+
+
+int main(int argc, char* argv[])
+{
+    int count = 2000;
+    double lossPercent = 5.0;
+    double reorderPercent = 10.0;
+    double latencyMs = 20.0;
+    unsigned int seed = 1;
+    int port = 37000;
+
+    // the connections' own progress messages would only get in the way of the results
+    LogSetLevel(LOG_LEVEL_WARN);
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* value = i + 1 < argc ? argv[i + 1] : "";
+
+        if (strcmp(argv[i], "--count") == 0) { count = atoi(value); i++; }
+        else if (strcmp(argv[i], "--loss") == 0) { lossPercent = atof(value); i++; }
+        else if (strcmp(argv[i], "--reorder") == 0) { reorderPercent = atof(value); i++; }
+        else if (strcmp(argv[i], "--latency") == 0) { latencyMs = atof(value); i++; }
+        else if (strcmp(argv[i], "--seed") == 0) { seed = (unsigned int)atoi(value); i++; }
+        else if (strcmp(argv[i], "--port") == 0) { port = atoi(value); i++; }
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (count <= 0 || lossPercent <= 0.0 || lossPercent >= 100.0 || reorderPercent < 0.0 || reorderPercent > 100.0 || latencyMs < 0.0)
+    {
+        fprintf(stderr, "Need a positive count, a loss above 0 and below 100%%, a reorder percentage and a latency\n");
+        return 1;
+    }
+
+    if (!InitializeSockets())
+    {
+        fprintf(stderr, "Failed to initialize sockets\n");
+        return 1;
+    }
+
+    const MessageLink links[] = {
+        { "clean", 0.0, 0.0, 0.0, false, false },
+        { "forward-loss", lossPercent, 0.0, 0.0, true, false },
+        { "impaired", lossPercent, lossPercent, reorderPercent, true, true },
+    };
+
+    bool ok = true;
+    int index = 0;
+    for (const MessageLink& link : links)
+    {
+        MessageRun run;
+        if (RunMessages(link, latencyMs, seed, count, (unsigned short)(port + 2 * index++), run) != 0)
+        {
+            ShutdownSockets();
+            return 1;
+        }
+        const bool passed = CheckRun(link, count, run);
+        printf("%-14s %s  %.3fs  ordered %zu/%d  unordered %zu/%d  sequenced %zu/%d  resent %llu  duplicates %llu  bundles %llu  lost by link %u\n",
+            link.name, passed ? "ok  " : "FAIL", run.seconds, run.delivered[0].size(), count, run.delivered[1].size(), count,
+            run.delivered[2].size(), count, (unsigned long long)run.sender.messagesResent, (unsigned long long)run.receiver.duplicates,
+            (unsigned long long)run.sender.bundlesSent, run.lostByLink);
+        ok = ok && passed;
+    }
+
+    ShutdownSockets();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,310 @@
+// File Name: PingPongBenchmark.cpp
+// Date: 2026-10
+// File Description:
+//      -- Small-message latency benchmark over loopback. A client ReliableConnection sends
+//      -- a timestamped message, an echo thread with its own ReliableConnection sends it straight back, and the
+//      -- client sends the next one once the echo is in. Both threads read the same monotonic clock, so the echo
+//      -- side measures the one-way latency directly and the client measures the round trip.
+//      -- busy mode: both threads spin on ReceivePacket over SO_BUSY_POLL sockets, optionally pinned to CPUs.
+//      -- sleep mode: both wait --interval between polls, like the tool's main loop without --busy-poll.
+//      -- Usage: PingPongBenchmark [--count 100000] [--size 32] [--mode busy,sleep] [--interval ms]
+//      --                          [--busy-poll us] [--cpu client,echo] [--port 32000] [--out <build dir>/pingpong_results.jsonl|-]
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchmarkData.h"
+#include "Log.h"
+#include "Net.h"
+
+using namespace std;
+using namespace net;
+
+
+const unsigned int ProtocolId = 0x11223344;
+const float TimeOut = 10.0f;
+const int MessageHeader = 12;           // sequence (4 bytes) and send time (8 bytes) at the start of every message
+const int MaxMessageSize = 256;
+const float EchoTimeOut = 1.0f;         // a message not echoed within this counts as lost
+const float IdleUpdateInterval = 0.001f; // how often an idle side runs Connection::Update
+
+
+// One run of the benchmark
+struct PingPongConfig
+{
+    bool busy = true;
+    int count = 100000;                 // measured messages
+    int warmup = 1000;                  // messages sent first and not measured
+    int size = 32;                      // payload bytes per message
+    float interval = 1.0f / 30.0f;      // sleep mode: seconds between polls
+    int busyPollMicroseconds = 50;      // busy mode: SO_BUSY_POLL per receive
+    bool yield = false;                 // busy mode: give up the CPU between polls (fewer CPUs than spinning threads)
+    int clientCpu = -1;                 // CPUs the threads are pinned to (-1 = not pinned)
+    int echoCpu = -1;
+    int port = 32000;                   // client binds port, echo port + 1
+};
+
+
+// Latency distribution of one direction, in microseconds
+struct LatencySummary
+{
+    double p50 = 0.0;
+    double p99 = 0.0;
+    double p999 = 0.0;
+    double max = 0.0;
+    double mean = 0.0;
+};
+
+
+// Function Name: Summarize
+// Function Description: Exact percentiles of nanosecond samples (sorts them)
+static LatencySummary Summarize(vector<uint64_t>& samples)
+{
+    LatencySummary summary;
+    if (samples.empty())
+        return summary;
+    sort(samples.begin(), samples.end());
+    auto at = [&samples](double q) { return samples[min(samples.size() - 1, (size_t)(q * samples.size()))] / 1000.0; };
+    summary.p50 = at(0.5);
+    summary.p99 = at(0.99);
+    summary.p999 = at(0.999);
+    summary.max = samples.back() / 1000.0;
+    double sum = 0.0;
+    for (uint64_t sample : samples)
+        sum += (double)sample;
+    summary.mean = sum / samples.size() / 1000.0;
+    return summary;
+}
+
+
+// Function Name: Idle
+// Function Description: What a side does when nothing has arrived: keeps the connection updated and, in sleep mode, sleeps
+static void Idle(ReliableConnection& connection, const PingPongConfig& config, uint64_t now, uint64_t& nextUpdate)
+{
+    if (now >= nextUpdate)
+    {
+        connection.Update();
+        nextUpdate = now + SecondsToNs(IdleUpdateInterval);
+    }
+    if (!config.busy)
+        net::wait(config.interval);
+    else if (config.yield)
+        this_thread::yield();
+}
+
+
+// Function Name: RunEcho
+// Function Description: The echo thread: sends every message straight back and records its one-way latency
+static void RunEcho(ReliableConnection& echo, const PingPongConfig& config, vector<uint64_t>& oneWay, atomic<bool>& stop)
+{
+    if (config.echoCpu >= 0 && !PinThread(config.echoCpu))
+        fprintf(stderr, "Could not pin the echo thread to CPU %d\n", config.echoCpu);
+
+    unsigned char message[MaxMessageSize];
+    uint64_t nextUpdate = 0;
+    while (!stop)
+    {
+        const int bytes = echo.ReceivePacket(message, sizeof(message));
+        const uint64_t now = MonotonicNs();
+        if (bytes >= MessageHeader)
+        {
+            const uint32_t sequence = wire::LoadBigEndian<uint32_t>(message);
+            const uint64_t sent = wire::LoadBigEndian<uint64_t>(message + 4);
+            if (sequence >= (uint32_t)config.warmup)
+                oneWay.push_back(now - sent);
+            echo.SendPacket(message, bytes);
+            continue;
+        }
+        Idle(echo, config, now, nextUpdate);
+    }
+}
+
+
+// Function Name: RunPingPong
+// Function Description: One run; fills in the one-way and round trip samples and the messages lost, returns 0 or -1 on a setup error
+static int RunPingPong(const PingPongConfig& config, vector<uint64_t>& oneWay, vector<uint64_t>& roundTrip, int& lost)
+{
+    ReliableConnection client(ProtocolId, TimeOut);
+    ReliableConnection echo(ProtocolId, TimeOut);
+    if (!client.Start(config.port) || !echo.Start(config.port + 1))
+    {
+        fprintf(stderr, "Cannot bind ports %d and %d\n", config.port, config.port + 1);
+        return -1;
+    }
+    if (config.busy && !(client.SetBusyPoll(config.busyPollMicroseconds) && echo.SetBusyPoll(config.busyPollMicroseconds)))
+        fprintf(stderr, "SO_BUSY_POLL unavailable, spinning only\n");
+    echo.Listen();
+    client.Connect(Address(127, 0, 0, 1, (unsigned short)(config.port + 1)));
+
+    oneWay.clear();
+    oneWay.reserve(config.count);
+    roundTrip.clear();
+    roundTrip.reserve(config.count);
+    lost = 0;
+
+    atomic<bool> stop{ false };
+    thread echoThread(RunEcho, ref(echo), cref(config), ref(oneWay), ref(stop));
+
+    if (config.clientCpu >= 0 && !PinThread(config.clientCpu))
+        fprintf(stderr, "Could not pin the client thread to CPU %d\n", config.clientCpu);
+
+    unsigned char message[MaxMessageSize] = { 0 };
+    unsigned char reply[MaxMessageSize];
+    uint64_t nextUpdate = 0;
+    for (int i = 0; i < config.warmup + config.count; ++i)
+    {
+        const uint64_t sent = MonotonicNs();
+        wire::StoreBigEndian<uint32_t>(message, (uint32_t)i);
+        wire::StoreBigEndian<uint64_t>(message + 4, sent);
+        client.SendPacket(message, config.size);
+
+        const uint64_t deadline = sent + SecondsToNs(EchoTimeOut);
+        while (true)
+        {
+            const int bytes = client.ReceivePacket(reply, sizeof(reply));
+            const uint64_t now = MonotonicNs();
+            if (bytes >= MessageHeader && wire::LoadBigEndian<uint32_t>(reply) == (uint32_t)i)
+            {
+                if (i >= config.warmup)
+                    roundTrip.push_back(now - sent);
+                break;
+            }
+            if (now >= deadline)
+            {
+                lost++;
+                break;
+            }
+            if (bytes == 0)
+                Idle(client, config, now, nextUpdate);
+        }
+    }
+
+    stop = true;
+    echoThread.join();
+    return 0;
+}
+
+
+// Function Name: WriteSummaryJson
+// Function Description: Appends one direction as a JSON object member
+static void WriteSummaryJson(FILE* out, const char* name, const LatencySummary& summary)
+{
+    fprintf(out, "\"%s\":{\"p50\":%.3f,\"p99\":%.3f,\"p999\":%.3f,\"max\":%.3f,\"mean\":%.3f}",
+        name, summary.p50, summary.p99, summary.p999, summary.max, summary.mean);
+}
+
+
+
+int main(int argc, char* argv[])
+{
+    PingPongConfig base;
+    vector<bool> modes = { true };
+    const char* outPath = BENCHMARK_OUTPUT_DIR "/pingpong_results.jsonl";
+
+    // the connections' own progress messages would only get in the way of the results
+    LogSetLevel(LOG_LEVEL_WARN);
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* value = i + 1 < argc ? argv[i + 1] : "";
+
+        if (strcmp(argv[i], "--count") == 0) { base.count = atoi(value); i++; }
+        else if (strcmp(argv[i], "--warmup") == 0) { base.warmup = atoi(value); i++; }
+        else if (strcmp(argv[i], "--size") == 0) { base.size = atoi(value); i++; }
+        else if (strcmp(argv[i], "--interval") == 0) { base.interval = (float)atof(value) / 1000.0f; i++; }
+        else if (strcmp(argv[i], "--busy-poll") == 0) { base.busyPollMicroseconds = atoi(value); i++; }
+        else if (strcmp(argv[i], "--port") == 0) { base.port = atoi(value); i++; }
+        else if (strcmp(argv[i], "--out") == 0) { outPath = value; i++; }
+        else if (strcmp(argv[i], "--cpu") == 0)
+        {
+#pragma warning(suppress : 4996)
+            sscanf(value, "%d,%d", &base.clientCpu, &base.echoCpu);
+            i++;
+        }
+        else if (strcmp(argv[i], "--mode") == 0)
+        {
+            modes.clear();
+            string list = value;
+            if (list.find("busy") != string::npos)
+                modes.push_back(true);
+            if (list.find("sleep") != string::npos)
+                modes.push_back(false);
+            i++;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (base.count <= 0 || base.warmup < 0 || base.size < MessageHeader || base.size > MaxMessageSize || modes.empty())
+    {
+        fprintf(stderr, "Need a positive count, a size of %d..%d bytes and --mode busy and/or sleep\n", MessageHeader, MaxMessageSize);
+        return 1;
+    }
+
+    // two threads spinning on one CPU would only take turns at the scheduler's time slice
+    if (thread::hardware_concurrency() < 2)
+    {
+        fprintf(stderr, "Fewer than 2 CPUs: busy mode yields between polls, its latencies are not representative\n");
+        base.yield = true;
+    }
+
+    if (!InitializeSockets())
+    {
+        fprintf(stderr, "Failed to initialize sockets\n");
+        return 1;
+    }
+
+    FILE* out = stdout;
+    if (strcmp(outPath, "-") != 0)
+    {
+#pragma warning(suppress : 4996)
+        out = fopen(outPath, "w");
+        if (!out)
+        {
+            fprintf(stderr, "Cannot open %s\n", outPath);
+            return 1;
+        }
+    }
+
+    int failures = 0;
+    for (bool busy : modes)
+    {
+        PingPongConfig config = base;
+        config.busy = busy;
+
+        vector<uint64_t> oneWay, roundTrip;
+        int lost = 0;
+        if (RunPingPong(config, oneWay, roundTrip, lost) != 0 || lost > 0)
+            failures++;
+        const LatencySummary oneWaySummary = Summarize(oneWay);
+        const LatencySummary roundTripSummary = Summarize(roundTrip);
+
+        fprintf(out, "{\"benchmark\":\"pingpong\",\"mode\":\"%s\",\"size\":%d,\"count\":%d,\"lost\":%d,",
+            busy ? "busy" : "sleep", config.size, config.count, lost);
+        WriteSummaryJson(out, "one_way_us", oneWaySummary);
+        fprintf(out, ",");
+        WriteSummaryJson(out, "rtt_us", roundTripSummary);
+        fprintf(out, "}\n");
+        fflush(out);
+
+        fprintf(stderr, "%-5s %4d B x %-7d one-way p50 %9.1f us  p99 %9.1f us  p999 %9.1f us | rtt p50 %9.1f us  p99 %9.1f us  p999 %9.1f us  lost %d\n",
+            busy ? "busy" : "sleep", config.size, config.count,
+            oneWaySummary.p50, oneWaySummary.p99, oneWaySummary.p999,
+            roundTripSummary.p50, roundTripSummary.p99, roundTripSummary.p999, lost);
+    }
+
+    if (out != stdout)
+        fclose(out);
+
+    ShutdownSockets();
+    return failures == 0 ? 0 : 1;
+}
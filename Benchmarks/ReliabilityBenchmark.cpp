@@ -0,0 +1,200 @@
+// File Name: ReliabilityBenchmark.cpp
+// Date: 2026-10
+// File Description:
+//      -- Microbenchmarks of the ReliabilitySystem hot paths with 1k - 100k packets in flight.
+//      -- Every benchmark reports ns per packet (items/s) and a fitted big-O over the window size, so a data
+//      -- structure change shows up as a different complexity, not just a different constant.
+
+#include <benchmark/benchmark.h>
+
+#include "Net.h"
+
+using namespace net;
+
+
+// Packets each timed batch sends / receives before the window is restored
+static const int Batch = 256;
+
+
+// Class Name: ReliabilityProbe
+// Class Description: Sets up a ReliabilitySystem with a large window directly and exposes its per-frame steps
+class ReliabilityProbe : public ReliabilitySystem
+{
+public:
+
+    ReliabilityProbe()
+    {
+        clock.Advance(SecondsToNs(10.0));
+        SetClock(clock);
+    }
+
+    // count packets sent and waiting for their ack, and count packets received from the peer, spread over the last rtt_maximum
+    void Fill(unsigned int count)
+    {
+        Reset();
+        const uint64_t span = SecondsToNs(rtt_maximum);
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            PacketData data;
+            data.sequence = i;
+            data.time = clock.Now() - span * (count - i) / (count + 1);
+            data.size = 256;
+            sentQueue.push_back(data);
+            pendingAckQueue.push_back(data);
+            receivedQueue.push_back(data);
+        }
+        local_sequence = count;
+        remote_sequence = count - 1;
+        sent_packets = count;
+        sent_bytes = (uint64_t)count * 256;
+    }
+
+    // Drops the newest sent packets again so the window keeps its size
+    void UnsendNewest(int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            sentQueue.pop_back();
+            pendingAckQueue.pop_back();
+        }
+        local_sequence -= count;
+    }
+
+    // Drops the newest received packets again so the window keeps its size
+    void UnreceiveNewest(int count, unsigned int remote)
+    {
+        for (int i = 0; i < count; ++i)
+            receivedQueue.pop_back();
+        remote_sequence = remote;
+    }
+
+    // Puts every acked packet back into the pending queue
+    void Unack()
+    {
+        while (!ackedQueue.empty())
+        {
+            pendingAckQueue.insert_sorted(ackedQueue.back(), max_sequence);
+            ackedQueue.pop_back();
+        }
+        acked_bytes = 0;
+    }
+
+    using ReliabilitySystem::UpdateStats;
+
+private:
+
+    ManualClock clock;
+};
+
+
+static void BM_PacketSent(benchmark::State& state)
+{
+    ReliabilityProbe reliability;
+    reliability.Fill((unsigned int)state.range(0));
+
+    for (auto _ : state)
+    {
+        for (int i = 0; i < Batch; ++i)
+            reliability.PacketSent(256);
+
+        state.PauseTiming();
+        reliability.UnsendNewest(Batch);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * Batch);
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_PacketSent)->RangeMultiplier(10)->Range(1000, 100000)->Complexity();
+
+
+static void BM_PacketReceived(benchmark::State& state)
+{
+    const unsigned int window = (unsigned int)state.range(0);
+    ReliabilityProbe reliability;
+    reliability.Fill(window);
+
+    for (auto _ : state)
+    {
+        for (int i = 0; i < Batch; ++i)
+            reliability.PacketReceived(window + i, 256);
+
+        state.PauseTiming();
+        reliability.UnreceiveNewest(Batch, window - 1);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * Batch);
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_PacketReceived)->RangeMultiplier(10)->Range(1000, 100000)->Complexity();
+
+
+// Runs once per packet sent: the ack bits are rebuilt from the received queue
+static void BM_GenerateAckBits(benchmark::State& state)
+{
+    ReliabilityProbe reliability;
+    reliability.Fill((unsigned int)state.range(0));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(reliability.GenerateAckBits());
+
+    state.SetItemsProcessed(state.iterations());
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_GenerateAckBits)->RangeMultiplier(10)->Range(1000, 100000)->Complexity();
+
+
+// Runs once per packet received: the newest packet is acked, the rest of the pending queue is scanned
+static void BM_ProcessAck(benchmark::State& state)
+{
+    const unsigned int window = (unsigned int)state.range(0);
+    ReliabilityProbe reliability;
+    reliability.Fill(window);
+
+    for (auto _ : state)
+    {
+        reliability.ProcessAck(window - 1, 0);
+
+        state.PauseTiming();
+        reliability.Unack();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_ProcessAck)->RangeMultiplier(10)->Range(1000, 100000)->Complexity();
+
+
+// Runs once per frame: expiry checks the front of each queue only, so the cost must not grow with the window
+static void BM_Update(benchmark::State& state)
+{
+    ReliabilityProbe reliability;
+    reliability.Fill((unsigned int)state.range(0));
+
+    for (auto _ : state)
+        reliability.Update();
+
+    state.SetItemsProcessed(state.iterations());
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_Update)->RangeMultiplier(10)->Range(1000, 100000)->Complexity();
+
+
+// Runs once per frame and turns the running byte totals into bandwidth
+static void BM_UpdateStats(benchmark::State& state)
+{
+    ReliabilityProbe reliability;
+    reliability.Fill((unsigned int)state.range(0));
+
+    for (auto _ : state)
+    {
+        reliability.UpdateStats();
+        benchmark::DoNotOptimize(reliability.GetSentBandwidth());
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_UpdateStats)->RangeMultiplier(10)->Range(1000, 100000)->Complexity();
+
+
+BENCHMARK_MAIN();
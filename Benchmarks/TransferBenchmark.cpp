@@ -0,0 +1,63 @@
+// File Name: TransferBenchmark.cpp
+// Date: 2026-10
+// File Description:
+//      -- google benchmark front end of the loopback transfer harness. Each benchmark is one point of the matrix;
+//      -- the measured time is the wall time of a whole transfer and the protocol results are reported as counters,
+//      -- so --benchmark_format=json / --benchmark_out gives a machine-readable record.
+
+#include <benchmark/benchmark.h>
+
+#include "Fec.h"
+#include "LoopbackTransfer.h"
+
+
+// range(0) = file size, range(1) = loss in 1/10 percent, range(2) = one-way latency ms,
+// range(3) = reordered percent, range(4) = FEC scheme (Reed-Solomon 16:2 when set)
+static void BM_LoopbackTransfer(benchmark::State& state)
+{
+    TransferScenario scenario;
+    scenario.fileSize = static_cast<uint64_t>(state.range(0));
+    scenario.lossPercent = state.range(1) / 10.0;
+    scenario.latencyMs = static_cast<double>(state.range(2));
+    scenario.reorderPercent = static_cast<double>(state.range(3));
+    scenario.fecScheme = static_cast<uint8_t>(state.range(4));
+    if (scenario.fecScheme != FEC_NONE)
+    {
+        scenario.fecGroupSize = 16;
+        scenario.fecParityCount = 2;
+    }
+
+    LoopbackResult result;
+    double verified = 0.0, timeToFirstByte = 0.0, timeToComplete = 0.0, goodput = 0.0, cpuPerGB = 0.0, retransmitRatio = 0.0;
+    for (auto _ : state)
+    {
+        if (RunLoopbackTransfer(scenario, result) != 0)
+        {
+            state.SkipWithError("could not set up the loopback transfer");
+            break;
+        }
+        verified += result.verified ? 1.0 : 0.0;
+        timeToFirstByte += result.timeToFirstByteSec;
+        timeToComplete += result.timeToCompleteSec;
+        goodput += result.goodputMbps;
+        cpuPerGB += result.cpuSecPerGB;
+        retransmitRatio += result.retransmitRatio;
+    }
+
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(scenario.fileSize));
+    state.counters["verified"] = benchmark::Counter(verified, benchmark::Counter::kAvgIterations);
+    state.counters["time_to_first_byte_s"] = benchmark::Counter(timeToFirstByte, benchmark::Counter::kAvgIterations);
+    state.counters["time_to_complete_s"] = benchmark::Counter(timeToComplete, benchmark::Counter::kAvgIterations);
+    state.counters["goodput_Mbps"] = benchmark::Counter(goodput, benchmark::Counter::kAvgIterations);
+    state.counters["cpu_s_per_GB"] = benchmark::Counter(cpuPerGB, benchmark::Counter::kAvgIterations);
+    state.counters["retransmit_ratio"] = benchmark::Counter(retransmitRatio, benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_LoopbackTransfer)
+    ->ArgNames({ "size", "loss_permille", "latency_ms", "reorder_pct", "fec" })
+    ->ArgsProduct({ { 64 << 10, 1 << 20 }, { 0, 10 }, { 0, 25 }, { 0, 5 }, { FEC_NONE, FEC_REED_SOLOMON } })
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(1);
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,219 @@
+// File Name: TransferDriver.cpp
+// Date: 2026-10
+// File Description:
+//      -- End-to-end benchmark driver: runs a matrix of loopback transfers (file size x loss x latency x reordering x FEC)
+//      -- and writes one machine-readable record per run (JSON Lines or CSV) for regression tracking.
+//      -- Usage: TransferDriver [--sizes 65536,1048576] [--loss 0,1,5] [--latency 0,25] [--reorder 0,5]
+//      --                       [--fec none,xor,rs:16:2] [--compress] [--rate 2000] [--seed 1] [--port 31000]
+//      --                       [--burst enter:exit[:loss]] [--jitter ms] [--duplicate pct] [--bandwidth kbps[:queueBytes]]
+//      --                       [--transfers n] [--format json|csv] [--out <build dir>/transfer_results.jsonl|-] [--require-verified]
+//      -- --transfers runs each point as n back-to-back transfers over the same pair of TransferSessions.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "BenchmarkData.h"
+#include "Fec.h"
+#include "Log.h"
+#include "LoopbackTransfer.h"
+
+using namespace std;
+
+
+// A FEC setting of the matrix
+struct FecSetting
+{
+    uint8_t scheme;
+    uint8_t groupSize;
+    uint8_t parityCount;
+};
+
+
+// Function Name: ParseNumbers
+// Function Description: Parses a comma separated list of numbers ("0,1.5,20")
+static vector<double> ParseNumbers(const char* text)
+{
+    vector<double> values;
+    const char* at = text;
+    while (*at != '\0')
+    {
+        char* end = nullptr;
+        values.push_back(strtod(at, &end));
+        if (end == at)
+            break;
+        at = *end == ',' ? end + 1 : end;
+    }
+    return values;
+}
+
+
+// Function Name: ParseFecList
+// Function Description: Parses "none,xor[:K],rs[:K[:M]]" with the same defaults as the tool's --fec option
+static int ParseFecList(const char* text, vector<FecSetting>& settings)
+{
+    settings.clear();
+    string list = text;
+    size_t start = 0;
+    while (start <= list.size())
+    {
+        size_t end = list.find(',', start);
+        if (end == string::npos)
+            end = list.size();
+        string item = list.substr(start, end - start);
+        start = end + 1;
+
+        char scheme[8] = { 0 };
+        int groupSize = 0;
+        int parityCount = 0;
+#pragma warning(suppress : 4996)
+        sscanf(item.c_str(), "%7[a-z]:%d:%d", scheme, &groupSize, &parityCount);
+
+        FecSetting setting = { FEC_NONE, 0, 0 };
+        if (strcmp(scheme, "xor") == 0)
+            setting.scheme = FEC_XOR;
+        else if (strcmp(scheme, "rs") == 0)
+            setting.scheme = FEC_REED_SOLOMON;
+        else if (strcmp(scheme, "none") != 0)
+        {
+            fprintf(stderr, "Unknown FEC setting: %s\n", item.c_str());
+            return -1;
+        }
+
+        if (setting.scheme != FEC_NONE)
+        {
+            if (groupSize <= 0)
+                groupSize = setting.scheme == FEC_XOR ? 8 : 16;
+            if (parityCount <= 0)
+                parityCount = setting.scheme == FEC_XOR ? 1 : 2;
+            if (groupSize > FEC_MAX_GROUP_SIZE || parityCount > FEC_MAX_PARITY_COUNT)
+            {
+                fprintf(stderr, "FEC group size must be <= %d and parity count <= %d\n", FEC_MAX_GROUP_SIZE, FEC_MAX_PARITY_COUNT);
+                return -1;
+            }
+            setting.groupSize = (uint8_t)groupSize;
+            setting.parityCount = (uint8_t)parityCount;
+        }
+        settings.push_back(setting);
+    }
+    return 0;
+}
+
+
+
+int main(int argc, char* argv[])
+{
+    vector<double> sizes = { 64 * 1024, 1024 * 1024 };
+    vector<double> losses = { 0, 1, 5 };
+    vector<double> latencies = { 0, 25 };
+    vector<double> reorders = { 0, 5 };
+    vector<FecSetting> fecs = { { FEC_NONE, 0, 0 }, { FEC_REED_SOLOMON, 16, 2 } };
+
+    TransferScenario base;
+    bool csv = false;
+    bool requireVerified = false;
+    const char* outPath = BENCHMARK_OUTPUT_DIR "/transfer_results.jsonl";
+
+    // the records may go to stdout; the transfers' own progress messages would only get in the way
+    LogSetLevel(LOG_LEVEL_WARN);
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* value = i + 1 < argc ? argv[i + 1] : "";
+
+        if (strcmp(argv[i], "--sizes") == 0) { sizes = ParseNumbers(value); i++; }
+        else if (strcmp(argv[i], "--loss") == 0) { losses = ParseNumbers(value); i++; }
+        else if (strcmp(argv[i], "--latency") == 0) { latencies = ParseNumbers(value); i++; }
+        else if (strcmp(argv[i], "--reorder") == 0) { reorders = ParseNumbers(value); i++; }
+        else if (strcmp(argv[i], "--fec") == 0)
+        {
+            if (ParseFecList(value, fecs) != 0)
+                return 1;
+            i++;
+        }
+        else if (strcmp(argv[i], "--compress") == 0) base.compress = true;
+        else if (strcmp(argv[i], "--burst") == 0)
+        {
+#pragma warning(suppress : 4996)
+            sscanf(value, "%lf:%lf:%lf", &base.burstEnterPercent, &base.burstExitPercent, &base.burstLossPercent);
+            i++;
+        }
+        else if (strcmp(argv[i], "--jitter") == 0) { base.jitterMs = atof(value); i++; }
+        else if (strcmp(argv[i], "--duplicate") == 0) { base.duplicatePercent = atof(value); i++; }
+        else if (strcmp(argv[i], "--bandwidth") == 0)
+        {
+#pragma warning(suppress : 4996)
+            sscanf(value, "%lf:%d", &base.bandwidthKbps, &base.queueLimitBytes);
+            i++;
+        }
+        else if (strcmp(argv[i], "--rate") == 0) { base.sendRate = atof(value); i++; }
+        else if (strcmp(argv[i], "--transfers") == 0) { base.transfers = atoi(value); i++; }
+        else if (strcmp(argv[i], "--seed") == 0) { base.seed = (uint32_t)strtoul(value, nullptr, 10); i++; }
+        else if (strcmp(argv[i], "--port") == 0) { base.basePort = atoi(value); i++; }
+        else if (strcmp(argv[i], "--format") == 0) { csv = strcmp(value, "csv") == 0; i++; }
+        else if (strcmp(argv[i], "--out") == 0) { outPath = value; i++; }
+        else if (strcmp(argv[i], "--require-verified") == 0) requireVerified = true;
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (base.sendRate <= 0.0 || base.transfers < 1 || sizes.empty() || losses.empty() || latencies.empty() || reorders.empty() || fecs.empty())
+    {
+        fprintf(stderr, "Every matrix dimension needs at least one value, and the rate and the transfers must be positive\n");
+        return 1;
+    }
+
+    FILE* out = stdout;
+    if (strcmp(outPath, "-") != 0)
+    {
+#pragma warning(suppress : 4996)
+        out = fopen(outPath, "w");
+        if (!out)
+        {
+            fprintf(stderr, "Cannot open %s\n", outPath);
+            return 1;
+        }
+    }
+    if (csv)
+        WriteResultCsvHeader(out);
+
+    int failures = 0;
+    for (double size : sizes)
+        for (double loss : losses)
+            for (double latency : latencies)
+                for (double reorder : reorders)
+                    for (const FecSetting& fec : fecs)
+                    {
+                        TransferScenario scenario = base;
+                        scenario.fileSize = (uint64_t)size;
+                        scenario.lossPercent = loss;
+                        scenario.latencyMs = latency;
+                        scenario.reorderPercent = reorder;
+                        scenario.fecScheme = fec.scheme;
+                        scenario.fecGroupSize = fec.groupSize;
+                        scenario.fecParityCount = fec.parityCount;
+
+                        LoopbackResult result;
+                        if (RunLoopbackTransfer(scenario, result) != 0 || (requireVerified && !result.verified))
+                            failures++;
+
+                        if (csv)
+                            WriteResultCsv(out, scenario, result);
+                        else
+                            WriteResultJson(out, scenario, result);
+                        fflush(out);
+
+                        fprintf(stderr, "%-90s %s %8.3fs (first byte %6.3fs) %10.3f Mbps %8.2f cpu-s/GB\n", DescribeScenario(scenario).c_str(),
+                            result.verified ? "ok  " : "FAIL", result.timeToCompleteSec, result.timeToFirstByteSec, result.goodputMbps, result.cpuSecPerGB);
+                    }
+
+    if (out != stdout)
+        fclose(out);
+
+    return failures == 0 ? 0 : 1;
+}
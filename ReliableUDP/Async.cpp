@@ -0,0 +1,260 @@
+// File Name: Async.cpp
+// Date: 2026-10
+// File Description:
+//      -- Implements the event loop (ready queue, timers, waiting on every socket in one poll call) and the
+//      -- receive queue, ack collection and wake-ups of AsyncConnection.
+
+#include "Async.h"
+#include "Log.h"
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#elif PLATFORM == PLATFORM_MAC || PLATFORM == PLATFORM_UNIX
+#include <poll.h>
+#endif
+
+using namespace std;
+using namespace net;
+
+
+
+EventLoop::EventLoop()
+{
+#if defined(__linux__)
+    poller = epoll_create1(EPOLL_CLOEXEC);
+    if (poller < 0)
+        LOG_ERROR("epoll_create1 failed, the event loop cannot wait for packets");
+#endif
+}
+
+
+EventLoop::~EventLoop()
+{
+    for (coroutine_handle<> task : tasks)
+        task.destroy();
+#if defined(__linux__)
+    if (poller >= 0)
+        close(poller);
+#endif
+}
+
+
+void EventLoop::Run()
+{
+    stopped = false;
+    while (!stopped && !tasks.empty())
+        RunOnce();
+}
+
+
+void EventLoop::RunOnce(float maxWait)
+{
+    // resume what became ready since the last iteration; what they make ready runs next time
+    deque<coroutine_handle<>> resuming;
+    resuming.swap(ready);
+    for (coroutine_handle<> handle : resuming)
+        handle.resume();
+
+    // a spawned task ends suspended at its final point, its frame is freed here
+    for (size_t i = 0; i < tasks.size(); )
+    {
+        if (tasks[i].done())
+        {
+            tasks[i].destroy();
+            tasks[i] = tasks.back();
+            tasks.pop_back();
+        }
+        else
+            ++i;
+    }
+
+    uint64_t now = MonotonicNs();
+    uint64_t timeout = ready.empty() ? SecondsToNs(maxWait) : 0;
+    if (!timers.empty())
+        timeout = min(timeout, timers.top().time > now ? timers.top().time - now : 0);
+    for (AsyncConnection* connection : connections)
+    {
+        if (connection->waiter && connection->waitDeadline != UINT64_MAX)
+            timeout = min(timeout, connection->waitDeadline > now ? connection->waitDeadline - now : 0);
+        timeout = min(timeout, connection->nextUpdate > now ? connection->nextUpdate - now : 0);
+    }
+    WaitForSockets(timeout);
+
+    now = MonotonicNs();
+    for (AsyncConnection* connection : connections)
+        connection->Pump(now);
+
+    while (!timers.empty() && timers.top().time <= now)
+    {
+        ready.push_back(timers.top().handle);
+        timers.pop();
+    }
+}
+
+
+void EventLoop::Register(AsyncConnection* connection)
+{
+    connections.push_back(connection);
+#if defined(__linux__)
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.ptr = connection;
+    if (poller >= 0 && epoll_ctl(poller, EPOLL_CTL_ADD, connection->connection.GetSocketHandle(), &event) != 0)
+        LOG_WARN("epoll_ctl add failed for port %d", connection->connection.GetPort());
+#endif
+}
+
+
+void EventLoop::Unregister(AsyncConnection* connection)
+{
+#if defined(__linux__)
+    if (poller >= 0)
+        epoll_ctl(poller, EPOLL_CTL_DEL, connection->connection.GetSocketHandle(), nullptr);
+#endif
+    connections.erase(remove(connections.begin(), connections.end(), connection), connections.end());
+}
+
+
+void EventLoop::AddTimer(uint64_t time, coroutine_handle<> handle)
+{
+    timers.push(Timer{ time, timerOrder++, handle });
+}
+
+
+// Function Name: WaitForSockets
+// Function Description: One wait over every connection's socket; sleeps when there are none
+void EventLoop::WaitForSockets(uint64_t timeout)
+{
+    const int milliseconds = (int)min<uint64_t>((timeout + 999999) / 1000000, 1000);
+    if (connections.empty())
+    {
+        if (timeout > 0)
+            net::wait((float)NsToSeconds(timeout));
+        return;
+    }
+
+#if defined(__linux__)
+    // only the sockets that are ready come back, however many connections the loop has
+    epoll_event events[256];
+    int count = epoll_wait(poller, events, 256, milliseconds);
+    for (int i = 0; i < count; ++i)
+        static_cast<AsyncConnection*>(events[i].data.ptr)->readable = true;
+#elif PLATFORM == PLATFORM_WINDOWS
+    vector<WSAPOLLFD> sockets(connections.size());
+    for (size_t i = 0; i < connections.size(); ++i)
+    {
+        sockets[i].fd = (SOCKET)connections[i]->connection.GetSocketHandle();
+        sockets[i].events = POLLRDNORM;
+    }
+    WSAPoll(sockets.data(), (ULONG)sockets.size(), milliseconds);
+    for (size_t i = 0; i < connections.size(); ++i)
+        connections[i]->readable = sockets[i].revents != 0;
+#else
+    vector<pollfd> sockets(connections.size());
+    for (size_t i = 0; i < connections.size(); ++i)
+    {
+        sockets[i].fd = connections[i]->connection.GetSocketHandle();
+        sockets[i].events = POLLIN;
+        sockets[i].revents = 0;
+    }
+    poll(sockets.data(), (nfds_t)sockets.size(), milliseconds);
+    for (size_t i = 0; i < connections.size(); ++i)
+        connections[i]->readable = sockets[i].revents != 0;
+#endif
+}
+
+
+
+AsyncConnection::AsyncConnection(EventLoop& loop, unsigned int protocolId, float timeout)
+    : loop(loop), connection(protocolId, timeout)
+{
+}
+
+
+AsyncConnection::~AsyncConnection()
+{
+    Stop();
+}
+
+
+bool AsyncConnection::Start(int port, unsigned int localAddress)
+{
+    if (!connection.Start(port, localAddress))
+        return false;
+    loop.Register(this);
+    registered = true;
+    wasConnected = false;
+    nextUpdate = 0;
+    return true;
+}
+
+
+void AsyncConnection::Stop()
+{
+    if (registered)
+    {
+        loop.Unregister(this);
+        registered = false;
+    }
+    if (connection.IsRunning())
+        connection.Stop();
+    queue.clear();
+    acks.clear();
+}
+
+
+bool AsyncConnection::TryReceive(AsyncPacket& packet)
+{
+    if (queue.empty())
+        return false;
+    packet = queue.front();
+    queue.pop_front();
+    return true;
+}
+
+
+void AsyncConnection::TakeAcks(vector<unsigned int>& acks)
+{
+    acks.swap(this->acks);
+    this->acks.clear();
+}
+
+
+void AsyncConnection::Pump(uint64_t now)
+{
+    // a full queue leaves the rest in the socket, which then stays readable
+    while (readable && (int)queue.size() < MaxQueuedPackets)
+    {
+        AsyncPacket packet;
+        packet.size = connection.ReceivePacket(packet.data, sizeof(packet.data), packet.stream);
+        if (packet.size <= 0)
+        {
+            readable = false;
+            break;
+        }
+        queue.push_back(packet);
+    }
+
+    // the acks of one update are only readable until the next one
+    if (now >= nextUpdate)
+    {
+        unsigned int* acked = nullptr;
+        int count = 0;
+        connection.GetReliabilitySystem().GetAcks(&acked, count);
+        acks.insert(acks.end(), acked, acked + count);
+        connection.Update();
+        nextUpdate = now + SecondsToNs(AsyncUpdateInterval);
+    }
+
+    const bool closed = Closed();
+    wasConnected = wasConnected || connection.IsConnected();
+
+    if (waiter && (!queue.empty() || closed || now >= waitDeadline))
+    {
+        loop.Schedule(waiter);
+        waiter = nullptr;
+        waitDeadline = UINT64_MAX;
+    }
+}
@@ -0,0 +1,453 @@
+// File Name: Async.h
+// Date: 2026-10
+// File Description:
+//      -- C++20 coroutine interface to ReliableConnection. Task<T> is a lazily started coroutine that another
+//      -- coroutine co_awaits; EventLoop runs any number of them on one thread. The loop waits on the sockets of
+//      -- all its AsyncConnections at once (epoll on Linux, poll / WSAPoll elsewhere), hands arriving packets to
+//      -- the coroutine waiting in co_await connection.Receive(), wakes coroutines whose co_await loop.Delay() is over, and updates
+//      -- every connection, so each transfer is a coroutine frame instead of a thread or a process.
+
+#ifndef _ASYNC_H_
+#define _ASYNC_H_
+
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Net.h"
+
+namespace net
+{
+	const float AsyncUpdateInterval = 0.01f;	// seconds between two Updates of a connection, and the longest the loop waits
+	const int AsyncPacketSize = 256;			// largest payload AsyncConnection receives
+	const int MaxQueuedPackets = 256;			// packets a connection buffers for its coroutine; the rest wait in the socket
+
+	template <typename T = void>
+	class Task;
+
+	namespace detail
+	{
+		// Struct Name: TaskPromiseBase
+		// Struct Description: A task starts suspended and, when it ends, resumes the coroutine that awaited it
+		struct TaskPromiseBase
+		{
+			struct FinalAwaiter
+			{
+				bool await_ready() noexcept
+				{
+					return false;
+				}
+
+				template <typename Promise>
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+				{
+					std::coroutine_handle<> continuation = handle.promise().continuation;
+					return continuation ? continuation : std::noop_coroutine();
+				}
+
+				void await_resume() noexcept
+				{
+				}
+			};
+
+			std::suspend_always initial_suspend() noexcept
+			{
+				return {};
+			}
+
+			FinalAwaiter final_suspend() noexcept
+			{
+				return {};
+			}
+
+			// errors are return codes throughout; an exception escaping a task is a bug
+			void unhandled_exception()
+			{
+				std::terminate();
+			}
+
+			std::coroutine_handle<> continuation;
+		};
+
+		template <typename T>
+		struct TaskPromise : TaskPromiseBase
+		{
+			Task<T> get_return_object();
+
+			void return_value(T result)
+			{
+				value = std::move(result);
+			}
+
+			T value{};
+		};
+
+		template <>
+		struct TaskPromise<void> : TaskPromiseBase
+		{
+			Task<void> get_return_object();
+
+			void return_void()
+			{
+			}
+		};
+	}
+
+
+	// Class Name: Task
+	// Class Description:
+	//      -- Result of a coroutine. Nothing runs until the task is co_awaited (the awaiting coroutine resumes when
+	//      -- it ends, with its co_return value) or given to EventLoop::Spawn. The task owns the coroutine frame.
+	template <typename T>
+	class Task
+	{
+	public:
+
+		using promise_type = detail::TaskPromise<T>;
+
+		explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle)
+		{
+		}
+
+		Task(Task&& other) noexcept : handle(std::exchange(other.handle, {}))
+		{
+		}
+
+		Task& operator=(Task&& other) noexcept
+		{
+			if (this != &other)
+			{
+				if (handle)
+					handle.destroy();
+				handle = std::exchange(other.handle, {});
+			}
+			return *this;
+		}
+
+		Task(const Task&) = delete;
+		Task& operator=(const Task&) = delete;
+
+		~Task()
+		{
+			if (handle)
+				handle.destroy();
+		}
+
+		bool await_ready() const noexcept
+		{
+			return !handle || handle.done();
+		}
+
+		// runs the task right away (symmetric transfer), the caller resumes when it ends
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept
+		{
+			handle.promise().continuation = caller;
+			return handle;
+		}
+
+		T await_resume()
+		{
+			if constexpr (!std::is_void_v<T>)
+				return std::move(handle.promise().value);
+		}
+
+		// Function Name: Release
+		// Function Description: Hands the coroutine frame over to the caller (EventLoop::Spawn)
+		std::coroutine_handle<promise_type> Release()
+		{
+			return std::exchange(handle, {});
+		}
+
+	private:
+
+		std::coroutine_handle<promise_type> handle;
+	};
+
+	namespace detail
+	{
+		template <typename T>
+		Task<T> TaskPromise<T>::get_return_object()
+		{
+			return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+		}
+
+		inline Task<void> TaskPromise<void>::get_return_object()
+		{
+			return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+		}
+	}
+
+
+	class AsyncConnection;
+
+	// Class Name: EventLoop
+	// Class Description:
+	//      -- Single-threaded scheduler of the spawned tasks. Only the thread calling Run (or RunOnce) may touch the
+	//      -- loop, its connections and its tasks.
+	class EventLoop
+	{
+	public:
+
+		struct DelayAwaiter
+		{
+			bool await_ready() const
+			{
+				return MonotonicNs() >= time;
+			}
+
+			void await_suspend(std::coroutine_handle<> handle)
+			{
+				loop.AddTimer(time, handle);
+			}
+
+			void await_resume()
+			{
+			}
+
+			EventLoop& loop;
+			uint64_t time;
+		};
+
+		EventLoop();
+		EventLoop(const EventLoop&) = delete;
+		EventLoop& operator=(const EventLoop&) = delete;
+
+		// Function Name: ~EventLoop
+		// Function Description: Destroys the tasks that have not finished; their connections must be gone already or die with them
+		~EventLoop();
+
+		// Function Name: Spawn
+		// Function Description: Starts task on the next iteration; the loop owns it from now on and destroys it when it ends
+		template <typename T>
+		void Spawn(Task<T>&& task)
+		{
+			std::coroutine_handle<> handle = task.Release();
+			if (!handle)
+				return;
+			tasks.push_back(handle);
+			ready.push_back(handle);
+		}
+
+		// Function Name: Run
+		// Function Description: Runs until every spawned task has ended or Stop is called
+		void Run();
+
+		// Function Name: RunOnce
+		// Function Description: One iteration: resumes what is ready, then waits up to maxWait seconds for packets or timers
+		void RunOnce(float maxWait = AsyncUpdateInterval);
+
+		// Function Name: Stop
+		// Function Description: Makes Run return after the current iteration (the tasks stay suspended)
+		void Stop()
+		{
+			stopped = true;
+		}
+
+		// Function Name: Delay
+		// Function Description: co_await loop.Delay(seconds) suspends the calling coroutine for that long
+		DelayAwaiter Delay(float seconds)
+		{
+			return DelayAwaiter{ *this, MonotonicNs() + SecondsToNs(seconds) };
+		}
+
+		// Function Name: DelayUntil
+		// Function Description: co_await loop.DelayUntil(time) suspends the calling coroutine until MonotonicNs() reaches time
+		DelayAwaiter DelayUntil(uint64_t time)
+		{
+			return DelayAwaiter{ *this, time };
+		}
+
+		// Function Name: GetTaskCount
+		// Function Description: Spawned tasks that have not ended
+		size_t GetTaskCount() const
+		{
+			return tasks.size();
+		}
+
+	private:
+
+		friend class AsyncConnection;
+
+		struct Timer
+		{
+			uint64_t time;
+			uint64_t order;		// timers due at the same time fire in the order they were set
+			std::coroutine_handle<> handle;
+
+			bool operator>(const Timer& other) const
+			{
+				return time != other.time ? time > other.time : order > other.order;
+			}
+		};
+
+		void Register(AsyncConnection* connection);
+		void Unregister(AsyncConnection* connection);
+		void AddTimer(uint64_t time, std::coroutine_handle<> handle);
+
+		void Schedule(std::coroutine_handle<> handle)
+		{
+			ready.push_back(handle);
+		}
+
+		// waits until a socket is readable or timeout (ns) has passed and flags the readable connections
+		void WaitForSockets(uint64_t timeout);
+
+		std::vector<AsyncConnection*> connections;
+		int poller = -1;		// epoll instance the sockets are registered with (Linux)
+		std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+		uint64_t timerOrder = 0;
+		std::deque<std::coroutine_handle<>> ready;		// resumed on the next iteration
+		std::vector<std::coroutine_handle<>> tasks;		// spawned and not ended
+		bool stopped = false;
+	};
+
+
+	// Struct Name: AsyncPacket
+	// Struct Description: One received payload (size 0: nothing arrived before the deadline, or the connection closed)
+	struct AsyncPacket
+	{
+		uint16_t stream = DefaultStream;
+		int size = 0;
+		unsigned char data[AsyncPacketSize];
+	};
+
+
+	// Class Name: AsyncConnection
+	// Class Description:
+	//      -- A ReliableConnection driven by an EventLoop. The loop receives its packets into a queue, collects the
+	//      -- acks of what it sent and updates it; one coroutine at a time waits in co_await Receive().
+	class AsyncConnection
+	{
+	public:
+
+		struct ReceiveAwaiter
+		{
+			bool await_ready()
+			{
+				received = connection.TryReceive(packet);
+				return received || connection.Closed();
+			}
+
+			void await_suspend(std::coroutine_handle<> handle)
+			{
+				connection.waiter = handle;
+				connection.waitDeadline = deadline;
+			}
+
+			AsyncPacket await_resume()
+			{
+				if (!received && !connection.TryReceive(packet))
+					packet.size = 0;
+				return packet;
+			}
+
+			AsyncConnection& connection;
+			uint64_t deadline;
+			bool received = false;
+			AsyncPacket packet;
+		};
+
+		AsyncConnection(EventLoop& loop, unsigned int protocolId, float timeout);
+		~AsyncConnection();
+
+		AsyncConnection(const AsyncConnection&) = delete;
+		AsyncConnection& operator=(const AsyncConnection&) = delete;
+
+		// Function Name: Start
+		// Function Description: Binds port and joins the loop; false if the port cannot be bound
+		bool Start(int port, unsigned int localAddress = 0);
+
+		// Function Name: Stop
+		// Function Description: Leaves the loop and closes the socket (also done by the destructor)
+		void Stop();
+
+		void Listen()
+		{
+			connection.Listen();
+		}
+
+		void Connect(const Address& address)
+		{
+			connection.Connect(address);
+		}
+
+		// Function Name: Send
+		// Function Description: Sends a payload on stream right away (UDP sends do not block)
+		bool Send(const unsigned char data[], int size, uint16_t stream = DefaultStream)
+		{
+			return connection.SendPacket(data, size, stream);
+		}
+
+		bool Send(const PacketSegment segments[], int count, uint16_t stream = DefaultStream)
+		{
+			return connection.SendPacket(segments, count, stream);
+		}
+
+		// Function Name: Receive
+		// Function Description:
+		//      -- co_await connection.Receive() gives the next packet. With timeout >= 0 it gives up after that many
+		//      -- seconds, and it never waits on a connection that failed or timed out; either way the packet is empty.
+		ReceiveAwaiter Receive(float timeout = -1.0f)
+		{
+			return ReceiveAwaiter{ *this, timeout < 0.0f ? UINT64_MAX : MonotonicNs() + SecondsToNs(timeout) };
+		}
+
+		// Function Name: ReceiveUntil
+		// Function Description: Receive with an absolute MonotonicNs deadline
+		ReceiveAwaiter ReceiveUntil(uint64_t deadline)
+		{
+			return ReceiveAwaiter{ *this, deadline };
+		}
+
+		// Function Name: TryReceive
+		// Function Description: Takes the next queued packet without waiting; false if there is none
+		bool TryReceive(AsyncPacket& packet);
+
+		// Function Name: TakeAcks
+		// Function Description: Moves the sequences acked since the last call into acks (replacing its contents)
+		void TakeAcks(std::vector<unsigned int>& acks);
+
+		// Function Name: Closed
+		// Function Description: True once connecting failed or an established connection timed out
+		bool Closed() const
+		{
+			return connection.ConnectFailed() || (wasConnected && !connection.IsConnected());
+		}
+
+		ReliableConnection& GetConnection()
+		{
+			return connection;
+		}
+
+		EventLoop& GetLoop()
+		{
+			return loop;
+		}
+
+	private:
+
+		friend class EventLoop;
+
+		// receives into the queue (if the socket is readable) and updates the connection when due; wakes the
+		// waiting coroutine when it has something to say
+		void Pump(uint64_t now);
+
+		EventLoop& loop;
+		ReliableConnection connection;
+		bool registered = false;
+		bool readable = false;		// set by the loop's wait, cleared once the socket is drained
+		bool wasConnected = false;
+		uint64_t nextUpdate = 0;
+		std::deque<AsyncPacket> queue;
+		std::vector<unsigned int> acks;
+		std::coroutine_handle<> waiter;
+		uint64_t waitDeadline = UINT64_MAX;
+	};
+}
+
+#endif // !_ASYNC_H_
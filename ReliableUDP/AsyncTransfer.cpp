@@ -0,0 +1,175 @@
+// File Name: AsyncTransfer.cpp
+// Date: 2026-10
+// File Description:
+//      -- Implements the sender and receiver coroutines of AsyncSession. Each is the tool's main loop for one
+//      -- file, with the sleep between frames replaced by co_await, so the loop can run other sessions meanwhile.
+
+#include "AsyncTransfer.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+using namespace net;
+
+
+
+// Function Name: SendFile
+// Function Description:
+//      -- Loads the file and sends one packet per tick: the stream's next packet (meta, block or parity) or a
+//      -- heartbeat while it waits for the receiver. fileName is taken by value: the coroutine outlives the caller's string.
+Task<int> AsyncSession::SendFile(string fileName)
+{
+    OutgoingStream stream(options.stream, fileName.c_str());
+    stream.resume = options.resume;
+    stream.zeroCopy = options.zeroCopy;
+
+    FileBlock& fileBlock = stream.fileBlock;
+    fileBlock.SetCompression(options.compress);
+    fileBlock.SetFec(options.fecScheme, options.fecGroupSize, options.fecParityCount);
+    fileBlock.SetResume(options.resume);
+    fileBlock.SetDelta(options.delta);
+    fileBlock.SetZeroCopy(options.zeroCopy);
+    if (fileBlock.LoadFile(fileName.c_str()) != 0)
+    {
+        LOG_ERROR("Some error happen when loading file %s.", fileName.c_str());
+        co_return -1;
+    }
+    fileSize = fileBlock.GetMetaPacket().fileSize;
+
+    EventLoop& loop = connection.GetLoop();
+    ReliabilitySystem& reliability = connection.GetConnection().GetReliabilitySystem();
+    const uint64_t interval = SecondsToNs(1.0f / options.sendRate);
+    const uint64_t start = MonotonicNs();
+    uint64_t nextSend = start;
+    vector<unsigned int> acks;
+
+    while (!stream.finished)
+    {
+        co_await loop.DelayUntil(nextSend);
+        if (connection.Closed())
+        {
+            LOG_WARN("Connection lost while sending %s", fileName.c_str());
+            co_return -1;
+        }
+        const uint64_t now = MonotonicNs();
+
+        // the receiver only sends resume and signature replies; the MetaPacket is delivered once a copy is acked
+        AsyncPacket reply;
+        while (connection.TryReceive(reply))
+        {
+            if (reply.stream == stream.id && (reply.data[0] == TYPE_RESUME || reply.data[0] == TYPE_SIGNATURE))
+                fileBlock.ProcessReceivedPacket(reply.data, reply.size);
+        }
+        connection.TakeAcks(acks);
+        stream.ProcessAcks(acks.data(), (int)acks.size(), now);
+
+        unsigned char packet[PACKET_SIZE];
+        memset(packet, 0, sizeof(packet));
+        PacketSegment segments[3];
+        int segmentCount = 0;
+        uint16_t streamId = HeartbeatStream;
+        if (stream.NextPacket(now, true, reliability.GetLocalSequence(), packet, segments, segmentCount))
+            streamId = stream.id;
+
+        if (segmentCount > 0)
+            connection.Send(segments, segmentCount, streamId);
+        else
+            connection.Send(packet, sizeof(packet), streamId);
+
+        // after a stall, carry on at the send rate instead of sending the missed packets in a burst
+        if (now > nextSend + interval)
+            nextSend = now;
+        nextSend += interval;
+    }
+
+    transferSeconds = NsToSeconds(MonotonicNs() - start);
+    co_return 0;
+}
+
+
+// Function Name: ReceiveFile
+// Function Description:
+//      -- Waits for packets until the next send tick, feeds the stream opened by the first MetaPacket into its
+//      -- FileBlock, and on every tick sends a reply or, if packets have arrived since, their acks.
+Task<int> AsyncSession::ReceiveFile()
+{
+    IncomingStream stream;
+    FileBlock& fileBlock = stream.fileBlock;
+    fileBlock.SetOutputDirectory(options.outputDirectory);
+
+    bool opened = false;
+    uint16_t streamId = DefaultStream;
+    const uint64_t interval = SecondsToNs(1.0f / options.sendRate);
+    uint64_t nextSend = MonotonicNs();
+    uint64_t nextCheckpoint = nextSend + SecondsToNs(CheckpointInterval);
+
+    while (true)
+    {
+        const AsyncPacket packet = co_await connection.ReceiveUntil(nextSend);
+        const uint64_t now = MonotonicNs();
+
+        if (packet.size > 0)
+        {
+            // the transfer opens with its MetaPacket; heartbeats come on HeartbeatStream
+            if (!opened && packet.data[0] == TYPE_META)
+            {
+                opened = true;
+                streamId = packet.stream;
+                stream.startTime = now;
+            }
+
+            if (opened && packet.stream == streamId && fileBlock.FinishedReceivedAllData() != 0)
+            {
+                fileBlock.ProcessReceivedPacket(packet.data, packet.size);
+                if (fileBlock.FinishedReceivedAllData() == 0)
+                {
+                    const MetaPacket& meta = fileBlock.GetMetaPacket();
+                    transferSeconds = NsToSeconds(now - stream.startTime);
+                    fileSize = meta.fileSize;
+                    LOG_INFO("All data received: %s, %llu bytes in %.3f seconds", meta.filename, (unsigned long long)meta.fileSize, transferSeconds);
+                    co_return fileBlock.VerifyFileContent() && fileBlock.SaveFile() == 0 ? 0 : -1;
+                }
+            }
+        }
+        else if (connection.Closed())
+        {
+            LOG_WARN("Connection lost while receiving");
+            co_return -1;
+        }
+
+        if (now >= nextSend)
+        {
+            SendReply(fileBlock, streamId);
+            if (now > nextSend + interval)
+                nextSend = now;
+            nextSend += interval;
+        }
+
+        // persist the receive progress of a resumable transfer
+        if (opened && now >= nextCheckpoint)
+        {
+            fileBlock.Checkpoint();
+            nextCheckpoint = now + SecondsToNs(CheckpointInterval);
+        }
+    }
+}
+
+
+void AsyncSession::SendReply(FileBlock& fileBlock, uint16_t stream)
+{
+    unsigned char packet[PACKET_SIZE];
+    memset(packet, 0, sizeof(packet));
+    if (fileBlock.NextReplyPacket(packet))
+    {
+        connection.Send(packet, sizeof(packet), stream);
+        return;
+    }
+
+    // nothing to say but the acks, in 12 bytes instead of a zero packet, and only if something is unacked
+    // (or to keep the connection alive), as TransferSession's receiver does
+    ReliableConnection& reliable = connection.GetConnection();
+    if (reliable.GetUnackedPackets() > 0 || reliable.GetClock().Now() - reliable.GetLastSendTime() >= SecondsToNs(AckKeepAlive))
+        reliable.SendAck();
+}
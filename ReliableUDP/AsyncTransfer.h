@@ -0,0 +1,92 @@
+// File Name: AsyncTransfer.h
+// Date: 2026-10
+// File Description:
+//      -- File transfers as coroutines on an EventLoop: co_await session.SendFile(path) on the client and
+//      -- co_await session.ReceiveFile() on the server speak the same protocol as the ReliableUDP tool (0-RTT
+//      -- MetaPacket, blocks, FEC parity, resume and delta replies, one packet per send tick each way). One thread
+//      -- runs as many sessions as it has connections, each suspended between its ticks.
+
+#ifndef _ASYNC_TRANSFER_H_
+#define _ASYNC_TRANSFER_H_
+
+#include <cstdint>
+#include <string>
+
+#include "Async.h"
+#include "TransferStream.h"
+
+namespace net
+{
+	const float AsyncSendRate = 30.0f;			// packets per second each end sends, the tool's good-mode rate
+	const float CheckpointInterval = 0.25f;		// seconds between two journal checkpoints of a resumable receive
+
+	// Struct Name: AsyncTransferOptions
+	// Struct Description: Settings of one session; the sender's ones are announced to the receiver in the MetaPacket
+	struct AsyncTransferOptions
+	{
+		float sendRate = AsyncSendRate;
+		uint16_t stream = DefaultStream;	// stream the sender's packets go out on
+		bool compress = false;
+		uint8_t fecScheme = FEC_NONE;
+		uint8_t fecGroupSize = 0;
+		uint8_t fecParityCount = 0;
+		bool resume = false;
+		bool delta = false;
+		bool zeroCopy = false;
+		std::string outputDirectory;		// receiver: where files are saved (empty: the path the sender announced)
+	};
+
+
+	// Class Name: AsyncSession
+	// Class Description:
+	//      -- Sends or receives one file at a time over an AsyncConnection it does not own. The connection must
+	//      -- be connecting (sender) or listening (receiver), and only the session may receive from it meanwhile.
+	class AsyncSession
+	{
+	public:
+
+		explicit AsyncSession(AsyncConnection& connection, const AsyncTransferOptions& options = AsyncTransferOptions())
+			: connection(connection), options(options)
+		{
+		}
+
+		// Function Name: SendFile
+		// Function Description: Sends fileName; 0 once its last packet is out, -1 if it cannot be loaded or the connection fails
+		Task<int> SendFile(std::string fileName);
+
+		// Function Name: ReceiveFile
+		// Function Description: Receives the next file and saves it; 0 once it is verified and saved, -1 on a checksum mismatch or a lost connection
+		Task<int> ReceiveFile();
+
+		// Function Name: GetTransferSeconds
+		// Function Description: Time from the first packet to the end of the last transfer
+		double GetTransferSeconds() const
+		{
+			return transferSeconds;
+		}
+
+		// Function Name: GetFileSize
+		// Function Description: Bytes of the file of the last transfer
+		uint64_t GetFileSize() const
+		{
+			return fileSize;
+		}
+
+		AsyncTransferOptions& GetOptions()
+		{
+			return options;
+		}
+
+	private:
+
+		// sends the next reply of the receiver's stream, or an ack-only datagram if there is something to ack or the connection needs a keep-alive
+		void SendReply(FileBlock& fileBlock, uint16_t stream);
+
+		AsyncConnection& connection;
+		AsyncTransferOptions options;
+		double transferSeconds = 0.0;
+		uint64_t fileSize = 0;
+	};
+}
+
+#endif // !_ASYNC_TRANSFER_H_
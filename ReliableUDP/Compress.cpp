@@ -0,0 +1,362 @@
+// File Name: Compress.cpp
+// Date: 2026-10
+// File Description:
+//      -- LZ4 block format compressor/decompressor and the chunked wire image built on top of it.
+//      -- Block format reference: https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+
+#include "Compress.h"
+
+#include <cstring>
+
+
+static const int MIN_MATCH = 4;       // shortest match the format can express
+static const int LAST_LITERALS = 5;   // the last 5 bytes of a block are always literals
+static const int MF_LIMIT = 12;       // a match may not start within the last 12 bytes
+static const int HASH_LOG = 12;       // 4096 entry match finder table
+static const int SKIP_TRIGGER = 6;    // after 2^6 failed probes start skipping ahead faster
+static const int MAX_OFFSET = 0xFFFF;
+
+
+static inline uint32_t Read32(const uint8_t* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t HashSequence(uint32_t sequence)
+{
+    return (sequence * 2654435761U) >> (32 - HASH_LOG);
+}
+
+// Writes the 255-run extension of a literal or match length
+static inline uint8_t* WriteLength(uint8_t* op, size_t length)
+{
+    while (length >= 255)
+    {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+
+
+// Function Name: CompressChunk
+// Parameters:
+//   - const uint8_t* src: input bytes
+//   - int srcSize: number of input bytes
+//   - uint8_t* dst: output buffer
+//   - int dstCapacity: size of the output buffer
+// Return Value: int - compressed size, or 0 if the data does not fit into dstCapacity
+// Function Description:
+//      -- Greedy single-pass LZ4 compressor. Failed match probes make the scan step grow, so already
+//      -- compressed input (the JPG test file) is skipped over quickly instead of probing every byte.
+int CompressChunk(const uint8_t* src, int srcSize, uint8_t* dst, int dstCapacity)
+{
+    const uint8_t* ip = src;
+    const uint8_t* anchor = src;
+    const uint8_t* const iend = src + srcSize;
+    const uint8_t* const mflimit = iend - MF_LIMIT;
+    const uint8_t* const matchlimit = iend - LAST_LITERALS;
+
+    uint8_t* op = dst;
+    uint8_t* const oend = dst + dstCapacity;
+
+    if (srcSize > MF_LIMIT)
+    {
+        uint32_t table[1 << HASH_LOG];
+        memset(table, 0, sizeof(table));
+
+        ip++;
+
+        while (true)
+        {
+            // find a match
+            const uint8_t* ref;
+            unsigned int attempts = 1 << SKIP_TRIGGER;
+            while (true)
+            {
+                if (ip > mflimit)
+                    goto lastLiterals;
+
+                uint32_t h = HashSequence(Read32(ip));
+                ref = src + table[h];
+                table[h] = (uint32_t)(ip - src);
+
+                if (ref < ip && ip - ref <= MAX_OFFSET && Read32(ref) == Read32(ip))
+                    break;
+
+                ip += attempts++ >> SKIP_TRIGGER;
+            }
+
+            // extend the match backwards over pending literals
+            while (ip > anchor && ref > src && ip[-1] == ref[-1])
+            {
+                ip--;
+                ref--;
+            }
+
+            // extend the match forwards
+            const uint8_t* matchEnd = ip + MIN_MATCH;
+            const uint8_t* refEnd = ref + MIN_MATCH;
+            while (matchEnd < matchlimit && *matchEnd == *refEnd)
+            {
+                matchEnd++;
+                refEnd++;
+            }
+
+            size_t literalLength = (size_t)(ip - anchor);
+            size_t matchLength = (size_t)(matchEnd - ip) - MIN_MATCH;
+
+            // token + literal length run + literals + offset + match length run
+            if ((size_t)(oend - op) < 1 + literalLength / 255 + 1 + literalLength + 2 + matchLength / 255 + 1)
+                return 0;
+
+            uint8_t* token = op++;
+
+            if (literalLength >= 15)
+            {
+                *token = 15 << 4;
+                op = WriteLength(op, literalLength - 15);
+            }
+            else
+                *token = (uint8_t)(literalLength << 4);
+
+            memcpy(op, anchor, literalLength);
+            op += literalLength;
+
+            uint16_t offset = (uint16_t)(ip - ref);
+            *op++ = (uint8_t)(offset & 0xFF);
+            *op++ = (uint8_t)(offset >> 8);
+
+            if (matchLength >= 15)
+            {
+                *token |= 15;
+                op = WriteLength(op, matchLength - 15);
+            }
+            else
+                *token |= (uint8_t)matchLength;
+
+            ip = matchEnd;
+            anchor = ip;
+
+            if (ip > mflimit)
+                break;
+
+            // prime the table with a position inside the match we just consumed
+            table[HashSequence(Read32(ip - 2))] = (uint32_t)(ip - 2 - src);
+        }
+    }
+
+lastLiterals:
+    size_t literalLength = (size_t)(iend - anchor);
+    if ((size_t)(oend - op) < 1 + literalLength / 255 + 1 + literalLength)
+        return 0;
+
+    if (literalLength >= 15)
+    {
+        *op++ = 15 << 4;
+        op = WriteLength(op, literalLength - 15);
+    }
+    else
+        *op++ = (uint8_t)(literalLength << 4);
+
+    memcpy(op, anchor, literalLength);
+    op += literalLength;
+
+    return (int)(op - dst);
+}
+
+
+
+// Function Name: DecompressChunk
+// Parameters:
+//   - const uint8_t* src: compressed bytes
+//   - int srcSize: number of compressed bytes
+//   - uint8_t* dst: output buffer
+//   - int dstSize: size of the output buffer
+// Return Value: int - number of bytes produced, or -1 if the input is malformed
+// Function Description:
+//      -- Bounds checked LZ4 block decoder; never reads or writes outside of the given buffers.
+int DecompressChunk(const uint8_t* src, int srcSize, uint8_t* dst, int dstSize)
+{
+    const uint8_t* ip = src;
+    const uint8_t* const iend = src + srcSize;
+    uint8_t* op = dst;
+    uint8_t* const oend = dst + dstSize;
+
+    while (ip < iend)
+    {
+        uint8_t token = *ip++;
+
+        // literals
+        size_t literalLength = token >> 4;
+        if (literalLength == 15)
+        {
+            uint8_t b;
+            do
+            {
+                if (ip >= iend)
+                    return -1;
+                b = *ip++;
+                literalLength += b;
+            } while (b == 255);
+        }
+
+        if (literalLength > (size_t)(iend - ip) || literalLength > (size_t)(oend - op))
+            return -1;
+
+        memcpy(op, ip, literalLength);
+        op += literalLength;
+        ip += literalLength;
+
+        // the last sequence has no match part
+        if (ip >= iend)
+            break;
+
+        // match
+        if (iend - ip < 2)
+            return -1;
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst))
+            return -1;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15)
+        {
+            uint8_t b;
+            do
+            {
+                if (ip >= iend)
+                    return -1;
+                b = *ip++;
+                matchLength += b;
+            } while (b == 255);
+        }
+        matchLength += MIN_MATCH;
+
+        if (matchLength > (size_t)(oend - op))
+            return -1;
+
+        const uint8_t* match = op - offset;
+        if (offset >= matchLength)
+            memcpy(op, match, matchLength);
+        else
+        {
+            for (size_t i = 0; i < matchLength; i++) // overlapping copy (run-length style match)
+                op[i] = match[i];
+        }
+        op += matchLength;
+    }
+
+    return (int)(op - dst);
+}
+
+
+
+// Function Name: EncodeWireImage
+// Parameters:
+//   - const std::vector<uint8_t>& fileData: the whole file
+//   - std::vector<uint8_t>& wire: receives the chunked wire image
+// Return Value: size_t - number of chunks that were stored raw (bypassed)
+// Function Description:
+//      -- Each chunk is prefixed with a ChunkHeader. A chunk that does not save at least 1/32 of its size
+//      -- is stored raw, so incompressible data costs only the 5 byte header per chunk on the wire.
+size_t EncodeWireImage(const std::vector<uint8_t>& fileData, std::vector<uint8_t>& wire)
+{
+    const size_t totalChunks = (fileData.size() + COMPRESSION_CHUNK_SIZE - 1) / COMPRESSION_CHUNK_SIZE;
+    size_t rawChunks = 0;
+
+    wire.clear();
+    wire.reserve(fileData.size() + totalChunks * ChunkHeaderLayout::size);
+
+    std::vector<uint8_t> scratch(LZ4_COMPRESS_BOUND(COMPRESSION_CHUNK_SIZE));
+
+    for (size_t i = 0; i < totalChunks; i++)
+    {
+        size_t offset = i * COMPRESSION_CHUNK_SIZE;
+        size_t rawSize = fileData.size() - offset;
+        if (rawSize > COMPRESSION_CHUNK_SIZE)
+            rawSize = COMPRESSION_CHUNK_SIZE;
+
+        // only accept the compressed form if it is clearly smaller
+        int limit = (int)(rawSize - rawSize / 32);
+        int compressedSize = CompressChunk(fileData.data() + offset, (int)rawSize, scratch.data(), limit);
+
+        ChunkHeader header;
+        const uint8_t* chunkData;
+        if (compressedSize > 0)
+        {
+            header.kind = CHUNK_LZ4;
+            header.storedSize = (uint32_t)compressedSize;
+            chunkData = scratch.data();
+        }
+        else
+        {
+            header.kind = CHUNK_RAW;
+            header.storedSize = (uint32_t)rawSize;
+            chunkData = fileData.data() + offset;
+            rawChunks++;
+        }
+
+        size_t at = wire.size();
+        wire.resize(at + ChunkHeaderLayout::size + header.storedSize);
+        ChunkHeaderLayout::Encode(header, wire.data() + at);
+        memcpy(wire.data() + at + ChunkHeaderLayout::size, chunkData, header.storedSize);
+    }
+
+    return rawChunks;
+}
+
+
+
+// Function Name: DecodeWireImage
+// Parameters:
+//   - const std::vector<uint8_t>& wire: the received wire image
+//   - std::vector<uint8_t>& fileData: output, already sized to the original file size
+// Return Value: int - 0 on success, -1 if the wire image does not describe exactly fileData.size() bytes
+int DecodeWireImage(const std::vector<uint8_t>& wire, std::vector<uint8_t>& fileData)
+{
+    size_t in = 0;
+    size_t out = 0;
+
+    while (out < fileData.size())
+    {
+        if (wire.size() - in < ChunkHeaderLayout::size)
+            return -1;
+
+        ChunkHeader header;
+        ChunkHeaderLayout::Decode(header, wire.data() + in);
+        in += ChunkHeaderLayout::size;
+
+        size_t rawSize = fileData.size() - out;
+        if (rawSize > COMPRESSION_CHUNK_SIZE)
+            rawSize = COMPRESSION_CHUNK_SIZE;
+
+        if (header.storedSize > wire.size() - in)
+            return -1;
+
+        if (header.kind == CHUNK_RAW)
+        {
+            if (header.storedSize != rawSize)
+                return -1;
+            memcpy(fileData.data() + out, wire.data() + in, rawSize);
+        }
+        else if (header.kind == CHUNK_LZ4)
+        {
+            int produced = DecompressChunk(wire.data() + in, (int)header.storedSize, fileData.data() + out, (int)rawSize);
+            if (produced != (int)rawSize)
+                return -1;
+        }
+        else
+            return -1;
+
+        in += header.storedSize;
+        out += rawSize;
+    }
+
+    return 0;
+}
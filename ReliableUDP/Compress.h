@@ -0,0 +1,39 @@
+// File Name: Compress.h
+// Date: 2026-10
+// File Description:
+//      -- Optional payload compression stage for the file transfer.
+//      -- The file is cut into COMPRESSION_CHUNK_SIZE chunks; each chunk is compressed with an in-tree
+//      -- implementation of the LZ4 block format, or stored raw when it does not shrink (JPG, ZIP, ...).
+//      -- The resulting "wire image" (ChunkHeader + chunk bytes, repeated) is what gets sliced into BlockPackets.
+
+#ifndef _COMPRESS_H_
+#define _COMPRESS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Protocol.h"
+
+
+// Worst case size of one compressed chunk (incompressible input grows by ~1/255 plus a few bytes)
+#define LZ4_COMPRESS_BOUND(size) ((size) + (size) / 255 + 16)
+
+
+// Function Name: CompressChunk
+// Return Value: int - compressed size in bytes, or 0 if the output would not fit into dstCapacity
+int CompressChunk(const uint8_t* src, int srcSize, uint8_t* dst, int dstCapacity);
+
+// Function Name: DecompressChunk
+// Return Value: int - number of bytes written to dst, or -1 if the input is malformed
+int DecompressChunk(const uint8_t* src, int srcSize, uint8_t* dst, int dstSize);
+
+// Function Name: EncodeWireImage
+// Function Description: Compresses fileData chunk by chunk into wire; returns the number of chunks stored raw.
+size_t EncodeWireImage(const std::vector<uint8_t>& fileData, std::vector<uint8_t>& wire);
+
+// Function Name: DecodeWireImage
+// Function Description: Expands a wire image back into fileData (already sized to the original file size).
+// Return Value: int - 0 on success, -1 if the wire image is corrupt
+int DecodeWireImage(const std::vector<uint8_t>& wire, std::vector<uint8_t>& fileData);
+
+#endif // !_COMPRESS_H_
@@ -0,0 +1,269 @@
+// File Name: Delta.cpp
+// Date: 2026-10
+// File Description:
+//      -- Block signatures, the rolling match search over the new file and the delta stream encoder/decoder.
+
+#include "Delta.h"
+
+#include <cstring>
+#include <unordered_map>
+#include "md5.h"
+
+
+// Function Name: RollingChecksum
+// Parameters:
+//   - const uint8_t* data: window start
+//   - size_t size: window length
+// Return Value: uint32_t - weak checksum
+uint32_t RollingChecksum(const uint8_t* data, size_t size)
+{
+    uint32_t a = 0;
+    uint32_t b = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        a += data[i];
+        b += (uint32_t)(size - i) * data[i];
+    }
+    return (a & 0xFFFF) | (b << 16);
+}
+
+
+// Function Name: StrongChecksum
+// Parameters:
+//   - const uint8_t* data: block start
+//   - size_t size: block length
+// Return Value: uint64_t - first 8 bytes of MD5(data)
+uint64_t StrongChecksum(const uint8_t* data, size_t size)
+{
+    MD5Context ctx;
+    md5Init(&ctx);
+    md5Update(&ctx, const_cast<uint8_t*>(data), size);
+    md5Finalize(&ctx);
+    return wire::LoadBigEndian<uint64_t>(ctx.digest);
+}
+
+
+// Function Name: ComputeSignatures
+// Parameters:
+//   - const std::vector<uint8_t>& base: the receiver's existing copy
+//   - std::vector<BlockSignature>& signatures: one entry per full block (a short tail block is never matched)
+void ComputeSignatures(const std::vector<uint8_t>& base, std::vector<BlockSignature>& signatures)
+{
+    size_t blocks = base.size() / DELTA_BLOCK_SIZE;
+    signatures.resize(blocks);
+
+    for (size_t i = 0; i < blocks; i++)
+    {
+        const uint8_t* block = base.data() + i * DELTA_BLOCK_SIZE;
+        signatures[i].weak = RollingChecksum(block, DELTA_BLOCK_SIZE);
+        signatures[i].strong = StrongChecksum(block, DELTA_BLOCK_SIZE);
+    }
+}
+
+
+// Appends a pending literal run to the delta stream
+static void FlushLiteral(const uint8_t* data, size_t size, std::vector<uint8_t>& delta)
+{
+    while (size > 0)
+    {
+        DeltaLiteral op;
+        op.op = DELTA_OP_LITERAL;
+        op.length = (uint32_t)(size > 0xFFFFFFFFu ? 0xFFFFFFFFu : size);
+
+        size_t at = delta.size();
+        delta.resize(at + DeltaLiteralLayout::size + op.length);
+        DeltaLiteralLayout::Encode(op, delta.data() + at);
+        memcpy(delta.data() + at + DeltaLiteralLayout::size, data, op.length);
+
+        data += op.length;
+        size -= op.length;
+    }
+}
+
+// Appends a copy of base blocks [first, first + count) to the delta stream
+static void FlushCopy(uint64_t first, uint32_t count, std::vector<uint8_t>& delta)
+{
+    DeltaCopy op;
+    op.op = DELTA_OP_COPY;
+    op.first = first;
+    op.count = count;
+
+    size_t at = delta.size();
+    delta.resize(at + DeltaCopyLayout::size);
+    DeltaCopyLayout::Encode(op, delta.data() + at);
+}
+
+
+
+// Function Name: EncodeDelta
+// Parameters:
+//   - const std::vector<uint8_t>& file: the new file
+//   - const std::vector<BlockSignature>& signatures: signatures of the receiver's copy
+//   - const std::vector<uint8_t>& known: 1 for each signature that was received
+//   - std::vector<uint8_t>& delta: receives the delta stream
+// Return Value: uint64_t - bytes of the new file that will be copied from the receiver's copy
+// Function Description:
+//      -- Classic rsync search: the weak checksum is rolled one byte at a time; a weak hit is confirmed with
+//      -- the strong checksum before emitting a COPY. Consecutive block copies are merged into one instruction.
+uint64_t EncodeDelta(const std::vector<uint8_t>& file, const std::vector<BlockSignature>& signatures,
+    const std::vector<uint8_t>& known, std::vector<uint8_t>& delta)
+{
+    delta.clear();
+
+    std::unordered_multimap<uint32_t, uint64_t> lookup;
+    for (size_t i = 0; i < signatures.size(); i++)
+    {
+        if (i < known.size() && known[i])
+            lookup.emplace(signatures[i].weak, (uint64_t)i);
+    }
+
+    const size_t size = file.size();
+    const uint8_t* data = file.data();
+
+    uint64_t copied = 0;
+    size_t literalStart = 0;
+    uint64_t copyFirst = 0;
+    uint32_t copyCount = 0;
+
+    size_t pos = 0;
+    uint32_t a = 0;
+    uint32_t b = 0;
+    bool windowValid = false;
+
+    while (!lookup.empty() && pos + DELTA_BLOCK_SIZE <= size)
+    {
+        if (!windowValid)
+        {
+            uint32_t weak = RollingChecksum(data + pos, DELTA_BLOCK_SIZE);
+            a = weak & 0xFFFF;
+            b = weak >> 16;
+            windowValid = true;
+        }
+
+        uint32_t weak = (a & 0xFFFF) | (b << 16);
+        bool matched = false;
+
+        auto range = lookup.equal_range(weak);
+        if (range.first != range.second)
+        {
+            uint64_t strong = StrongChecksum(data + pos, DELTA_BLOCK_SIZE);
+
+            // prefer the block that continues the current copy run
+            uint64_t match = 0;
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (signatures[(size_t)it->second].strong != strong)
+                    continue;
+                if (!matched || (copyCount > 0 && it->second == copyFirst + copyCount))
+                    match = it->second;
+                matched = true;
+            }
+
+            if (matched)
+            {
+                if (pos > literalStart)
+                {
+                    if (copyCount > 0)
+                    {
+                        FlushCopy(copyFirst, copyCount, delta);
+                        copyCount = 0;
+                    }
+                    FlushLiteral(data + literalStart, pos - literalStart, delta);
+                }
+
+                if (copyCount > 0 && match == copyFirst + copyCount && copyCount < 0xFFFFFFFFu)
+                    copyCount++;
+                else
+                {
+                    if (copyCount > 0)
+                        FlushCopy(copyFirst, copyCount, delta);
+                    copyFirst = match;
+                    copyCount = 1;
+                }
+
+                copied += DELTA_BLOCK_SIZE;
+                pos += DELTA_BLOCK_SIZE;
+                literalStart = pos;
+                windowValid = false;
+            }
+        }
+
+        if (!matched)
+        {
+            // roll the window one byte forward
+            if (pos + DELTA_BLOCK_SIZE < size)
+            {
+                uint8_t out = data[pos];
+                uint8_t in = data[pos + DELTA_BLOCK_SIZE];
+                a = (a - out + in) & 0xFFFF;
+                b = (b - (uint32_t)DELTA_BLOCK_SIZE * out + a) & 0xFFFF;
+            }
+            pos++;
+        }
+    }
+
+    // a pending copy run always precedes the pending literal bytes
+    if (copyCount > 0)
+        FlushCopy(copyFirst, copyCount, delta);
+    FlushLiteral(data + literalStart, size - literalStart, delta);
+
+    return copied;
+}
+
+
+
+// Function Name: ApplyDelta
+// Parameters:
+//   - const std::vector<uint8_t>& base: the receiver's existing copy
+//   - const std::vector<uint8_t>& delta: the received delta stream
+//   - std::vector<uint8_t>& fileData: output, already sized to the new file size
+// Return Value: int - 0 on success, -1 if the delta stream is malformed
+int ApplyDelta(const std::vector<uint8_t>& base, const std::vector<uint8_t>& delta, std::vector<uint8_t>& fileData)
+{
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < delta.size())
+    {
+        uint8_t op = delta[in];
+
+        if (op == DELTA_OP_COPY)
+        {
+            if (delta.size() - in < DeltaCopyLayout::size)
+                return -1;
+            DeltaCopy copy;
+            DeltaCopyLayout::Decode(copy, delta.data() + in);
+            in += DeltaCopyLayout::size;
+
+            uint64_t blocks = base.size() / DELTA_BLOCK_SIZE;
+            if (copy.first > blocks || copy.count > blocks - copy.first)
+                return -1;
+
+            size_t bytes = (size_t)copy.count * DELTA_BLOCK_SIZE;
+            if (bytes > fileData.size() - out)
+                return -1;
+
+            memcpy(fileData.data() + out, base.data() + copy.first * DELTA_BLOCK_SIZE, bytes);
+            out += bytes;
+        }
+        else if (op == DELTA_OP_LITERAL)
+        {
+            if (delta.size() - in < DeltaLiteralLayout::size)
+                return -1;
+            DeltaLiteral literal;
+            DeltaLiteralLayout::Decode(literal, delta.data() + in);
+            in += DeltaLiteralLayout::size;
+
+            if (literal.length > delta.size() - in || literal.length > fileData.size() - out)
+                return -1;
+
+            memcpy(fileData.data() + out, delta.data() + in, literal.length);
+            in += literal.length;
+            out += literal.length;
+        }
+        else
+            return -1;
+    }
+
+    return out == fileData.size() ? 0 : -1;
+}
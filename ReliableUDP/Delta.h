@@ -0,0 +1,51 @@
+// File Name: Delta.h
+// Date: 2026-10
+// File Description:
+//      -- rsync-like delta encoding for files the receiver already has an older copy of.
+//      -- The receiver signs every DELTA_BLOCK_SIZE block of its copy (rolling weak checksum + truncated MD5),
+//      -- the sender slides a window over the new file looking for those blocks and produces a delta stream of
+//      -- COPY (block range of the old copy) and LITERAL (new bytes) instructions, which is what gets sent.
+
+#ifndef _DELTA_H_
+#define _DELTA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Protocol.h"
+
+
+// Signature of one DELTA_BLOCK_SIZE block of the receiver's copy
+struct BlockSignature
+{
+    uint32_t  weak; // rolling checksum
+    uint64_t  strong; // first 8 bytes of the block's MD5
+};
+
+
+// Function Name: RollingChecksum
+// Function Description: rsync weak checksum of a whole window: (sum x) | (sum (len - i) * x) << 16
+uint32_t RollingChecksum(const uint8_t* data, size_t size);
+
+// Function Name: StrongChecksum
+// Function Description: First 8 bytes of the MD5 of data, as an integer
+uint64_t StrongChecksum(const uint8_t* data, size_t size);
+
+// Function Name: ComputeSignatures
+// Function Description: Signs every full DELTA_BLOCK_SIZE block of base
+void ComputeSignatures(const std::vector<uint8_t>& base, std::vector<BlockSignature>& signatures);
+
+// Function Name: EncodeDelta
+// Function Description:
+//      -- Builds the delta stream turning the receiver's copy into file. known[i] is 0 for signatures that never
+//      -- arrived; those blocks are simply not matched.
+// Return Value: uint64_t - number of file bytes covered by COPY instructions
+uint64_t EncodeDelta(const std::vector<uint8_t>& file, const std::vector<BlockSignature>& signatures,
+    const std::vector<uint8_t>& known, std::vector<uint8_t>& delta);
+
+// Function Name: ApplyDelta
+// Function Description: Rebuilds fileData (already sized to the new file size) from base and the delta stream
+// Return Value: int - 0 on success, -1 if the delta stream is malformed or does not fit
+int ApplyDelta(const std::vector<uint8_t>& base, const std::vector<uint8_t>& delta, std::vector<uint8_t>& fileData);
+
+#endif // !_DELTA_H_
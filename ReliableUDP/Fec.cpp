@@ -0,0 +1,282 @@
+// File Name: Fec.cpp
+// Date: 2026-10
+// File Description:
+//      -- GF(2^8) arithmetic (polynomial 0x11d) and the XOR / Cauchy Reed-Solomon group codes.
+//      -- The region multiply uses the split nibble table technique: c * x = lo[x & 15] ^ hi[x >> 4],
+//      -- which maps onto one PSHUFB per 16 bytes when SSSE3 is available.
+
+#include "Fec.h"
+
+#include <cassert>
+#include <cstring>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+
+// Class Name: GaloisTables
+// Class Description: Log/exp, full product and nibble product tables, built once on first use.
+class GaloisTables
+{
+public:
+
+    uint8_t exp[512];
+    uint8_t log[256];
+    uint8_t mul[256][256];
+    uint8_t mulLo[256][16];  // c * (x & 0x0f)
+    uint8_t mulHi[256][16];  // c * (x & 0xf0)
+
+    GaloisTables()
+    {
+        unsigned int x = 1;
+        for (int i = 0; i < 255; i++)
+        {
+            exp[i] = (uint8_t)x;
+            log[x] = (uint8_t)i;
+            x <<= 1;
+            if (x & 0x100)
+                x ^= 0x11d;
+        }
+        for (int i = 255; i < 512; i++)
+            exp[i] = exp[i - 255];
+        log[0] = 0;
+
+        for (int a = 0; a < 256; a++)
+        {
+            for (int b = 0; b < 256; b++)
+                mul[a][b] = (a == 0 || b == 0) ? 0 : exp[log[a] + log[b]];
+
+            for (int n = 0; n < 16; n++)
+            {
+                mulLo[a][n] = mul[a][n];
+                mulHi[a][n] = mul[a][n << 4];
+            }
+        }
+    }
+
+    uint8_t Inverse(uint8_t a) const
+    {
+        assert(a != 0);
+        return exp[255 - log[a]];
+    }
+};
+
+static const GaloisTables& Gf()
+{
+    static const GaloisTables tables;
+    return tables;
+}
+
+
+
+// Function Name: FecCoefficient
+// Parameters:
+//   - uint8_t scheme: FEC_XOR or FEC_REED_SOLOMON
+//   - int parityIndex: row (0 .. M-1)
+//   - int dataIndex: column (0 .. K-1)
+//   - int groupSize: K
+// Return Value: uint8_t - matrix entry
+// Function Description:
+//      -- XOR parity is the all-ones row. Reed-Solomon uses the Cauchy matrix 1 / (x_j + y_i) with
+//      -- x_j = K + j and y_i = i; every square submatrix of a Cauchy matrix is invertible, so any K of the
+//      -- K + M blocks are enough to rebuild the group.
+uint8_t FecCoefficient(uint8_t scheme, int parityIndex, int dataIndex, int groupSize)
+{
+    if (scheme == FEC_XOR)
+        return 1;
+
+    assert(groupSize + parityIndex < 256);
+    return Gf().Inverse((uint8_t)((groupSize + parityIndex) ^ dataIndex));
+}
+
+
+
+// Function Name: FecMulAdd
+// Parameters:
+//   - uint8_t* dst: accumulator region
+//   - const uint8_t* src: source region
+//   - uint8_t c: constant factor
+//   - size_t size: region size in bytes
+void FecMulAdd(uint8_t* dst, const uint8_t* src, uint8_t c, size_t size)
+{
+    if (c == 0)
+        return;
+
+    size_t i = 0;
+
+    if (c == 1)
+    {
+        for (; i < size; i++)
+            dst[i] ^= src[i];
+        return;
+    }
+
+    const GaloisTables& gf = Gf();
+
+#if defined(__SSSE3__)
+    const __m128i lo = _mm_loadu_si128((const __m128i*)gf.mulLo[c]);
+    const __m128i hi = _mm_loadu_si128((const __m128i*)gf.mulHi[c]);
+    const __m128i mask = _mm_set1_epi8(0x0f);
+
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i l = _mm_shuffle_epi8(lo, _mm_and_si128(x, mask));
+        __m128i h = _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi64(x, 4), mask));
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(d, _mm_xor_si128(l, h)));
+    }
+#endif
+
+    const uint8_t* row = gf.mul[c];
+    for (; i < size; i++)
+        dst[i] ^= row[src[i]];
+}
+
+
+
+// Function Name: FecEncodeGroup
+// Parameters:
+//   - uint8_t scheme: FEC_XOR or FEC_REED_SOLOMON
+//   - const uint8_t* const* data: groupSize data blocks
+//   - int groupSize: number of data blocks in this group (the last group may be short)
+//   - uint8_t* const* parity: parityCount output blocks
+//   - int parityCount: number of parity blocks
+//   - size_t blockSize: bytes per block
+void FecEncodeGroup(uint8_t scheme, const uint8_t* const* data, int groupSize,
+    uint8_t* const* parity, int parityCount, size_t blockSize)
+{
+    for (int j = 0; j < parityCount; j++)
+    {
+        memset(parity[j], 0, blockSize);
+        for (int i = 0; i < groupSize; i++)
+            FecMulAdd(parity[j], data[i], FecCoefficient(scheme, j, i, groupSize), blockSize);
+    }
+}
+
+
+
+// Function Name: FecDecodeGroup
+// Parameters:
+//   - uint8_t scheme: FEC_XOR or FEC_REED_SOLOMON
+//   - uint8_t* const* data: groupSize data blocks; missing ones are overwritten with the rebuilt bytes
+//   - const bool* dataPresent: which data blocks were received
+//   - int groupSize: number of data blocks in this group
+//   - const uint8_t* const* parity: parityCount parity blocks
+//   - const bool* parityPresent: which parity blocks were received
+//   - int parityCount: number of parity blocks
+//   - size_t blockSize: bytes per block
+// Return Value: bool - true on success
+// Function Description:
+//      -- For e missing blocks, take e received parity rows, subtract the known data from them (syndromes)
+//      -- and solve the e x e system by inverting the coefficient submatrix with Gauss-Jordan elimination.
+bool FecDecodeGroup(uint8_t scheme, uint8_t* const* data, const bool* dataPresent, int groupSize,
+    const uint8_t* const* parity, const bool* parityPresent, int parityCount, size_t blockSize)
+{
+    int missing[FEC_MAX_PARITY_COUNT];
+    int rows[FEC_MAX_PARITY_COUNT];
+    int missingCount = 0;
+    int rowCount = 0;
+
+    for (int i = 0; i < groupSize; i++)
+    {
+        if (!dataPresent[i])
+        {
+            if (missingCount == FEC_MAX_PARITY_COUNT)
+                return false;
+            missing[missingCount++] = i;
+        }
+    }
+
+    if (missingCount == 0)
+        return true;
+
+    for (int j = 0; j < parityCount && rowCount < missingCount; j++)
+    {
+        if (parityPresent[j])
+            rows[rowCount++] = j;
+    }
+
+    if (rowCount < missingCount)
+        return false;
+
+    const GaloisTables& gf = Gf();
+    const int e = missingCount;
+
+    if (blockSize > FEC_MAX_BLOCK_SIZE)
+        return false;
+
+    // syndromes: parity row minus the contribution of every received data block
+    static thread_local uint8_t syndrome[FEC_MAX_PARITY_COUNT][FEC_MAX_BLOCK_SIZE];
+
+    for (int r = 0; r < e; r++)
+    {
+        memcpy(syndrome[r], parity[rows[r]], blockSize);
+        for (int i = 0; i < groupSize; i++)
+        {
+            if (dataPresent[i])
+                FecMulAdd(syndrome[r], data[i], FecCoefficient(scheme, rows[r], i, groupSize), blockSize);
+        }
+    }
+
+    // invert the e x e submatrix A[r][c] = coefficient(rows[r], missing[c])
+    uint8_t a[FEC_MAX_PARITY_COUNT][FEC_MAX_PARITY_COUNT];
+    uint8_t inv[FEC_MAX_PARITY_COUNT][FEC_MAX_PARITY_COUNT];
+    for (int r = 0; r < e; r++)
+    {
+        for (int c = 0; c < e; c++)
+        {
+            a[r][c] = FecCoefficient(scheme, rows[r], missing[c], groupSize);
+            inv[r][c] = (r == c) ? 1 : 0;
+        }
+    }
+
+    for (int col = 0; col < e; col++)
+    {
+        int pivot = col;
+        while (pivot < e && a[pivot][col] == 0)
+            pivot++;
+        if (pivot == e)
+            return false; // singular (only possible with XOR parity and more than one loss)
+
+        if (pivot != col)
+        {
+            for (int c = 0; c < e; c++)
+            {
+                uint8_t t = a[col][c]; a[col][c] = a[pivot][c]; a[pivot][c] = t;
+                t = inv[col][c]; inv[col][c] = inv[pivot][c]; inv[pivot][c] = t;
+            }
+        }
+
+        uint8_t scale = gf.Inverse(a[col][col]);
+        for (int c = 0; c < e; c++)
+        {
+            a[col][c] = gf.mul[scale][a[col][c]];
+            inv[col][c] = gf.mul[scale][inv[col][c]];
+        }
+
+        for (int r = 0; r < e; r++)
+        {
+            uint8_t factor = a[r][col];
+            if (r == col || factor == 0)
+                continue;
+            for (int c = 0; c < e; c++)
+            {
+                a[r][c] ^= gf.mul[factor][a[col][c]];
+                inv[r][c] ^= gf.mul[factor][inv[col][c]];
+            }
+        }
+    }
+
+    // missing block m = sum over r of inv[m][r] * syndrome[r]
+    for (int m = 0; m < e; m++)
+    {
+        uint8_t* out = data[missing[m]];
+        memset(out, 0, blockSize);
+        for (int r = 0; r < e; r++)
+            FecMulAdd(out, syndrome[r], inv[m][r], blockSize);
+    }
+
+    return true;
+}
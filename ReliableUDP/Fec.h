@@ -0,0 +1,45 @@
+// File Name: Fec.h
+// Date: 2026-10
+// File Description:
+//      -- Forward error correction for groups of BlockPackets.
+//      -- For every group of K data blocks the sender emits M parity blocks. With FEC_XOR (M = 1) any single
+//      -- lost block of the group can be rebuilt; with FEC_REED_SOLOMON (systematic Cauchy code over GF(2^8))
+//      -- any M lost blocks can be rebuilt, without waiting a round trip for a retransmission.
+
+#ifndef _FEC_H_
+#define _FEC_H_
+
+#include <cstddef>
+#include <cstdint>
+
+
+#define FEC_NONE          0
+#define FEC_XOR           1
+#define FEC_REED_SOLOMON  2
+
+#define FEC_MAX_GROUP_SIZE   64   // K
+#define FEC_MAX_PARITY_COUNT 16   // M
+#define FEC_MAX_BLOCK_SIZE   1024 // bytes per block the decoder can handle
+
+
+// Function Name: FecCoefficient
+// Return Value: uint8_t - weight of data block dataIndex in parity block parityIndex
+uint8_t FecCoefficient(uint8_t scheme, int parityIndex, int dataIndex, int groupSize);
+
+// Function Name: FecMulAdd
+// Function Description: dst[i] ^= c * src[i] in GF(2^8) (SSSE3 nibble tables when available)
+void FecMulAdd(uint8_t* dst, const uint8_t* src, uint8_t c, size_t size);
+
+// Function Name: FecEncodeGroup
+// Function Description: Computes parityCount parity blocks of blockSize bytes from groupSize data blocks.
+void FecEncodeGroup(uint8_t scheme, const uint8_t* const* data, int groupSize,
+    uint8_t* const* parity, int parityCount, size_t blockSize);
+
+// Function Name: FecDecodeGroup
+// Function Description:
+//      -- Rebuilds the data blocks whose dataPresent flag is false in place, using the present parity blocks.
+// Return Value: bool - true if every missing block was rebuilt, false if too few blocks survived
+bool FecDecodeGroup(uint8_t scheme, uint8_t* const* data, const bool* dataPresent, int groupSize,
+    const uint8_t* const* parity, const bool* parityPresent, int parityCount, size_t blockSize);
+
+#endif // !_FEC_H_
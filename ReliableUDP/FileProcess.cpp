@@ -6,6 +6,8 @@
 //   and reassemble received blocks back into a complete file.
 
 #include "FileProcess.h"
+#include "Log.h"
+#include "Trace.h"
 
 
 
@@ -14,27 +16,45 @@
 // Return Value: int - Returns 0 on success, -1 if an error occurs (e.g., file cannot be opened or written).
 // Description:
 //      -- Saves the received file data to disk using the filename stored in `metaPacket`.
-int FileBlock::SaveFile() const
+int FileBlock::SaveFile()
 {
-    // Open output file using the filename from metaPacket in binary mode.
-    ofstream outFile(metaPacket.filename, ios::binary);
-    if (!outFile)
+    const string path = OutputPath();
+
+    // Through the io_uring backend: chunked writes queued on the ring
+    if (ioRing != nullptr)
     {
-        fprintf(stderr, "Error: Cannot open file for writing: %s\n", metaPacket.filename);
-        return -1;
+        TraceSpan span(TRACE_DISK_WRITE, fileData.size());
+        if (IoRingWriteFile(*ioRing, path.c_str(), fileData.data(), fileData.size()) != 0)
+            return -1;
     }
-
-    // Write the entire fileData vector to the file.
-    outFile.write(reinterpret_cast<const char*>(fileData.data()), fileData.size());
-    if (!outFile)
+    else
     {
-        fprintf(stderr, "Error: Failed to write all data to file: %s\n", metaPacket.filename);
-        return -1;
+        // Open output file using the filename from metaPacket in binary mode.
+        ofstream outFile(path, ios::binary);
+        if (!outFile)
+        {
+            LOG_ERROR("Error: Cannot open file for writing: %s", path.c_str());
+            return -1;
+        }
+
+        // Write the entire fileData vector to the file.
+        {
+            TraceSpan span(TRACE_DISK_WRITE, fileData.size());
+            outFile.write(reinterpret_cast<const char*>(fileData.data()), fileData.size());
+            if (!outFile)
+            {
+                LOG_ERROR("Error: Failed to write all data to file: %s", path.c_str());
+                return -1;
+            }
+            outFile.close();
+        }
     }
-    outFile.close();
 
     // Debug: print success message and number of bytes written.
-    printf("File saved successfully: %s, %zu bytes written.\n", metaPacket.filename, fileData.size());
+    LOG_INFO("File saved successfully: %s, %zu bytes written.", path.c_str(), fileData.size());
+
+    // The partial transfer is complete, drop its journal
+    journal.Discard();
 
     return 0;
 }
@@ -60,25 +80,26 @@ bool FileBlock::VerifyFileContent()
     // Compare the computed MD5 with the metaPacket's MD5.
     if (memcmp(metaPacket.md5, computedMD5, MD5_HASH_LENGTH) == 0)
     {
-        printf("Checksum verification successful!\n");
+        LOG_INFO("Checksum verification successful!");
         return true;
     }
     else
     {
-        printf("!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!\n");
-        printf("Checksum verification failed.\n");
-        printf("Computed MD5: ");
+        char computedHex[MD5_HASH_LENGTH * 2 + 1];
+        char expectedHex[MD5_HASH_LENGTH * 2 + 1];
         for (int i = 0; i < MD5_HASH_LENGTH; i++)
         {
-            printf("%02x", computedMD5[i]);
+            snprintf(computedHex + i * 2, 3, "%02x", computedMD5[i]);
+            snprintf(expectedHex + i * 2, 3, "%02x", metaPacket.md5[i]);
         }
-        printf("\nExpected MD5: ");
-        for (int i = 0; i < MD5_HASH_LENGTH; i++)
-        {
-            printf("%02x", metaPacket.md5[i]);
-        }
-        printf("\n");
-        printf("!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!\n");
+        LOG_ERROR("!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
+        LOG_ERROR("Checksum verification failed.");
+        LOG_ERROR("Computed MD5: %s", computedHex);
+        LOG_ERROR("Expected MD5: %s", expectedHex);
+        LOG_ERROR("!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
+
+        // Do not resume from data that failed verification
+        journal.Discard();
         return false;
     }
 }
@@ -108,7 +129,7 @@ int FileBlock::ProcessReceivedPacket(const unsigned char* packet, size_t packetS
     // Check that the packet is valid and has at least one full packet's size.
     if (packet == nullptr || packetSize < PACKET_SIZE)
     {
-        fprintf(stderr, "Invalid packet received.\n");
+        LOG_LIMITED(LOG_LEVEL_WARN, 10, "Invalid packet received.");
         return -1;
     }
 
@@ -118,66 +139,674 @@ int FileBlock::ProcessReceivedPacket(const unsigned char* packet, size_t packetS
     // If the packet type is Meta, update the metaPacket and allocate fileData.
     if (packetType == TYPE_META)
     {
-        // Interpret packet as MetaPacket
-        const MetaPacket* meta = reinterpret_cast<const MetaPacket*>(packet);
+        // The sender repeats its MetaPacket until one copy is acked; a repeat must not restart the transfer
+        if (metaPacket.packetType == TYPE_META)
+        {
+            unsigned char current[PACKET_SIZE] = { 0 };
+            MetaPacketLayout::Encode(metaPacket, current);
+            if (memcmp(current, packet, MetaPacketLayout::size) == 0)
+            {
+                LOG_DEBUG("Repeated Meta Packet ignored: %s", metaPacket.filename);
+                return 0;
+            }
+        }
 
-        // Update the internal metaPacket member (copy all fields)
-        metaPacket = *meta;
+        // Decode the wire layout into the internal metaPacket member
+        MetaPacketLayout::Decode(metaPacket, packet);
+        metaPacket.filename[MAX_FILENAME_LENGTH - 1] = '\0';
 
         // print debug message
-        printf("Received Meta Packet: filename = %s, fileSize = %llu, totalBlocks = %llu\n",
+        LOG_INFO("Received Meta Packet: filename = %s, fileSize = %llu, totalBlocks = %llu",
             metaPacket.filename,
             (unsigned long long)metaPacket.fileSize,
             (unsigned long long)metaPacket.totalBlocks);
 
+        // The first MetaPacket of a delta transfer only asks for the signatures of our copy of the file
+        if (metaPacket.flags & META_FLAG_SIGNATURE_REQUEST)
+        {
+            BuildSignaturePackets();
+            return 0;
+        }
+
         // Allocate fileData space according to metaPacket.fileSize to hold the entire file contents.
+        // A compressed or delta transfer is first reassembled into wireData and expanded once the last block arrives.
+        if (metaPacket.flags & (META_FLAG_COMPRESSED | META_FLAG_DELTA))
+        {
+            LOG_INFO("Transfer is %s: %llu bytes on the wire",
+                (metaPacket.flags & META_FLAG_DELTA) ? "a delta" : "compressed", (unsigned long long)metaPacket.wireSize);
+            wireData.resize(static_cast<size_t>(metaPacket.wireSize));
+        }
+        else
+        {
+            wireData.clear();
+        }
         fileData.resize(static_cast<size_t>(metaPacket.fileSize));
 
+        // Reset block tracking and the FEC parity store
+        received.assign(static_cast<size_t>(metaPacket.totalBlocks), 0);
+        receivedCount = 0;
+        recoveredCount = 0;
+        parityData.clear();
+        parityReceived.clear();
+        flowEnded.assign(metaPacket.flowCount > 1 ? metaPacket.flowCount : 1, 0);
+        flowsEnded = 0;
+        if (metaPacket.fecScheme != FEC_NONE)
+        {
+            if (metaPacket.fecGroupSize == 0 || metaPacket.fecGroupSize > FEC_MAX_GROUP_SIZE ||
+                metaPacket.fecParityCount == 0 || metaPacket.fecParityCount > FEC_MAX_PARITY_COUNT)
+            {
+                LOG_WARN("Unsupported FEC parameters, ignoring parity packets.");
+                metaPacket.fecScheme = FEC_NONE;
+            }
+            else
+            {
+                uint64_t groups = (metaPacket.totalBlocks + metaPacket.fecGroupSize - 1) / metaPacket.fecGroupSize;
+                parityData.resize(static_cast<size_t>(groups * metaPacket.fecParityCount * PAYLOAD_SIZE));
+                parityReceived.assign(static_cast<size_t>(groups * metaPacket.fecParityCount), 0);
+                LOG_INFO("FEC enabled: scheme %d, %d parity per %d blocks",
+                    metaPacket.fecScheme, metaPacket.fecParityCount, metaPacket.fecGroupSize);
+            }
+        }
+
+        // A resumable transfer restores what an earlier run already received and tells the sender about it
+        replyPackets.clear();
+        replyNext = 0;
+        if (metaPacket.flags & META_FLAG_RESUME)
+        {
+            receivedCount = journal.Open(metaPacket, OutputPath(), WireBuffer(), received);
+            BuildResumePackets();
+
+            if (receivedCount == metaPacket.totalBlocks)
+                CompleteTransfer();
+        }
+
         return 0;
     }
     // If the packet type is Data, store the payload into the correct position in fileData.
     else if (packetType == TYPE_DATA)
     {
-        // Interpret packet as BlockPacket
-        const BlockPacket* block = reinterpret_cast<const BlockPacket*>(packet);
-
-        // offset = localSequence * PAYLOAD_SIZE
-        uint64_t seq = block->localSequence;
-        size_t offset = static_cast<size_t>(seq * PAYLOAD_SIZE);
+        // Decode the fixed header fields; the payload is copied straight out of the packet below
+        uint64_t seq = wire::LoadBigEndian<uint64_t>(packet + BlockPacketLayout::OffsetOf<1>());
+        const unsigned char* payLoad = packet + BlockPacketLayout::OffsetOf<2>();
 
-        // Determine the number of bytes of data to be copied
-        // For the last block, the actual data may be less than PAYLOAD_SIZE
-        size_t copySize = PAYLOAD_SIZE;
-        if (offset + copySize > fileData.size())
-            copySize = fileData.size() - offset;
+        // Ignore sequences outside of the announced file
+        if (seq >= metaPacket.totalBlocks)
+        {
+            LOG_LIMITED(LOG_LEVEL_WARN, 10, "Data packet out of range: localSequence = %llu", (unsigned long long)seq);
+            return -1;
+        }
 
-        // Copy the payLoad data from the current block to the correct location in fileData.
-        memcpy(fileData.data() + offset, block->payLoad, copySize);
+        StoreBlock(seq, payLoad);
 
         // print debug message
-        printf("Received Data Packet: localSequence = %llu, copied %zu bytes\n",
-            (unsigned long long)seq, copySize);
+        LOG_TRACE("Received Data Packet: localSequence = %llu", (unsigned long long)seq);
+
+        if (metaPacket.fecScheme != FEC_NONE)
+            RecoverGroup(seq / metaPacket.fecGroupSize);
+
+        // Check if Received all of data (or the last packet the sender will send on every flow)
+        if (receivedCount == metaPacket.totalBlocks ||
+            (metaPacket.fecScheme == FEC_NONE && seq + 1 == FlowEnd(seq) && EndFlow(seq)))
+        {
+            CompleteTransfer();
+        }
+
+        return 0;
+    }
+    // If the packet type is Parity, keep the parity payload and try to rebuild the group.
+    else if (packetType == TYPE_PARITY && metaPacket.fecScheme != FEC_NONE)
+    {
+        uint32_t group = wire::LoadBigEndian<uint32_t>(packet + ParityPacketLayout::OffsetOf<1>());
+        uint8_t index = packet[ParityPacketLayout::OffsetOf<2>()];
+
+        size_t slot = static_cast<size_t>(group) * metaPacket.fecParityCount + index;
+        if (index >= metaPacket.fecParityCount || slot >= parityReceived.size())
+        {
+            LOG_LIMITED(LOG_LEVEL_WARN, 10, "Parity packet out of range: group = %u, index = %d", group, index);
+            return -1;
+        }
+
+        memcpy(parityData.data() + slot * PAYLOAD_SIZE, packet + PARITY_PAYLOAD_OFFSET, PAYLOAD_SIZE);
+        parityReceived[slot] = 1;
 
+        RecoverGroup(group);
 
-        // Check if Received all of data
-        if (block->localSequence == metaPacket.totalBlocks - 1)
+        // The last parity packet of a flow's last group is the final packet the sender emits on that flow
+        uint64_t first = static_cast<uint64_t>(group) * metaPacket.fecGroupSize;
+        uint64_t lastSlot = ((FlowEnd(first) - 1) / metaPacket.fecGroupSize + 1) * metaPacket.fecParityCount - 1;
+        if (receivedCount == metaPacket.totalBlocks || (slot == lastSlot && EndFlow(first)))
         {
-            allDone = 0;
+            CompleteTransfer();
         }
 
         return 0;
     }
+    // If the packet type is Resume (sender side), remember which blocks the receiver already has.
+    else if (packetType == TYPE_RESUME && resume)
+    {
+        ResumePacket reply;
+        ResumePacketLayout::Decode(reply, packet);
+
+        int ranges = reply.rangeCount < RESUME_MAX_RANGES ? reply.rangeCount : RESUME_MAX_RANGES;
+        for (int i = 0; i < ranges; i++)
+        {
+            for (uint64_t seq = reply.rangeFirst[i]; seq - reply.rangeFirst[i] < reply.rangeLength[i] && seq < peerHas.size(); seq++)
+                peerHas[static_cast<size_t>(seq)] = 1;
+        }
+
+        if (reply.last)
+        {
+            resumeNegotiated = true;
+            LOG_INFO("Resume negotiated: receiver already has %zu of %zu blocks.",
+                (size_t)count(peerHas.begin(), peerHas.end(), 1), peerHas.size());
+        }
+
+        return 0;
+    }
+    // If the packet type is Signature (sender side), collect the signatures of the receiver's copy.
+    else if (packetType == TYPE_SIGNATURE && delta)
+    {
+        SignaturePacket reply;
+        SignaturePacketLayout::Decode(reply, packet);
+
+        int count = reply.count < SIGNATURES_PER_PACKET ? reply.count : SIGNATURES_PER_PACKET;
+        if (reply.firstIndex + count > DELTA_MAX_SIGNATURES)
+        {
+            LOG_LIMITED(LOG_LEVEL_WARN, 10, "Signature packet out of range: firstIndex = %llu", (unsigned long long)reply.firstIndex);
+            return -1;
+        }
+
+        size_t end = static_cast<size_t>(reply.firstIndex) + count;
+        if (end > peerSignatures.size())
+        {
+            peerSignatures.resize(end);
+            peerSignatureKnown.resize(end, 0);
+        }
+        for (int i = 0; i < count; i++)
+        {
+            size_t index = static_cast<size_t>(reply.firstIndex) + i;
+            peerSignatures[index].weak = reply.weak[i];
+            peerSignatures[index].strong = reply.strong[i];
+            if (!peerSignatureKnown[index])
+                signatureCount++;
+            peerSignatureKnown[index] = 1;
+        }
+
+        if (reply.last)
+            signaturesComplete = true;
+
+        return 0;
+    }
     else
     {
-        printf("Received unknown packet type: %d\n", packetType);
+        LOG_LIMITED(LOG_LEVEL_WARN, 10, "Received unknown packet type: %d", packetType);
         return -1;
     }
 }
 
 
-// Accessor of blocks
+// Function Name: StoreBlock
+// Parameters:
+//   - uint64_t seq: block index
+//   - const unsigned char* payLoad: PAYLOAD_SIZE bytes (zero padded for the last block)
+// Function Description:
+//      -- Copies the block into its place in the wire buffer; for the last block, the actual data may be less than PAYLOAD_SIZE.
+void FileBlock::StoreBlock(uint64_t seq, const unsigned char* payLoad)
+{
+    vector<uint8_t>& buffer = WireBuffer();
+
+    // offset = localSequence * PAYLOAD_SIZE
+    size_t offset = static_cast<size_t>(seq * PAYLOAD_SIZE);
+    size_t copySize = PAYLOAD_SIZE;
+    if (offset + copySize > buffer.size())
+        copySize = buffer.size() - offset;
+
+    memcpy(buffer.data() + offset, payLoad, copySize);
+
+    if (!received[static_cast<size_t>(seq)])
+    {
+        received[static_cast<size_t>(seq)] = 1;
+        receivedCount++;
+        journal.MarkReceived(seq, buffer);
+    }
+}
+
+
+// Function Name: RecoverGroup
+// Parameters:
+//   - uint64_t group: FEC group index
+// Function Description:
+//      -- If some blocks of the group are missing and at least as many parity blocks have arrived,
+//      -- rebuilds the missing blocks locally instead of waiting for the sender.
+void FileBlock::RecoverGroup(uint64_t group)
+{
+    const int k = metaPacket.fecGroupSize;
+    const int m = metaPacket.fecParityCount;
+    const uint64_t first = group * k;
+    if (first >= metaPacket.totalBlocks)
+        return;
+
+    int groupSize = k;
+    if (first + groupSize > metaPacket.totalBlocks)
+        groupSize = static_cast<int>(metaPacket.totalBlocks - first);
+
+    bool dataPresent[FEC_MAX_GROUP_SIZE];
+    bool parityPresent[FEC_MAX_PARITY_COUNT];
+    int missing = 0;
+    int parities = 0;
+
+    for (int i = 0; i < groupSize; i++)
+    {
+        dataPresent[i] = received[static_cast<size_t>(first + i)] != 0;
+        if (!dataPresent[i])
+            missing++;
+    }
+    for (int j = 0; j < m; j++)
+    {
+        parityPresent[j] = parityReceived[static_cast<size_t>(group * m + j)] != 0;
+        if (parityPresent[j])
+            parities++;
+    }
+
+    if (missing == 0 || parities < missing)
+        return;
+
+    // Work on zero padded copies so the short last block is handled like any other
+    static thread_local uint8_t blockCopies[FEC_MAX_GROUP_SIZE][PAYLOAD_SIZE];
+    uint8_t* data[FEC_MAX_GROUP_SIZE];
+    const uint8_t* parity[FEC_MAX_PARITY_COUNT];
+
+    const vector<uint8_t>& buffer = WireBuffer();
+    for (int i = 0; i < groupSize; i++)
+    {
+        data[i] = blockCopies[i];
+        memset(data[i], 0, PAYLOAD_SIZE);
+        if (dataPresent[i])
+        {
+            size_t offset = static_cast<size_t>((first + i) * PAYLOAD_SIZE);
+            size_t size = PAYLOAD_SIZE;
+            if (offset + size > buffer.size())
+                size = buffer.size() - offset;
+            memcpy(data[i], buffer.data() + offset, size);
+        }
+    }
+    for (int j = 0; j < m; j++)
+        parity[j] = parityData.data() + static_cast<size_t>(group * m + j) * PAYLOAD_SIZE;
+
+    if (!FecDecodeGroup(metaPacket.fecScheme, data, dataPresent, groupSize, parity, parityPresent, m, PAYLOAD_SIZE))
+        return;
+
+    for (int i = 0; i < groupSize; i++)
+    {
+        if (!dataPresent[i])
+        {
+            StoreBlock(first + i, data[i]);
+            recoveredCount++;
+            LOG_DEBUG("Recovered Data Packet from parity: localSequence = %llu", (unsigned long long)(first + i));
+        }
+    }
+}
+
+
+// Function Name: CompleteTransfer
+// Function Description:
+//      -- Expands the compressed wire image or applies the delta stream into fileData;
+//      -- a corrupt image is caught by VerifyFileContent.
+void FileBlock::CompleteTransfer()
+{
+    if (allDone == 0)
+        return;
+
+    if ((metaPacket.flags & META_FLAG_COMPRESSED) && DecodeWireImage(wireData, fileData) != 0)
+    {
+        LOG_ERROR("Failed to decompress received data.");
+    }
+    if ((metaPacket.flags & META_FLAG_DELTA) && ApplyDelta(baseData, wireData, fileData) != 0)
+    {
+        LOG_ERROR("Failed to apply delta to the existing copy.");
+    }
+    allDone = 0;
+}
+
+
+// Function Name: BuildResumePackets
+// Function Description:
+//      -- Run-length encodes the received flags into ranges of present blocks, RESUME_MAX_RANGES per packet.
+//      -- At least one packet is always produced so the sender learns that negotiation is over.
+void FileBlock::BuildResumePackets()
+{
+    replyPackets.clear();
+    replyNext = 0;
+
+    ResumePacket reply = {};
+    reply.packetType = TYPE_RESUME;
+
+    uint64_t seq = 0;
+    while (seq < metaPacket.totalBlocks)
+    {
+        if (!received[static_cast<size_t>(seq)])
+        {
+            seq++;
+            continue;
+        }
+
+        uint64_t first = seq;
+        while (seq < metaPacket.totalBlocks && received[static_cast<size_t>(seq)])
+            seq++;
+
+        if (reply.rangeCount == RESUME_MAX_RANGES)
+        {
+            QueueReplyPacket<ResumePacketLayout>(reply);
+            reply.rangeCount = 0;
+        }
+        reply.rangeFirst[reply.rangeCount] = first;
+        reply.rangeLength[reply.rangeCount] = seq - first;
+        reply.rangeCount++;
+    }
+
+    reply.last = 1;
+    QueueReplyPacket<ResumePacketLayout>(reply);
+}
+
+
+// Function Name: BuildSignaturePackets
+// Function Description:
+//      -- Loads our existing copy of metaPacket.filename (if any) as the delta base and queues the signatures
+//      -- of its blocks, SIGNATURES_PER_PACKET per packet, the final one flagged as last.
+void FileBlock::BuildSignaturePackets()
+{
+    replyPackets.clear();
+    replyNext = 0;
+    baseData.clear();
+
+    ifstream baseFile(OutputPath(), ios::binary | ios::ate);
+    if (baseFile)
+    {
+        baseData.resize(static_cast<size_t>(baseFile.tellg()));
+        baseFile.seekg(0, ios::beg);
+        baseFile.read(reinterpret_cast<char*>(baseData.data()), baseData.size());
+        if (!baseFile)
+            baseData.clear();
+    }
+    baseFile.close();
+
+    vector<BlockSignature> signatures;
+    ComputeSignatures(baseData, signatures);
+    LOG_INFO("Delta requested: signing %zu blocks of the existing %s", signatures.size(), metaPacket.filename);
+
+    SignaturePacket reply = {};
+    reply.packetType = TYPE_SIGNATURE;
+
+    for (size_t i = 0; i < signatures.size(); i++)
+    {
+        if (reply.count == SIGNATURES_PER_PACKET)
+        {
+            QueueReplyPacket<SignaturePacketLayout>(reply);
+            reply.firstIndex = i;
+            reply.count = 0;
+        }
+        reply.weak[reply.count] = signatures[i].weak;
+        reply.strong[reply.count] = signatures[i].strong;
+        reply.count++;
+    }
+
+    reply.last = 1;
+    QueueReplyPacket<SignaturePacketLayout>(reply);
+}
+
+
+// Function Name: NextReplyPacket
+// Parameters:
+//   - unsigned char* packet: PACKET_SIZE output buffer
+// Return Value: bool - true if a queued reply (ResumePacket / SignaturePacket) was copied into packet
+bool FileBlock::NextReplyPacket(unsigned char* packet)
+{
+    if (replyNext >= replyPackets.size())
+        return false;
+
+    memcpy(packet, replyPackets[replyNext].data(), PACKET_SIZE);
+    replyNext++;
+    return true;
+}
+
+
+// Function Name: Checkpoint
+// Function Description: Persists the blocks received since the last checkpoint (no-op unless resumable).
+void FileBlock::Checkpoint()
+{
+    journal.Checkpoint(WireBuffer());
+}
+
+
+// Function Name: SetResume
+// Parameters:
+//   - bool enable: true to negotiate already present blocks with the receiver
+void FileBlock::SetResume(bool enable)
+{
+    resume = enable;
+}
+
+
+// Function Name: ResumeNegotiated
+// Return Value: bool - true once the receiver's final ResumePacket has been processed
+bool FileBlock::ResumeNegotiated(void) const
+{
+    return resumeNegotiated;
+}
+
+
+// Function Name: PeerHasBlock
+// Parameters:
+//   - uint64_t seq: block index
+// Return Value: bool - true if the receiver already has the block and it does not need to be sent
+bool FileBlock::PeerHasBlock(uint64_t seq) const
+{
+    return seq < peerHas.size() && peerHas[static_cast<size_t>(seq)] != 0;
+}
+
+
+// Function Name: SetFec
+// Parameters:
+//   - uint8_t scheme: FEC_NONE, FEC_XOR or FEC_REED_SOLOMON
+//   - uint8_t groupSize: data blocks per group (K)
+//   - uint8_t parityCount: parity blocks per group (M, forced to 1 for FEC_XOR)
+void FileBlock::SetFec(uint8_t scheme, uint8_t groupSize, uint8_t parityCount)
+{
+    assert(scheme == FEC_NONE || (groupSize > 0 && groupSize <= FEC_MAX_GROUP_SIZE));
+    assert(scheme == FEC_NONE || (parityCount > 0 && parityCount <= FEC_MAX_PARITY_COUNT));
+
+    fecScheme = scheme;
+    fecGroupSize = scheme == FEC_NONE ? 0 : groupSize;
+    fecParityCount = scheme == FEC_NONE ? 0 : (scheme == FEC_XOR ? 1 : parityCount);
+}
+
+
+// Accessor of parity packets
 //
-vector<BlockPacket> FileBlock::GetBlocks(void)
+const vector<ParityPacket>& FileBlock::GetParityPackets(void) const
+{
+    return parityPackets;
+}
+
+
+// Accessor of the number of blocks rebuilt from parity
+//
+uint64_t FileBlock::GetRecoveredBlocks(void) const
+{
+    return recoveredCount;
+}
+
+
+// Accessor of the number of blocks received or rebuilt so far
+//
+uint64_t FileBlock::GetReceivedBlocks(void) const
+{
+    return receivedCount;
+}
+
+
+// Function Name: WireBuffer
+// Return Value: vector<uint8_t>& - wireData for compressed and delta transfers, fileData otherwise
+vector<uint8_t>& FileBlock::WireBuffer()
+{
+    return (metaPacket.flags & (META_FLAG_COMPRESSED | META_FLAG_DELTA)) ? wireData : fileData;
+}
+
+
+// Function Name: SendData
+// Return Value: const uint8_t* - the mapped file for a zero-copy raw transfer, WireBuffer otherwise
+const uint8_t* FileBlock::SendData()
+{
+    if (sourceFile.IsOpen() && !(metaPacket.flags & (META_FLAG_COMPRESSED | META_FLAG_DELTA)))
+        return sourceFile.Data();
+    return WireBuffer().data();
+}
+
+
+// Function Name: GetBlockPayload
+// Parameters:
+//   - uint64_t seq: block index, below metaPacket.totalBlocks
+//   - const uint8_t*& payload: set to the first payload byte of the block
+// Return Value: size_t - payload bytes; the last block may be shorter than PAYLOAD_SIZE (the rest is zero on the wire)
+size_t FileBlock::GetBlockPayload(uint64_t seq, const uint8_t*& payload)
+{
+    assert(seq < metaPacket.totalBlocks);
+    size_t offset = static_cast<size_t>(seq * PAYLOAD_SIZE);
+    payload = SendData() + offset;
+    return min(static_cast<size_t>(PAYLOAD_SIZE), static_cast<size_t>(metaPacket.wireSize) - offset);
+}
+
+
+// Function Name: SetZeroCopy
+// Parameters:
+//   - bool enable: true to map the file in LoadFile and send the blocks with GetBlockPayload
+void FileBlock::SetZeroCopy(bool enable)
+{
+    zeroCopy = enable;
+}
+
+
+// Function Name: SetIoRing
+// Parameters:
+//   - IoRing* ring: ring LoadFile / SaveFile read and write through, nullptr for the stream I/O
+void FileBlock::SetIoRing(IoRing* ring)
+{
+    ioRing = ring;
+}
+
+
+// Function Name: SetOutputDirectory
+// Parameters:
+//   - const string& directory: directory received files are saved in, empty for the path in the MetaPacket
+void FileBlock::SetOutputDirectory(const string& directory)
+{
+    outputDirectory = directory;
+}
+
+
+// Function Name: OutputPath
+// Return Value: string - the announced file name inside outputDirectory, or the announced path as it is
+string FileBlock::OutputPath() const
+{
+    if (outputDirectory.empty())
+        return metaPacket.filename;
+
+    // only the name is taken from the sender, so it cannot write outside the directory
+    string name = metaPacket.filename;
+    const size_t slash = name.find_last_of("/\\");
+    if (slash != string::npos)
+        name = name.substr(slash + 1);
+    if (name.empty() || name == "." || name == "..")
+        name = "received";
+    return outputDirectory + "/" + name;
+}
+
+
+// Function Name: SetStreamCount
+// Parameters:
+//   - uint16_t count: number of files the sender transfers on the connection at the same time
+void FileBlock::SetStreamCount(uint16_t count)
+{
+    streamCount = count;
+}
+
+
+// Function Name: SetFlowCount
+// Parameters:
+//   - uint8_t count: number of parallel flows (connections) the sender splits the blocks across
+void FileBlock::SetFlowCount(uint8_t count)
+{
+    flowCount = count;
+}
+
+
+// Function Name: FlowSize
+// Return Value: uint64_t - blocks per flow: the blocks divided evenly over the flows, rounded up to whole FEC groups
+uint64_t FileBlock::FlowSize() const
+{
+    uint64_t flows = metaPacket.flowCount > 1 ? metaPacket.flowCount : 1;
+    uint64_t size = (metaPacket.totalBlocks + flows - 1) / flows;
+    if (metaPacket.fecScheme != FEC_NONE)
+        size = (size + metaPacket.fecGroupSize - 1) / metaPacket.fecGroupSize * metaPacket.fecGroupSize;
+    return size > 0 ? size : 1;
+}
+
+
+// Function Name: GetFlowRange
+// Parameters:
+//   - int flow: flow index, below the MetaPacket's flowCount
+//   - uint64_t& first, uint64_t& end: set to the block range [first, end) the flow carries
+void FileBlock::GetFlowRange(int flow, uint64_t& first, uint64_t& end) const
+{
+    uint64_t size = FlowSize();
+    first = min(static_cast<uint64_t>(flow) * size, metaPacket.totalBlocks);
+    end = min(first + size, metaPacket.totalBlocks);
+}
+
+
+// Function Name: FlowEnd
+// Parameters:
+//   - uint64_t seq: block index
+// Return Value: uint64_t - end (exclusive) of the range of the flow that carries the block
+uint64_t FileBlock::FlowEnd(uint64_t seq) const
+{
+    uint64_t size = FlowSize();
+    return min((seq / size + 1) * size, metaPacket.totalBlocks);
+}
+
+
+// Function Name: EndFlow
+// Parameters:
+//   - uint64_t seq: a block of the flow whose final packet arrived
+// Return Value: bool - true once the final packet of every flow that carries blocks has arrived
+// Function Description:
+//      -- The flows of a split transfer finish independently, so the last block of the file may arrive while
+//      -- other flows are still sending; the transfer only ends early (with blocks missing) once all have ended.
+bool FileBlock::EndFlow(uint64_t seq)
+{
+    uint64_t size = FlowSize();
+    size_t flow = static_cast<size_t>(seq / size);
+    if (flow < flowEnded.size() && !flowEnded[flow])
+    {
+        flowEnded[flow] = 1;
+        flowsEnded++;
+    }
+    return flowsEnded >= (metaPacket.totalBlocks + size - 1) / size;
+}
+
+
+// Function Name: SetCompression
+// Parameters:
+//   - bool enable: true to compress the file in LoadFile
+void FileBlock::SetCompression(bool enable)
+{
+    compression = enable;
+}
+
+
+// Accessor of blocks
+// Return Value: const vector<BlockPacket>& - the blocks, by reference (the sender reads one per packet)
+const vector<BlockPacket>& FileBlock::GetBlocks(void) const
 {
     return blocks;
 }
@@ -191,6 +820,148 @@ const MetaPacket& FileBlock::GetMetaPacket(void)
 }
 
 
+// Function Name: SliceBlocks
+// Function Description:
+//      -- Splits the wire buffer (raw file, compressed image or delta stream) into BlockPackets and
+//      -- computes the FEC parity packets of every group.
+void FileBlock::SliceBlocks()
+{
+    const uint8_t* wire = SendData();
+    const size_t wireSize = static_cast<size_t>(metaPacket.wireSize);
+
+
+    // Determine the total number of blocks needed, result round up
+    uint64_t totalBlocks = (metaPacket.wireSize + PAYLOAD_SIZE - 1) / PAYLOAD_SIZE;
+    metaPacket.totalBlocks = totalBlocks;
+
+
+    // The last block zero padded, as it goes on the wire
+    uint8_t lastBlock[PAYLOAD_SIZE] = { 0 };
+    const uint64_t lastIndex = totalBlocks > 0 ? totalBlocks - 1 : 0;
+    if (totalBlocks > 0)
+        memcpy(lastBlock, wire + lastIndex * PAYLOAD_SIZE, wireSize - static_cast<size_t>(lastIndex * PAYLOAD_SIZE));
+
+
+    // Split the file data into blocks; a zero-copy transfer sends the payloads straight from the wire data instead
+    blocks.clear();
+    if (!zeroCopy)
+    {
+        // Allocate space for blocks (zeroed, so the unused tail of the last block is deterministic)
+        blocks.assign(static_cast<size_t>(totalBlocks), BlockPacket());
+
+        for (uint64_t i = 0; i < totalBlocks; i++)
+        {
+            blocks[static_cast<size_t>(i)].packetType = TYPE_DATA;
+            blocks[static_cast<size_t>(i)].localSequence = i;
+
+            size_t offset = static_cast<size_t>(i * PAYLOAD_SIZE); // Starting position of the current block in the wire buffer
+
+            // Check if last block of payload
+            size_t blockSize = PAYLOAD_SIZE;
+            if (offset + blockSize > wireSize)
+                blockSize = wireSize - offset;
+
+            memcpy(blocks[static_cast<size_t>(i)].payLoad, wire + offset, blockSize);
+        }
+    }
+
+
+    // A resumable transfer first learns from the receiver which blocks it already has
+    if (resume)
+        metaPacket.flags |= META_FLAG_RESUME;
+    resumeNegotiated = false;
+    peerHas.assign(resume ? static_cast<size_t>(totalBlocks) : 0, 0);
+
+
+    // Compute the parity packets of every group of fecGroupSize blocks
+    metaPacket.fecScheme = fecScheme;
+    metaPacket.fecGroupSize = fecGroupSize;
+    metaPacket.fecParityCount = fecParityCount;
+    parityPackets.clear();
+    if (fecScheme != FEC_NONE)
+    {
+        uint64_t groups = (totalBlocks + fecGroupSize - 1) / fecGroupSize;
+        parityPackets.resize(static_cast<size_t>(groups * fecParityCount));
+
+        for (uint64_t g = 0; g < groups; g++)
+        {
+            uint64_t first = g * fecGroupSize;
+            int groupSize = fecGroupSize;
+            if (first + groupSize > totalBlocks)
+                groupSize = static_cast<int>(totalBlocks - first);
+
+            const uint8_t* data[FEC_MAX_GROUP_SIZE];
+            uint8_t* parity[FEC_MAX_PARITY_COUNT];
+            for (int i = 0; i < groupSize; i++)
+                data[i] = first + i == lastIndex ? lastBlock : wire + (first + i) * PAYLOAD_SIZE;
+            for (int j = 0; j < fecParityCount; j++)
+            {
+                ParityPacket& packet = parityPackets[static_cast<size_t>(g * fecParityCount + j)];
+                packet.packetType = TYPE_PARITY;
+                packet.group = static_cast<uint32_t>(g);
+                packet.index = static_cast<uint8_t>(j);
+                parity[j] = reinterpret_cast<uint8_t*>(packet.payLoad);
+            }
+
+            FecEncodeGroup(fecScheme, data, groupSize, parity, fecParityCount, PAYLOAD_SIZE);
+        }
+    }
+}
+
+
+// Function Name: BuildDelta
+// Return Value: int - 0 on success
+// Function Description:
+//      -- Sender side of a delta transfer: once the receiver's signatures are in (or waiting timed out),
+//      -- encodes the file as a delta stream against the receiver's copy and slices that into blocks.
+//      -- The MetaPacket must be sent again afterwards so the receiver learns the delta stream size.
+int FileBlock::BuildDelta()
+{
+    uint64_t copied = EncodeDelta(fileData, peerSignatures, peerSignatureKnown, wireData);
+
+    metaPacket.flags = META_FLAG_DELTA;
+    metaPacket.wireSize = wireData.size();
+    LOG_INFO("Delta: %llu of %llu bytes reused from the receiver's copy, %llu bytes to send.",
+        (unsigned long long)copied, (unsigned long long)metaPacket.fileSize, (unsigned long long)metaPacket.wireSize);
+
+    SliceBlocks();
+    return 0;
+}
+
+
+// Function Name: DeltaPending
+// Return Value: bool - true while the sender still has to call BuildDelta
+bool FileBlock::DeltaPending(void) const
+{
+    return (metaPacket.flags & META_FLAG_SIGNATURE_REQUEST) != 0;
+}
+
+
+// Function Name: SignaturesComplete
+// Return Value: bool - true once the receiver's final SignaturePacket has been processed
+bool FileBlock::SignaturesComplete(void) const
+{
+    return signaturesComplete;
+}
+
+
+// Function Name: SignatureCount
+// Return Value: size_t - number of the receiver's block signatures that have arrived so far
+size_t FileBlock::SignatureCount(void) const
+{
+    return signatureCount;
+}
+
+
+// Function Name: SetDelta
+// Parameters:
+//   - bool enable: true to send only the differences to the receiver's existing copy
+void FileBlock::SetDelta(bool enable)
+{
+    delta = enable;
+}
+
+
 // Function Name: LoadFile
 // Parameters:
 //   - const char* filename: The name of the file to load.
@@ -204,69 +975,134 @@ int FileBlock::LoadFile(const char* filename)
     assert(filename != nullptr);
 
 
+    // Set the meta packet type and copy the file name.
+    metaPacket.packetType = TYPE_META;
+    metaPacket.streamCount = streamCount;
+    metaPacket.flowCount = flowCount;
+#pragma warning(suppress : 4996)
+    strncpy(metaPacket.filename, filename, MAX_FILENAME_LENGTH - 1);
+    metaPacket.filename[MAX_FILENAME_LENGTH - 1] = '\0';
+
+
+    // Zero-copy raw transfer: the mapped file is the wire data, nothing is read into memory up front
+    sourceFile.Close();
+    if (zeroCopy && !compression && !delta)
+    {
+        if (sourceFile.Open(filename) != 0)
+            return -1;
+        metaPacket.fileSize = sourceFile.Size();
+
+        // the checksum pass is what faults the mapping in
+        MD5Context ctx;
+        md5Init(&ctx);
+        {
+            TraceSpan span(TRACE_DISK_READ, metaPacket.fileSize);
+            md5Update(&ctx, const_cast<uint8_t*>(sourceFile.Data()), sourceFile.Size());
+        }
+        md5Finalize(&ctx);
+        memcpy(metaPacket.md5, ctx.digest, MD5_HASH_LENGTH);
+
+        fileData.clear();
+        wireData.clear();
+        metaPacket.flags = 0;
+        metaPacket.wireSize = metaPacket.fileSize;
+        SliceBlocks();
+        return 0;
+    }
+
+
     // Open the file in binary mode and move to the end to get its size
     ifstream inFile(filename, ios::binary | ios::ate);
     if (!inFile)
     {
-        fprintf(stderr, "Cannot open file for reading: %s\n", filename);
+        LOG_ERROR("Cannot open file for reading: %s", filename);
         return -1;
     }
     metaPacket.fileSize = static_cast<uint64_t>(inFile.tellg()); // get file size
     inFile.seekg(0, ios::beg); // move back to start of file
 
 
-    // Set the meta packet type and copy the file name.
-    metaPacket.packetType = TYPE_META;
-    strcpy_s(metaPacket.filename, MAX_FILENAME_LENGTH, filename);
-
-
-    // Calculate MD5 checksum
-    FILE* fp = nullptr;
-    fopen_s(&fp, filename, "rb");
-
-    if (!fp)
+    // Through the io_uring backend: read with chunked requests on the ring, checksum the bytes in memory
+    if (ioRing != nullptr)
     {
-        fprintf(stderr, "Failed to open file for MD5 calculation:  %s\n", filename);
         inFile.close();
-        return -1;
-    }
-    md5File(fp, metaPacket.md5);
-    fclose(fp);
-
+        fileData.resize(static_cast<size_t>(metaPacket.fileSize));
+        {
+            TraceSpan span(TRACE_DISK_READ, metaPacket.fileSize);
+            if (IoRingReadFile(*ioRing, filename, fileData.data(), fileData.size()) != 0)
+                return -1;
+        }
 
-    // Determine the total number of blocks needed, result round up
-    uint64_t totalBlocks = (metaPacket.fileSize + PAYLOAD_SIZE - 1) / PAYLOAD_SIZE;
-    metaPacket.totalBlocks = totalBlocks;
+        MD5Context ctx;
+        md5Init(&ctx);
+        md5Update(&ctx, fileData.data(), fileData.size());
+        md5Finalize(&ctx);
+        memcpy(metaPacket.md5, ctx.digest, MD5_HASH_LENGTH);
+    }
+    else
+    {
+        // Calculate MD5 checksum
+#pragma warning(suppress : 4996)
+        FILE* fp = fopen(filename, "rb");
 
+        if (!fp)
+        {
+            LOG_ERROR("Failed to open file for MD5 calculation:  %s", filename);
+            inFile.close();
+            return -1;
+        }
+        md5File(fp, metaPacket.md5);
+        fclose(fp);
 
-    // Allocate space for blocks and complete file data
-    blocks.resize(static_cast<size_t>(totalBlocks));
-    fileData.resize(static_cast<size_t>(metaPacket.fileSize));
 
+        // Read entire file into fileData
+        fileData.resize(static_cast<size_t>(metaPacket.fileSize));
+        {
+            TraceSpan span(TRACE_DISK_READ, metaPacket.fileSize);
+            inFile.seekg(0, ios::beg);
+            inFile.read(reinterpret_cast<char*>(fileData.data()), metaPacket.fileSize);
+            inFile.close();
+        }
+    }
 
-    // Read entire file into fileData
-    inFile.seekg(0, ios::beg);
-    inFile.read(reinterpret_cast<char*>(fileData.data()), metaPacket.fileSize);
-    inFile.close();
 
+    // Optionally compress the file; keep the compressed image only if it is smaller as a whole
+    metaPacket.flags = 0;
+    metaPacket.wireSize = metaPacket.fileSize;
+    wireData.clear();
 
-    // Split the file data into blocks
-    for (uint64_t i = 0; i < totalBlocks; i++)
+    // A delta transfer first asks the receiver for the signatures of its copy; BuildDelta slices the blocks later
+    if (delta)
     {
-        blocks[static_cast<size_t>(i)].packetType = TYPE_DATA;
-        blocks[static_cast<size_t>(i)].localSequence = i;
-
-        size_t offset = static_cast<size_t>(i * PAYLOAD_SIZE); // Starting position of the current block in fileData vector (buffer)
-
-        // Check if last block of payload
-        size_t blockSize = PAYLOAD_SIZE;
-        if (offset + blockSize > fileData.size())
-            blockSize = fileData.size() - offset;
-
-        memcpy(blocks[static_cast<size_t>(i)].payLoad, fileData.data() + offset, blockSize);
+        metaPacket.flags = META_FLAG_DELTA | META_FLAG_SIGNATURE_REQUEST;
+        metaPacket.wireSize = 0;
+        metaPacket.totalBlocks = 0;
+        blocks.clear();
+        parityPackets.clear();
+        peerSignatures.clear();
+        peerSignatureKnown.clear();
+        signaturesComplete = false;
+        signatureCount = 0;
+        return 0;
+    }
 
-        // Now, if the last piece of data is less than PAYLOAD_SIZE, the rest remains unused.
+    if (compression)
+    {
+        size_t rawChunks = EncodeWireImage(fileData, wireData);
+        if (wireData.size() < fileData.size())
+        {
+            metaPacket.flags |= META_FLAG_COMPRESSED;
+            metaPacket.wireSize = wireData.size();
+            LOG_INFO("Compressed %llu bytes to %llu bytes (%zu chunks stored raw).",
+                (unsigned long long)metaPacket.fileSize, (unsigned long long)metaPacket.wireSize, rawChunks);
+        }
+        else
+        {
+            LOG_INFO("File is not compressible, sending raw bytes.");
+            wireData.clear();
+        }
     }
+    SliceBlocks();
 
     // return static_cast<int>(totalBlocks);
     return 0;
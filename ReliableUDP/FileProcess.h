@@ -14,7 +14,15 @@
 #include <fstream>
 #include <iostream>
 #include <cstring>
+#include <algorithm>
+#include <array>
 #include "md5.h"
+#include "Compress.h"
+#include "Fec.h"
+#include "Journal.h"
+#include "Delta.h"
+#include "MappedFile.h"
+#include "IoRing.h"
 
 using namespace std;
 
@@ -22,6 +30,11 @@ using namespace std;
 // Define packet type
 const uint8_t TYPE_META = 1; // 1 - Meta Packet
 const uint8_t TYPE_DATA = 2; // 2 - Data Packet
+const uint8_t TYPE_PARITY = 3; // 3 - FEC Parity Packet
+const uint8_t TYPE_RESUME = 4; // 4 - Resume Packet (receiver -> sender)
+const uint8_t TYPE_SIGNATURE = 5; // 5 - Signature Packet (receiver -> sender)
+
+const size_t DELTA_MAX_SIGNATURES = 1u << 26; // refuse signature indices beyond 64 GB of base file
 
 
 
@@ -34,17 +47,117 @@ private:
 
     int allDone = -1;                // Flag of received all data from client done; -1 => no-all done, 0 = > all done
 
-    MetaPacket metaPacket;           // File metadata (fixed size 256 bytes)
+    MetaPacket metaPacket = {};      // File metadata (fixed size 256 bytes)
 
     vector<BlockPacket> blocks;      // Vector of file blocks
 
     vector<uint8_t> fileData;        // Complete file data for saving/verification
 
+    vector<uint8_t> wireData;        // Compressed wire image carried by the blocks (only when META_FLAG_COMPRESSED)
+
+    bool compression = false;        // Sender side: try to compress the file before slicing it into blocks
+
+    bool zeroCopy = false;           // Sender side: map the file and send block payloads straight from the wire data
+    MappedFile sourceFile;           // Sender side: the mapped file when it is also the wire data (zero-copy, raw transfer)
+    IoRing* ioRing = nullptr;        // Reads / writes the file through this ring instead of fstream (not owned)
+
+    string outputDirectory;          // Receiver side: directory the file is saved in (empty: the path the sender announced)
+
+    uint8_t fecScheme = FEC_NONE;    // Sender side: FEC scheme for the next LoadFile
+    uint8_t fecGroupSize = 0;        // Sender side: data blocks per FEC group (K)
+    uint8_t fecParityCount = 0;      // Sender side: parity blocks per FEC group (M)
+
+    uint16_t streamCount = 1;        // Sender side: files sent side by side on the connection, announced in the MetaPacket
+    uint8_t flowCount = 1;           // Sender side: parallel flows the blocks are split across, announced in the MetaPacket
+
+    vector<ParityPacket> parityPackets; // Sender side: M parity packets per group, in group order
+
+    vector<uint8_t> received;        // Receiver side: 1 per block that has been received or rebuilt
+    uint64_t receivedCount = 0;      // Receiver side: number of set entries in received
+    uint64_t recoveredCount = 0;     // Receiver side: blocks rebuilt from parity
+
+    vector<uint8_t> parityData;      // Receiver side: parity payloads, PAYLOAD_SIZE bytes per (group, index)
+    vector<uint8_t> parityReceived;  // Receiver side: 1 per parity payload that has been received
+    vector<uint8_t> flowEnded;       // Receiver side: 1 per flow whose last packet has arrived
+    uint64_t flowsEnded = 0;         // Receiver side: number of set entries in flowEnded
+
+    bool resume = false;             // Sender side: ask the receiver which blocks it already has
+    bool resumeNegotiated = false;   // Sender side: the final ResumePacket has arrived
+    vector<uint8_t> peerHas;         // Sender side: 1 per block the receiver reported as present
+
+    bool delta = false;              // Sender side: send only the differences to the receiver's copy
+    bool signaturesComplete = false; // Sender side: the final SignaturePacket has arrived
+    size_t signatureCount = 0;       // Sender side: distinct signatures received so far
+    vector<BlockSignature> peerSignatures; // Sender side: signatures of the receiver's copy
+    vector<uint8_t> peerSignatureKnown; // Sender side: 1 per signature that has arrived
+
+    TransferJournal journal;         // Receiver side: on-disk progress of a resumable transfer
+    vector<uint8_t> baseData;        // Receiver side: existing copy of the file a delta is applied to
+
+    vector<array<uint8_t, PACKET_SIZE>> replyPackets; // Receiver side: encoded Resume/Signature packets to send
+    size_t replyNext = 0;            // Receiver side: next reply packet to send
+
+    // Receiver side: where the file is saved (and its journal and delta base are looked for)
+    string OutputPath() const;
+
+    // Buffer the blocks are sliced from / reassembled into
+    vector<uint8_t>& WireBuffer();
+
+    // Sender side: first byte of the wire data (the mapped file or WireBuffer)
+    const uint8_t* SendData();
+
+    // Copies one block payload into the wire buffer and marks it received
+    void StoreBlock(uint64_t seq, const unsigned char* payLoad);
+
+    // Rebuilds the missing blocks of an FEC group once enough data + parity blocks are present
+    void RecoverGroup(uint64_t group);
+
+    // Blocks per flow of a transfer split across parallel flows (a whole number of FEC groups)
+    uint64_t FlowSize() const;
+
+    // End (exclusive) of the block range of the flow that carries block seq
+    uint64_t FlowEnd(uint64_t seq) const;
+
+    // Records that the final packet of the flow carrying block seq arrived; true once every flow has ended
+    bool EndFlow(uint64_t seq);
+
+    // Expands the wire image (if compressed) and flags the transfer as finished
+    void CompleteTransfer();
+
+    // Builds the ResumePackets listing the block ranges that are already present
+    void BuildResumePackets();
+
+    // Loads the delta base and builds the SignaturePackets describing it
+    void BuildSignaturePackets();
+
+    // Splits the wire buffer into blocks and computes the parity packets
+    void SliceBlocks();
+
+    // Appends an encoded reply packet to replyPackets
+    template <typename PacketLayout, typename Packet>
+    void QueueReplyPacket(const Packet& reply)
+    {
+        replyPackets.emplace_back();
+        PacketLayout::Encode(reply, replyPackets.back().data());
+    }
+
 
 public:
 
     // Accessor fo blocks
-    vector<BlockPacket> GetBlocks(void);
+    const vector<BlockPacket>& GetBlocks(void) const;
+
+    // Sender side: points payload at the bytes of block seq inside the wire data and returns their count (short for the last block)
+    size_t GetBlockPayload(uint64_t seq, const uint8_t*& payload);
+
+    // Makes the next LoadFile map the file and skip building BlockPackets (send with GetBlockPayload)
+    void SetZeroCopy(bool enable);
+
+    // Makes LoadFile / SaveFile go through ring (io_uring) instead of fstream; nullptr restores the streams
+    void SetIoRing(IoRing* ring);
+
+    // Receiver side: saves received files in directory under the announced file name (its directories dropped); empty saves at the announced path
+    void SetOutputDirectory(const string& directory);
 
     // Accessor of fileName
     const MetaPacket& GetMetaPacket(void);
@@ -58,11 +171,65 @@ public:
     // Parsing received data
     int ProcessReceivedPacket(const unsigned char* packet, size_t packetSize);
 
+    // Enables the per-chunk compression stage for the next LoadFile
+    void SetCompression(bool enable);
+
+    // Enables forward error correction for the next LoadFile (FEC_NONE disables it)
+    void SetFec(uint8_t scheme, uint8_t groupSize, uint8_t parityCount);
+
+    // Announces in the next LoadFile's MetaPacket how many files (streams) the sender transfers at once
+    void SetStreamCount(uint16_t count);
+
+    // Announces in the next LoadFile's MetaPacket how many parallel flows the blocks are split across
+    void SetFlowCount(uint8_t count);
+
+    // Block range [first, end) sent on flow (empty for flows beyond the end of the file)
+    void GetFlowRange(int flow, uint64_t& first, uint64_t& end) const;
+
+    // Accessor of parity packets (sender side)
+    const vector<ParityPacket>& GetParityPackets(void) const;
+
+    // Number of blocks rebuilt from parity instead of being received (receiver side)
+    uint64_t GetRecoveredBlocks(void) const;
+
+    // Number of blocks received or rebuilt so far, including those a resumed transfer already had (receiver side)
+    uint64_t GetReceivedBlocks(void) const;
+
+    // Makes the next LoadFile request a resumable transfer
+    void SetResume(bool enable);
+
+    // Sender side: true once the receiver has reported which blocks it already has
+    bool ResumeNegotiated(void) const;
+
+    // Sender side: true if the receiver reported block seq as already present
+    bool PeerHasBlock(uint64_t seq) const;
+
+    // Receiver side: copies the next pending Resume/Signature packet into packet, returns false if there is none
+    bool NextReplyPacket(unsigned char* packet);
+
+    // Makes the next LoadFile a delta transfer against the receiver's existing copy
+    void SetDelta(bool enable);
+
+    // Sender side: true while the delta stream still has to be built (signatures outstanding)
+    bool DeltaPending(void) const;
+
+    // Sender side: true once the receiver has sent all of its signatures
+    bool SignaturesComplete(void) const;
+
+    // Sender side: number of the receiver's signatures received so far
+    size_t SignatureCount(void) const;
+
+    // Sender side: encodes the delta stream and slices it into blocks
+    int BuildDelta();
+
+    // Receiver side: flushes received blocks and the block bitmap to the journal
+    void Checkpoint();
+
     // Reads a file from disk, computes its MD5 checksum, and splits it into blocks.
     int LoadFile(const char* filename);
 
     // Writes received file data to disk after successful transmission.
-    int SaveFile() const;
+    int SaveFile();
 
 };
 
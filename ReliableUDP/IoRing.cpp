@@ -0,0 +1,481 @@
+// File Name: IoRing.cpp
+// Date: 2026-10
+// File Description:
+//      -- Implements IoRing with the io_uring_setup / io_uring_enter / io_uring_register system calls and the
+//      -- chunked file reads and writes used by FileBlock. Without io_uring every function fails cleanly.
+
+#include "IoRing.h"
+#include "Log.h"
+
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#if RUDP_HAVE_IO_URING
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+
+IoRing::~IoRing()
+{
+    Close();
+}
+
+
+bool IoRing::IsOpen() const
+{
+    return ringFd >= 0;
+}
+
+
+unsigned IoRing::InFlight() const
+{
+    return inFlight;
+}
+
+
+#if RUDP_HAVE_IO_URING
+
+// Function Name: Open
+// Parameters:
+//   - unsigned entries: submission queue size (rounded up to a power of two by the kernel)
+// Return Value: int - 0 on success, -1 if the kernel refuses (old kernel, seccomp, container policy)
+int IoRing::Open(unsigned entries)
+{
+    Close();
+
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0)
+    {
+        LOG_WARN("io_uring is not available: %s", strerror(errno));
+        return -1;
+    }
+    ringFd = fd;
+
+    sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap)
+        sqMapSize = cqMapSize = max(sqMapSize, cqMapSize);
+
+    sqMap = mmap(nullptr, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sqMap == MAP_FAILED)
+    {
+        sqMap = nullptr;
+        LOG_WARN("io_uring: cannot map the submission queue: %s", strerror(errno));
+        Close();
+        return -1;
+    }
+    if (singleMap)
+        cqMap = sqMap;
+    else
+    {
+        cqMap = mmap(nullptr, cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cqMap == MAP_FAILED)
+        {
+            cqMap = nullptr;
+            LOG_WARN("io_uring: cannot map the completion queue: %s", strerror(errno));
+            Close();
+            return -1;
+        }
+    }
+
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        sqes = nullptr;
+        LOG_WARN("io_uring: cannot map the submission entries: %s", strerror(errno));
+        Close();
+        return -1;
+    }
+
+    unsigned char* sq = static_cast<unsigned char*>(sqMap);
+    sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sqEntries = params.sq_entries;
+    sqeTail = *sqTail;
+
+    unsigned char* cq = static_cast<unsigned char*>(cqMap);
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = cq + params.cq_off.cqes;
+
+    inFlight = 0;
+    LOG_DEBUG("io_uring ready: %u submission entries, %u completion entries", params.sq_entries, params.cq_entries);
+    return 0;
+}
+
+
+// Function Name: Close
+// Function Description: Operations still in flight are cancelled by the kernel when the ring is released
+void IoRing::Close()
+{
+    if (ringFd < 0)
+        return;
+    if (inFlight > 0)
+        LOG_WARN("io_uring closed with %u operations in flight", inFlight);
+
+    if (buffersRegistered)
+        UnregisterBuffers();
+    if (sqes)
+        munmap(sqes, sqesSize);
+    if (cqMap && cqMap != sqMap)
+        munmap(cqMap, cqMapSize);
+    if (sqMap)
+        munmap(sqMap, sqMapSize);
+    close(ringFd);
+
+    ringFd = -1;
+    sqMap = cqMap = sqes = cqes = nullptr;
+    sqHead = sqTail = sqMask = sqArray = nullptr;
+    cqHead = cqTail = cqMask = nullptr;
+    inFlight = 0;
+}
+
+
+int IoRing::RegisterBuffers(void* const buffers[], const size_t sizes[], unsigned count)
+{
+    if (ringFd < 0 || buffersRegistered)
+        return -1;
+
+    vector<iovec> vectors(count);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        vectors[i].iov_base = buffers[i];
+        vectors[i].iov_len = sizes[i];
+    }
+    if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS, vectors.data(), count) != 0)
+    {
+        LOG_DEBUG("io_uring: buffers not registered (%s), using unregistered I/O", strerror(errno));
+        return -1;
+    }
+    buffersRegistered = true;
+    return 0;
+}
+
+
+void IoRing::UnregisterBuffers()
+{
+    if (ringFd < 0 || !buffersRegistered)
+        return;
+    syscall(__NR_io_uring_register, ringFd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+    buffersRegistered = false;
+}
+
+
+void* IoRing::NextEntry()
+{
+    if (ringFd < 0)
+        return nullptr;
+
+    const unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    if (sqeTail - head >= sqEntries)
+        return nullptr;
+
+    const unsigned index = sqeTail & *sqMask;
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(sqes) + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray[index] = index;
+    sqeTail++;
+    return sqe;
+}
+
+
+bool IoRing::Prepare(uint8_t opcode, int fd, const void* address, unsigned length, uint64_t offset, IoOperation* op, int fixedIndex)
+{
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(NextEntry());
+    if (!sqe)
+        return false;
+
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(address);
+    sqe->len = length;
+    sqe->off = offset;
+    sqe->user_data = reinterpret_cast<uint64_t>(op);
+    if (fixedIndex >= 0)
+        sqe->buf_index = (uint16_t)fixedIndex;
+    if (op)
+        inFlight++;
+    return true;
+}
+
+
+bool IoRing::Read(int fd, void* buffer, unsigned size, uint64_t offset, IoOperation* op, int fixedIndex)
+{
+    return Prepare(fixedIndex >= 0 ? IORING_OP_READ_FIXED : IORING_OP_READ, fd, buffer, size, offset, op, fixedIndex);
+}
+
+
+bool IoRing::Write(int fd, const void* buffer, unsigned size, uint64_t offset, IoOperation* op, int fixedIndex)
+{
+    return Prepare(fixedIndex >= 0 ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE, fd, buffer, size, offset, op, fixedIndex);
+}
+
+
+bool IoRing::ReceiveMessage(int fd, msghdr* message, IoOperation* op)
+{
+    return Prepare(IORING_OP_RECVMSG, fd, message, 1, 0, op, -1);
+}
+
+
+bool IoRing::SendMessage(int fd, const msghdr* message, IoOperation* op)
+{
+    return Prepare(IORING_OP_SENDMSG, fd, message, 1, 0, op, -1);
+}
+
+
+// the cancel request itself has no IoOperation, its completion is skipped by Poll
+bool IoRing::Cancel(IoOperation* op)
+{
+    return Prepare(IORING_OP_ASYNC_CANCEL, -1, op, 0, 0, nullptr, -1);
+}
+
+
+int IoRing::Submit(unsigned waitFor)
+{
+    if (ringFd < 0)
+        return -1;
+
+    __atomic_store_n(sqTail, sqeTail, __ATOMIC_RELEASE);
+    const unsigned toSubmit = sqeTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    if (toSubmit == 0 && waitFor == 0)
+        return 0;
+
+    int result;
+    do
+    {
+        result = (int)syscall(__NR_io_uring_enter, ringFd, toSubmit, waitFor, waitFor > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0)
+        LOG_LIMITED(LOG_LEVEL_WARN, 10, "io_uring_enter failed: %s", strerror(errno));
+    return result;
+}
+
+
+int IoRing::Poll()
+{
+    if (ringFd < 0)
+        return 0;
+
+    int count = 0;
+    unsigned head = *cqHead;
+    while (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE))
+    {
+        const io_uring_cqe* cqe = static_cast<const io_uring_cqe*>(cqes) + (head & *cqMask);
+        IoOperation* op = reinterpret_cast<IoOperation*>(cqe->user_data);
+        const int result = cqe->res;
+        head++;
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+
+        if (op)
+        {
+            inFlight--;
+            op->Complete(result);
+            count++;
+        }
+    }
+    return count;
+}
+
+#else
+
+int IoRing::Open(unsigned)
+{
+    LOG_WARN("io_uring is not available on this platform");
+    return -1;
+}
+
+void IoRing::Close() {}
+int IoRing::RegisterBuffers(void* const[], const size_t[], unsigned) { return -1; }
+void IoRing::UnregisterBuffers() {}
+void* IoRing::NextEntry() { return nullptr; }
+bool IoRing::Prepare(uint8_t, int, const void*, unsigned, uint64_t, IoOperation*, int) { return false; }
+bool IoRing::Read(int, void*, unsigned, uint64_t, IoOperation*, int) { return false; }
+bool IoRing::Write(int, const void*, unsigned, uint64_t, IoOperation*, int) { return false; }
+bool IoRing::Cancel(IoOperation*) { return false; }
+int IoRing::Submit(unsigned) { return -1; }
+int IoRing::Poll() { return 0; }
+
+#endif
+
+
+int IoRing::Wait(unsigned count)
+{
+    Submit();
+    int ran = Poll();
+    while (ran < (int)count && inFlight > 0)
+    {
+        if (Submit(1) < 0)
+            break;
+        ran += Poll();
+    }
+    return ran;
+}
+
+
+
+#if RUDP_HAVE_IO_URING
+
+// Class Name: FileChunk
+// Class Description: One outstanding read or write of up to IORING_FILE_CHUNK bytes
+class FileChunk : public IoOperation
+{
+public:
+
+    size_t offset = 0;
+    unsigned size = 0;
+    int result = 0;
+    bool busy = false;
+    bool done = false;
+
+    void Complete(int result)
+    {
+        this->result = result;
+        done = true;
+    }
+
+};
+
+
+// Function Name: TransferFile
+// Function Description: Keeps up to IORING_FILE_DEPTH chunk requests in flight until size bytes are transferred
+// Return Value: int - 0 on success, -1 on an I/O error or an unexpected end of file
+static int TransferFile(IoRing& ring, int fd, uint8_t* data, size_t size, bool write, const char* path)
+{
+    void* buffers[1] = { data };
+    size_t sizes[1] = { size };
+    const int fixed = (size > 0 && ring.RegisterBuffers(buffers, sizes, 1) == 0) ? 0 : -1;
+
+    vector<FileChunk> chunks(IORING_FILE_DEPTH);
+    size_t next = 0;
+    int busy = 0;
+    int status = 0;
+
+    while (busy > 0 || (status == 0 && next < size))
+    {
+        // fill the free slots (a short transfer is re-queued for its remainder below)
+        for (FileChunk& chunk : chunks)
+        {
+            if (status != 0 || next >= size)
+                break;
+            if (chunk.busy)
+                continue;
+
+            chunk.offset = next;
+            chunk.size = (unsigned)min(size - next, (size_t)IORING_FILE_CHUNK);
+            chunk.done = false;
+            const bool queued = write
+                ? ring.Write(fd, data + chunk.offset, chunk.size, chunk.offset, &chunk, fixed)
+                : ring.Read(fd, data + chunk.offset, chunk.size, chunk.offset, &chunk, fixed);
+            if (!queued)
+                break;
+            chunk.busy = true;
+            busy++;
+            next += chunk.size;
+        }
+
+        ring.Wait(1);
+
+        for (FileChunk& chunk : chunks)
+        {
+            if (!chunk.busy || !chunk.done)
+                continue;
+            chunk.busy = false;
+            busy--;
+
+            if (chunk.result <= 0)
+            {
+                if (status == 0)
+                    LOG_ERROR("io_uring %s of %s failed at offset %zu: %s", write ? "write" : "read", path, chunk.offset,
+                        chunk.result < 0 ? strerror(-chunk.result) : "unexpected end of file");
+                status = -1;
+            }
+            else if ((unsigned)chunk.result < chunk.size && status == 0)
+            {
+                // short transfer: queue the rest right away
+                chunk.offset += chunk.result;
+                chunk.size -= chunk.result;
+                chunk.done = false;
+                const bool queued = write
+                    ? ring.Write(fd, data + chunk.offset, chunk.size, chunk.offset, &chunk, fixed)
+                    : ring.Read(fd, data + chunk.offset, chunk.size, chunk.offset, &chunk, fixed);
+                if (queued)
+                {
+                    chunk.busy = true;
+                    busy++;
+                }
+                else
+                {
+                    LOG_ERROR("io_uring: submission queue full while finishing %s", path);
+                    status = -1;
+                }
+            }
+        }
+    }
+
+    if (fixed == 0)
+        ring.UnregisterBuffers();
+    return status;
+}
+
+
+int IoRingReadFile(IoRing& ring, const char* path, uint8_t* data, size_t size)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        LOG_ERROR("Cannot open file for reading: %s", path);
+        return -1;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    int status = TransferFile(ring, fd, data, size, false, path);
+    close(fd);
+    return status;
+}
+
+
+int IoRingWriteFile(IoRing& ring, const char* path, const uint8_t* data, size_t size)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        LOG_ERROR("Error: Cannot open file for writing: %s", path);
+        return -1;
+    }
+    int status = TransferFile(ring, fd, const_cast<uint8_t*>(data), size, true, path);
+    if (close(fd) != 0 && status == 0)
+    {
+        LOG_ERROR("Error: Failed to write all data to file: %s", path);
+        status = -1;
+    }
+    return status;
+}
+
+#else
+
+int IoRingReadFile(IoRing&, const char*, uint8_t*, size_t)
+{
+    return -1;
+}
+
+int IoRingWriteFile(IoRing&, const char*, const uint8_t*, size_t)
+{
+    return -1;
+}
+
+#endif
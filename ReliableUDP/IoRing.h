@@ -0,0 +1,150 @@
+// File Name: IoRing.h
+// Date: 2026-10
+// File Description:
+//      -- Minimal io_uring wrapper built on the raw system calls (no liburing).
+//      -- Socket sends / receives and file reads / writes are queued as submission entries and handed to the
+//      -- kernel in one io_uring_enter call; completions are read from shared memory without a system call and
+//      -- dispatched to the IoOperation that submitted them. One ring serves the connection and the file I/O
+//      -- of a transfer, so both progress on the single main thread.
+//      -- Only available on Linux; elsewhere (or with -DRUDP_IO_URING=OFF) Open fails and callers keep their
+//      -- blocking paths.
+
+#ifndef _IORING_H_
+#define _IORING_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#if !defined(RUDP_HAVE_IO_URING)
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define RUDP_HAVE_IO_URING 1
+#endif
+#endif
+#endif
+
+#if !defined(RUDP_HAVE_IO_URING)
+#define RUDP_HAVE_IO_URING 0
+#endif
+
+#if RUDP_HAVE_IO_URING
+#include <sys/socket.h>
+#endif
+
+
+#define IORING_DEFAULT_ENTRIES  256         // submission queue size; the completion queue is twice as large
+#define IORING_FILE_CHUNK       (1u << 20)  // bytes per file read / write request
+#define IORING_FILE_DEPTH       32          // file requests in flight at once
+
+
+// Class Name: IoOperation
+// Class Description: A request in flight; the ring calls Complete with the result (bytes or -errno) when it finishes
+class IoOperation
+{
+public:
+
+    virtual ~IoOperation() {}
+
+    virtual void Complete(int result) = 0;
+
+};
+
+
+// Class Name: IoRing
+// Class Description:
+//      -- One submission / completion queue pair. Prepare functions only fill in an entry (false if the
+//      -- submission queue is full); Submit hands everything prepared to the kernel, Poll runs the completions
+//      -- that have arrived. Every IoOperation must stay alive until its Complete has run.
+class IoRing
+{
+
+private:
+
+    int ringFd = -1;
+
+    // submission queue, shared with the kernel
+    void* sqMap = nullptr;
+    size_t sqMapSize = 0;
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    void* sqes = nullptr;
+    size_t sqesSize = 0;
+    unsigned sqEntries = 0;
+    unsigned sqeTail = 0;            // entries prepared locally, published by Submit
+
+    // completion queue, shared with the kernel (may live in the same mapping as the submission queue)
+    void* cqMap = nullptr;
+    size_t cqMapSize = 0;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    void* cqes = nullptr;
+
+    unsigned inFlight = 0;           // operations prepared but not yet completed
+    bool buffersRegistered = false;
+
+    // Claims the next submission entry, nullptr if the queue is full
+    void* NextEntry();
+
+    bool Prepare(uint8_t opcode, int fd, const void* address, unsigned length, uint64_t offset, IoOperation* op, int fixedIndex);
+
+public:
+
+    IoRing() = default;
+    ~IoRing();
+
+    IoRing(const IoRing&) = delete;
+    IoRing& operator=(const IoRing&) = delete;
+
+    // Creates the ring; returns 0 on success, -1 if io_uring is unavailable (logged)
+    int Open(unsigned entries = IORING_DEFAULT_ENTRIES);
+
+    // Releases the ring; the kernel cancels operations still in flight, so their owners must be done with them
+    void Close();
+
+    bool IsOpen() const;
+
+    // Registers count buffers for ReadFixed / WriteFixed (index = position in the lists); returns 0 or -1
+    int RegisterBuffers(void* const buffers[], const size_t sizes[], unsigned count);
+    void UnregisterBuffers();
+
+    // Queue a file read / write at offset; fixedIndex >= 0 uses that registered buffer (the range must lie inside it)
+    bool Read(int fd, void* buffer, unsigned size, uint64_t offset, IoOperation* op, int fixedIndex = -1);
+    bool Write(int fd, const void* buffer, unsigned size, uint64_t offset, IoOperation* op, int fixedIndex = -1);
+
+#if RUDP_HAVE_IO_URING
+    // Queue a recvmsg / sendmsg; message and everything it points to must stay valid until completion
+    bool ReceiveMessage(int fd, msghdr* message, IoOperation* op);
+    bool SendMessage(int fd, const msghdr* message, IoOperation* op);
+#endif
+
+    // Queue a cancellation of an operation in flight (it then completes with -ECANCELED)
+    bool Cancel(IoOperation* op);
+
+    // Hands every prepared entry to the kernel and waits until at least waitFor completions are available
+    int Submit(unsigned waitFor = 0);
+
+    // Runs the completions that have arrived, without a system call; returns how many ran
+    int Poll();
+
+    // Submits, then runs completions until at least count have run (or nothing is in flight)
+    int Wait(unsigned count);
+
+    // Operations prepared or submitted whose completion has not run yet
+    unsigned InFlight() const;
+
+};
+
+
+// Function Name: IoRingReadFile / IoRingWriteFile
+// Function Description:
+//      -- Reads size bytes of path into data / writes data to path (truncating it) through the ring, with up to
+//      -- IORING_FILE_DEPTH requests of IORING_FILE_CHUNK bytes in flight. The buffer is registered for the duration if the
+//      -- memory lock limit allows it. Completions of other operations on the ring keep running meanwhile.
+// Return Value: int - 0 on success, -1 on error (logged)
+int IoRingReadFile(IoRing& ring, const char* path, uint8_t* data, size_t size);
+int IoRingWriteFile(IoRing& ring, const char* path, const uint8_t* data, size_t size);
+
+#endif // !_IORING_H_
@@ -0,0 +1,290 @@
+// File Name: Journal.cpp
+// Date: 2026-10
+// File Description:
+//      -- Implements the resumable transfer journal: restoring a partial transfer, recording newly received
+//      -- blocks and checkpointing them to disk in batches.
+
+#include "Journal.h"
+#include "Log.h"
+#include "Trace.h"
+
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+
+
+// Function Name: SyncFile
+// Parameters:
+//   - const string& path: file (or, on POSIX, directory) whose written data has to reach the disk
+// Return Value: bool - true once the data is durable
+// Function Description:
+//      -- A flushed stream only reaches the page cache; fsync / FlushFileBuffers writes it to the device, so a
+//      -- crash after the call cannot lose it.
+static bool SyncFile(const string& path)
+{
+#if defined(_WIN32)
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+    const bool synced = FlushFileBuffers(handle) != 0;
+    CloseHandle(handle);
+    return synced;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    const bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+#endif
+}
+
+
+// Function Name: ReplaceJournalFile
+// Parameters:
+//   - const string& from: complete, synced temporary file
+//   - const string& to: file it replaces
+// Return Value: bool - true if to now has the contents of from
+// Function Description:
+//      -- Atomic on both platforms: a crash leaves either the old or the new file, never neither.
+static bool ReplaceJournalFile(const string& from, const string& to)
+{
+#if defined(_WIN32)
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (rename(from.c_str(), to.c_str()) != 0)
+        return false;
+
+    // make the rename itself durable
+    const size_t slash = to.find_last_of('/');
+    SyncFile(slash == string::npos ? string(".") : slash == 0 ? string("/") : to.substr(0, slash));
+    return true;
+#endif
+}
+
+
+TransferJournal::~TransferJournal()
+{
+    if (open && !dirtyBlocks.empty())
+        LOG_WARN("Journal closed with %zu unsaved blocks: %s", dirtyBlocks.size(), journalPath.c_str());
+}
+
+
+
+// Function Name: Open
+// Parameters:
+//   - const MetaPacket& meta: the transfer being received
+//   - const string& path: where the file is saved; the journal files are named after it
+//   - vector<uint8_t>& wireBuffer: receive buffer (already sized to meta.wireSize)
+//   - vector<uint8_t>& received: per block flags (already sized to meta.totalBlocks)
+// Return Value: uint64_t - number of blocks restored from a previous run
+// Function Description:
+//      -- If a journal for the same file (same MD5, sizes and encoding) exists, the blocks it marks as
+//      -- present are loaded from the .part file. Otherwise a fresh journal is started.
+uint64_t TransferJournal::Open(const MetaPacket& meta, const string& path, vector<uint8_t>& wireBuffer, vector<uint8_t>& received)
+{
+    partFile.close();
+    dirtyBlocks.clear();
+
+    partPath = path + ".part";
+    journalPath = path + ".journal";
+
+    header.magic = JOURNAL_MAGIC;
+    memcpy(header.md5, meta.md5, MD5_HASH_LENGTH);
+    header.fileSize = meta.fileSize;
+    header.wireSize = meta.wireSize;
+    header.flags = meta.flags & META_FLAG_COMPRESSED;
+    header.totalBlocks = meta.totalBlocks;
+
+    const size_t bitmapSize = static_cast<size_t>((meta.totalBlocks + 7) / 8);
+    bitmap.assign(bitmapSize, 0);
+
+    uint64_t restored = 0;
+
+    // Try to pick up an earlier journal of the same transfer
+    ifstream journalFile(journalPath, ios::binary);
+    if (journalFile)
+    {
+        unsigned char raw[JournalHeaderLayout::size];
+        journalFile.read(reinterpret_cast<char*>(raw), sizeof(raw));
+
+        unsigned char expected[JournalHeaderLayout::size];
+        JournalHeaderLayout::Encode(header, expected);
+
+        if (journalFile && memcmp(raw, expected, sizeof(raw)) == 0)
+        {
+            journalFile.read(reinterpret_cast<char*>(bitmap.data()), bitmapSize);
+            if (!journalFile)
+                bitmap.assign(bitmapSize, 0);
+        }
+        else
+        {
+            LOG_INFO("Ignoring journal of a different transfer: %s", journalPath.c_str());
+        }
+    }
+    journalFile.close();
+
+    // Load the bytes of every journaled block from the .part file
+    ifstream partIn(partPath, ios::binary);
+    if (partIn)
+    {
+        partIn.read(reinterpret_cast<char*>(wireBuffer.data()), wireBuffer.size());
+        size_t available = static_cast<size_t>(partIn.gcount());
+
+        for (uint64_t seq = 0; seq < meta.totalBlocks; seq++)
+        {
+            if (!(bitmap[static_cast<size_t>(seq / 8)] & (1 << (seq % 8))))
+                continue;
+
+            uint64_t end = (seq + 1) * PAYLOAD_SIZE;
+            if (end > wireBuffer.size())
+                end = wireBuffer.size();
+            if (end > available)
+            {
+                bitmap[static_cast<size_t>(seq / 8)] &= ~(1 << (seq % 8)); // journal ahead of the data, drop it
+                continue;
+            }
+
+            received[static_cast<size_t>(seq)] = 1;
+            restored++;
+        }
+    }
+    else
+    {
+        bitmap.assign(bitmapSize, 0);
+    }
+    partIn.close();
+
+    // Keep the .part file open for writing, creating it if needed
+    partFile.open(partPath, ios::binary | ios::in | ios::out);
+    if (!partFile)
+    {
+        ofstream create(partPath, ios::binary);
+        create.close();
+        partFile.open(partPath, ios::binary | ios::in | ios::out);
+    }
+    if (!partFile)
+    {
+        LOG_WARN("Cannot open partial file, transfer will not be resumable: %s", partPath.c_str());
+        open = false;
+        return restored;
+    }
+
+    open = true;
+    if (restored > 0)
+        LOG_INFO("Resuming transfer: %llu of %llu blocks already present.",
+            (unsigned long long)restored, (unsigned long long)meta.totalBlocks);
+
+    return restored;
+}
+
+
+
+// Function Name: MarkReceived
+// Parameters:
+//   - uint64_t seq: block that has just been stored into the wire buffer
+//   - const vector<uint8_t>& wireBuffer: receive buffer
+// Function Description:
+//      -- Blocks are batched until the receiver's periodic Checkpoint, which rewrites the whole bitmap; a
+//      -- checkpoint per few blocks would make the journal I/O grow with the square of the file size. Only if
+//      -- JOURNAL_CHECKPOINT_BYTES of block data pile up in between are they written out here.
+void TransferJournal::MarkReceived(uint64_t seq, const vector<uint8_t>& wireBuffer)
+{
+    if (!open)
+        return;
+
+    dirtyBlocks.push_back(seq);
+    if (dirtyBlocks.size() * PAYLOAD_SIZE >= JOURNAL_CHECKPOINT_BYTES)
+        Checkpoint(wireBuffer);
+}
+
+
+
+// Function Name: Checkpoint
+// Parameters:
+//   - const vector<uint8_t>& wireBuffer: receive buffer
+// Return Value: int - 0 on success, -1 on an I/O error
+// Function Description:
+//      -- The block data is synced to disk before the bitmap is replaced, so the journal never claims a block
+//      -- whose bytes are not in the .part file yet.
+int TransferJournal::Checkpoint(const vector<uint8_t>& wireBuffer)
+{
+    if (!open || dirtyBlocks.empty())
+        return 0;
+
+    TraceSpan span(TRACE_DISK_WRITE, dirtyBlocks.size() * PAYLOAD_SIZE);
+    for (uint64_t seq : dirtyBlocks)
+    {
+        size_t offset = static_cast<size_t>(seq * PAYLOAD_SIZE);
+        size_t size = PAYLOAD_SIZE;
+        if (offset + size > wireBuffer.size())
+            size = wireBuffer.size() - offset;
+
+        partFile.seekp(offset, ios::beg);
+        partFile.write(reinterpret_cast<const char*>(wireBuffer.data() + offset), size);
+    }
+    partFile.flush();
+    if (!partFile || !SyncFile(partPath))
+    {
+        LOG_ERROR("Failed to write partial file: %s", partPath.c_str());
+        partFile.clear();
+        return -1;
+    }
+
+    for (uint64_t seq : dirtyBlocks)
+        bitmap[static_cast<size_t>(seq / 8)] |= (1 << (seq % 8));
+    dirtyBlocks.clear();
+
+    // Replace the journal atomically: write a temporary file, then rename it over the old one
+    string tempPath = journalPath + ".tmp";
+    ofstream journalFile(tempPath, ios::binary | ios::trunc);
+    unsigned char raw[JournalHeaderLayout::size];
+    JournalHeaderLayout::Encode(header, raw);
+    journalFile.write(reinterpret_cast<const char*>(raw), sizeof(raw));
+    journalFile.write(reinterpret_cast<const char*>(bitmap.data()), bitmap.size());
+    journalFile.close();
+    if (!journalFile || !SyncFile(tempPath))
+    {
+        LOG_ERROR("Failed to write journal: %s", tempPath.c_str());
+        return -1;
+    }
+
+    if (!ReplaceJournalFile(tempPath, journalPath))
+    {
+        LOG_ERROR("Failed to replace journal: %s", journalPath.c_str());
+        return -1;
+    }
+
+    return 0;
+}
+
+
+
+// Function Name: Discard
+// Function Description: Removes the journal files of the current transfer.
+void TransferJournal::Discard()
+{
+    if (!open)
+        return;
+
+    partFile.close();
+    remove(partPath.c_str());
+    remove(journalPath.c_str());
+    dirtyBlocks.clear();
+    open = false;
+}
+
+
+bool TransferJournal::IsOpen() const
+{
+    return open;
+}
@@ -0,0 +1,83 @@
+// File Name: Journal.h
+// Date: 2026-10
+// File Description:
+//      -- On-disk progress journal that makes a transfer resumable after a restart of either side.
+//      -- Received blocks are written to "<filename>.part" and a block bitmap is checkpointed to
+//      -- "<filename>.journal" (written to a temporary file first, then renamed over the old one).
+
+#ifndef _JOURNAL_H_
+#define _JOURNAL_H_
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Protocol.h"
+
+
+#define JOURNAL_MAGIC 0x524A4E4C      // "RJNL"
+#define JOURNAL_CHECKPOINT_BYTES (4 * 1024 * 1024) // unsaved block data after which MarkReceived checkpoints by itself;
+                                                  // below it the receiver's periodic Checkpoint (every 0.25 s) saves them
+
+
+struct JournalHeader // 45 Bytes at the start of the journal file, followed by the block bitmap
+{
+    uint32_t  magic;
+    uint8_t   md5[MD5_HASH_LENGTH];
+    uint64_t  fileSize;
+    uint64_t  wireSize;
+    uint8_t   flags;
+    uint64_t  totalBlocks;
+};
+
+typedef wire::Layout<45,
+    wire::Field<&JournalHeader::magic>,
+    wire::Field<&JournalHeader::md5>,
+    wire::Field<&JournalHeader::fileSize>,
+    wire::Field<&JournalHeader::wireSize>,
+    wire::Field<&JournalHeader::flags>,
+    wire::Field<&JournalHeader::totalBlocks>> JournalHeaderLayout;
+
+
+
+// Class Name: TransferJournal
+// Class Description:
+//      -- Persists which blocks of one transfer have been received, and their bytes, next to the target file.
+class TransferJournal
+{
+
+private:
+
+    bool open = false;               // Journal is attached to a transfer
+
+    std::string partPath;            // "<filename>.part" - received wire bytes at their final offsets
+    std::string journalPath;         // "<filename>.journal" - header + block bitmap
+
+    JournalHeader header = {};       // Identity of the transfer the journal belongs to
+
+    std::vector<uint8_t> bitmap;     // 1 bit per block, set once the block is durable in the .part file
+    std::vector<uint64_t> dirtyBlocks; // Blocks received since the last checkpoint
+
+    std::fstream partFile;           // Open handle on the .part file
+
+public:
+
+    ~TransferJournal();
+
+    // Attaches to the journal of the transfer described by meta, saved at path; returns the number of blocks restored into wireBuffer
+    uint64_t Open(const MetaPacket& meta, const std::string& path, std::vector<uint8_t>& wireBuffer, std::vector<uint8_t>& received);
+
+    // Records that block seq has been placed into the wire buffer; it is saved by the next Checkpoint
+    void MarkReceived(uint64_t seq, const std::vector<uint8_t>& wireBuffer);
+
+    // Writes all dirty blocks to the .part file and rewrites the bitmap
+    int Checkpoint(const std::vector<uint8_t>& wireBuffer);
+
+    // Deletes the .part and .journal files (transfer finished or its data turned out to be corrupt)
+    void Discard();
+
+    bool IsOpen() const;
+
+};
+
+#endif // !_JOURNAL_H_
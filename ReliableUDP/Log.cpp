@@ -0,0 +1,228 @@
+// File Name: Log.cpp
+// Date: 2026-10
+// File Description:
+//      -- Implements the log queue and its writer thread. The writer is created on the first message and
+//      -- stopped from an atexit handler after draining the queue; messages logged after that (from static
+//      -- destructors) are written synchronously.
+
+#include "Log.h"
+
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+// One formatted message
+struct LogRecord
+{
+    uint8_t   level;
+    uint16_t  length;
+    char      text[LOG_MAX_LINE];
+};
+
+
+// Class Name: LogWriter
+// Class Description: Queue of LogRecords and the thread that writes them
+class LogWriter
+{
+
+private:
+
+    mutex lock;
+    condition_variable wake;         // signals the writer that records are queued
+    condition_variable drained;      // signals LogFlush callers that a batch has been written
+    vector<LogRecord> queue;         // records waiting for the writer
+    uint64_t queuedCount = 0;        // records ever queued
+    uint64_t writtenCount = 0;       // records ever written
+    bool stopping = false;
+    bool running = false;
+    atomic<uint64_t> dropped{ 0 };
+    uint64_t droppedReported = 0;
+    thread worker;
+
+    LogWriter()
+    {
+        queue.reserve(LOG_QUEUE_SIZE);
+        running = true;
+        worker = thread(&LogWriter::Run, this);
+    }
+
+    void Run();
+
+public:
+
+    // created on first use and intentionally never destroyed, so logging from static destructors stays valid
+    static LogWriter& Instance()
+    {
+        static LogWriter* writer = []
+        {
+            LogWriter* created = new LogWriter();
+            atexit([] { LogWriter::Instance().Stop(); });
+            return created;
+        }();
+        return *writer;
+    }
+
+    void Push(int level, const char* text, size_t length);
+    void Flush();
+    void Stop();
+
+    uint64_t Dropped() const
+    {
+        return dropped.load(memory_order_relaxed);
+    }
+
+};
+
+
+// Function Name: WriteRecord
+// Function Description: Info and below go to stdout, warnings and errors to stderr
+static void WriteRecord(int level, const char* text, size_t length)
+{
+    FILE* stream = level >= LOG_LEVEL_WARN ? stderr : stdout;
+    fwrite(text, 1, length, stream);
+    fputc('\n', stream);
+}
+
+
+void LogWriter::Push(int level, const char* text, size_t length)
+{
+    unique_lock<mutex> guard(lock);
+    if (!running)
+    {
+        guard.unlock();
+        WriteRecord(level, text, length);
+        fflush(level >= LOG_LEVEL_WARN ? stderr : stdout);
+        return;
+    }
+
+    if (queue.size() >= LOG_QUEUE_SIZE)
+    {
+        dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    queue.emplace_back();
+    LogRecord& record = queue.back();
+    record.level = (uint8_t)level;
+    record.length = (uint16_t)length;
+    memcpy(record.text, text, length);
+    queuedCount++;
+
+    if (queue.size() == 1)
+        wake.notify_one();
+}
+
+
+void LogWriter::Run()
+{
+    vector<LogRecord> batch;
+    batch.reserve(LOG_QUEUE_SIZE);
+
+    unique_lock<mutex> guard(lock);
+    while (true)
+    {
+        wake.wait(guard, [this] { return stopping || !queue.empty(); });
+        if (queue.empty() && stopping)
+            break;
+
+        batch.swap(queue);
+        guard.unlock();
+
+        for (const LogRecord& record : batch)
+            WriteRecord(record.level, record.text, record.length);
+
+        const uint64_t droppedNow = dropped.load(memory_order_relaxed);
+        if (droppedNow != droppedReported)
+        {
+            fprintf(stderr, "(%llu log messages dropped, the log queue was full)\n", (unsigned long long)(droppedNow - droppedReported));
+            droppedReported = droppedNow;
+        }
+        fflush(stdout);
+        fflush(stderr);
+
+        guard.lock();
+        writtenCount += batch.size();
+        batch.clear();
+        drained.notify_all();
+    }
+}
+
+
+void LogWriter::Flush()
+{
+    unique_lock<mutex> guard(lock);
+    const uint64_t target = queuedCount;
+    drained.wait(guard, [this, target] { return writtenCount >= target || !running; });
+}
+
+
+void LogWriter::Stop()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        if (!running)
+            return;
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+
+    lock_guard<mutex> guard(lock);
+    running = false;
+    drained.notify_all();
+}
+
+
+
+void LogWrite(int level, const char* format, ...)
+{
+    char text[LOG_MAX_LINE];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (length < 0)
+        return;
+    if (length >= LOG_MAX_LINE)
+        length = LOG_MAX_LINE - 1;
+
+    LogWriter::Instance().Push(level, text, (size_t)length);
+}
+
+
+void LogFlush()
+{
+    LogWriter::Instance().Flush();
+}
+
+
+void LogSetLevel(int level)
+{
+    LogRuntimeLevel.store(level, memory_order_relaxed);
+}
+
+
+int LogParseLevel(const char* name)
+{
+    static const char* const names[] = { "trace", "debug", "info", "warn", "error", "off" };
+    for (int level = LOG_LEVEL_TRACE; level <= LOG_LEVEL_OFF; ++level)
+    {
+        if (strcmp(name, names[level]) == 0)
+            return level;
+    }
+    return -1;
+}
+
+
+uint64_t LogDropped()
+{
+    return LogWriter::Instance().Dropped();
+}
@@ -0,0 +1,123 @@
+// File Name: Log.h
+// Date: 2026-10
+// File Description:
+//      -- Leveled, asynchronous logging. A message is formatted on the calling thread into a fixed size record
+//      -- and queued; a background thread writes the queued records in batches (info and below to stdout,
+//      -- warnings and errors to stderr), so the packet loop never waits for the terminal.
+//      -- Levels below LOG_COMPILE_LEVEL compile to nothing, levels below the runtime level cost one branch,
+//      -- and LOG_LIMITED caps how often a call site may log per second.
+
+#ifndef _LOG_H_
+#define _LOG_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+
+#define LOG_LEVEL_TRACE  0   // per packet
+#define LOG_LEVEL_DEBUG  1   // per event of the transfer (negotiation, recovery)
+#define LOG_LEVEL_INFO   2   // progress the user wants to see (default)
+#define LOG_LEVEL_WARN   3
+#define LOG_LEVEL_ERROR  4
+#define LOG_LEVEL_OFF    5
+
+// Lowest level that is compiled in; the build sets it with RUDP_LOG_LEVEL
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+#define LOG_MAX_LINE     256    // longer messages are truncated
+#define LOG_QUEUE_SIZE   4096   // records waiting for the writer; further messages are dropped and counted
+
+
+// Lowest level written at runtime
+inline std::atomic<int> LogRuntimeLevel{ LOG_LEVEL_INFO };
+
+#define LOG_ENABLED(level) ((level) >= LOG_COMPILE_LEVEL && (level) >= LogRuntimeLevel.load(std::memory_order_relaxed))
+
+#define LOG_AT(level, ...) \
+    do { if (LOG_ENABLED(level)) LogWrite(level, __VA_ARGS__); } while (0)
+
+#define LOG_TRACE(...) LOG_AT(LOG_LEVEL_TRACE, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...)  LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...)  LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+// At most perSecond messages per second from this call site; the next one allowed reports how many were dropped
+#define LOG_LIMITED(level, perSecond, ...) \
+    do { \
+        if (LOG_ENABLED(level)) \
+        { \
+            static LogRateLimiter logLimiter_(perSecond); \
+            uint32_t logSuppressed_ = 0; \
+            if (logLimiter_.Allow(logSuppressed_)) \
+            { \
+                if (logSuppressed_ > 0) \
+                    LogWrite(level, "(%u similar messages suppressed)", logSuppressed_); \
+                LogWrite(level, __VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+
+
+// Function Name: LogWrite
+// Function Description: Formats one line (the newline is added) and queues it for the writer thread
+void LogWrite(int level, const char* format, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+// Function Name: LogFlush
+// Function Description: Returns once everything queued so far has been written
+void LogFlush();
+
+// Function Name: LogSetLevel / LogParseLevel
+// Function Description: LogParseLevel maps "trace", "debug", "info", "warn", "error" or "off" to a level, -1 if unknown
+void LogSetLevel(int level);
+int LogParseLevel(const char* name);
+
+// Function Name: LogDropped
+// Return Value: uint64_t - messages dropped because the queue was full
+uint64_t LogDropped();
+
+
+
+// Class Name: LogRateLimiter
+// Class Description: Fixed one second window per call site, see LOG_LIMITED
+class LogRateLimiter
+{
+
+private:
+
+    uint32_t perSecond;
+    std::atomic<int64_t> windowStart{ 0 };      // steady clock milliseconds
+    std::atomic<uint32_t> allowed{ 0 };         // messages let through in the current window
+    std::atomic<uint32_t> suppressed{ 0 };      // messages dropped since the last one let through
+
+public:
+
+    explicit LogRateLimiter(uint32_t perSecond) : perSecond(perSecond) {}
+
+    bool Allow(uint32_t& suppressedBefore)
+    {
+        const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t start = windowStart.load(std::memory_order_relaxed);
+        if (now - start >= 1000 && windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed))
+            allowed.store(0, std::memory_order_relaxed);
+
+        if (allowed.fetch_add(1, std::memory_order_relaxed) >= perSecond)
+        {
+            suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        suppressedBefore = suppressed.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+};
+
+#endif // !_LOG_H_
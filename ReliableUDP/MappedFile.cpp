@@ -0,0 +1,147 @@
+// File Name: MappedFile.cpp
+// Date: 2026-10
+// File Description:
+//      -- Implements MappedFile with mmap on Linux / macOS and CreateFileMapping on Windows.
+
+#include "MappedFile.h"
+#include "Log.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+
+// Function Name: Open
+// Parameters:
+//   - const char* path: file to map
+// Return Value: int - 0 on success, -1 on error (logged)
+int MappedFile::Open(const char* path)
+{
+    Close();
+
+#if defined(_WIN32)
+
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        LOG_ERROR("Cannot open file for mapping: %s", path);
+        return -1;
+    }
+
+    LARGE_INTEGER length;
+    if (!GetFileSizeEx(handle, &length))
+    {
+        LOG_ERROR("Cannot get the size of %s", path);
+        CloseHandle(handle);
+        return -1;
+    }
+    file = handle;
+    size = static_cast<size_t>(length.QuadPart);
+    open = true;
+    if (size == 0)
+        return 0;
+
+    mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping != NULL)
+        data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (data == nullptr)
+    {
+        LOG_ERROR("Cannot map %s", path);
+        Close();
+        return -1;
+    }
+
+#else
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        LOG_ERROR("Cannot open file for mapping: %s", path);
+        return -1;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        LOG_ERROR("Cannot get the size of %s", path);
+        close(fd);
+        return -1;
+    }
+    size = static_cast<size_t>(info.st_size);
+    open = true;
+    if (size == 0)
+    {
+        close(fd);
+        return 0;
+    }
+
+    // the mapping keeps its own reference to the file
+    void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED)
+    {
+        LOG_ERROR("Cannot map %s", path);
+        size = 0;
+        open = false;
+        return -1;
+    }
+    madvise(view, size, MADV_SEQUENTIAL);
+    data = static_cast<const uint8_t*>(view);
+
+#endif
+
+    return 0;
+}
+
+
+// Function Name: Close
+// Function Description: Releases the view; Data() is invalid afterwards
+void MappedFile::Close()
+{
+#if defined(_WIN32)
+    if (data != nullptr)
+        UnmapViewOfFile(data);
+    if (mapping != nullptr)
+        CloseHandle(mapping);
+    if (file != nullptr)
+        CloseHandle(file);
+    mapping = nullptr;
+    file = nullptr;
+#else
+    if (data != nullptr)
+        munmap(const_cast<uint8_t*>(data), size);
+#endif
+
+    data = nullptr;
+    size = 0;
+    open = false;
+}
+
+
+bool MappedFile::IsOpen() const
+{
+    return open;
+}
+
+
+const uint8_t* MappedFile::Data() const
+{
+    return data;
+}
+
+
+size_t MappedFile::Size() const
+{
+    return size;
+}
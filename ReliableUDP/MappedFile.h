@@ -0,0 +1,54 @@
+// File Name: MappedFile.h
+// Date: 2026-10
+// File Description:
+//      -- Read-only memory mapping of a whole file (mmap / MapViewOfFile).
+//      -- The zero-copy send path points datagram payloads straight at the mapping, so file bytes reach the
+//      -- kernel without being read into a buffer first.
+
+#ifndef _MAPPEDFILE_H_
+#define _MAPPEDFILE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+
+// Class Name: MappedFile
+// Class Description:
+//      -- Owns one read-only view of a file; the view stays valid until Close or destruction.
+class MappedFile
+{
+
+private:
+
+    const uint8_t* data = nullptr;   // First byte of the view (nullptr for an empty or unmapped file)
+    size_t size = 0;                 // Bytes in the view
+    bool open = false;               // A file is attached (an empty file is open but has no view)
+
+#if defined(_WIN32)
+    void* file = nullptr;            // HANDLE of the file
+    void* mapping = nullptr;         // HANDLE of the file mapping object
+#endif
+
+public:
+
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Maps the whole file read-only; returns 0 on success, -1 if it cannot be opened or mapped
+    int Open(const char* path);
+
+    // Unmaps the view and closes the file
+    void Close();
+
+    bool IsOpen() const;
+
+    const uint8_t* Data() const;
+
+    size_t Size() const;
+
+};
+
+#endif // !_MAPPEDFILE_H_
@@ -0,0 +1,387 @@
+// File Name: MessageChannel.cpp
+// Date: 2026-10
+// File Description:
+//      -- Implements MessageConnection: the send windows of the channels, bundling of due messages into
+//      -- datagrams, per-message acks from the connection's packet acks, and delivery on the receive side.
+
+#include "MessageChannel.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+using namespace net;
+
+
+// Function Name: MessageConnection
+// Function Description: Constructor; the connection must outlive the MessageConnection
+MessageConnection::MessageConnection(ReliableConnection& connection)
+    : connection(connection), sentBundles(MessageWindow)
+{
+}
+
+
+int MessageConnection::AddChannel(MessageChannelType type)
+{
+    if ((int)channels.size() >= MaxMessageChannels)
+        return -1;
+
+    channels.emplace_back();
+    Channel& channel = channels.back();
+    channel.type = type;
+    if (type != ChannelUnreliableSequenced)
+    {
+        channel.sendBuffer.resize(MessageWindow);
+        channel.receiveBuffer.resize(MessageWindow);
+    }
+    return (int)channels.size() - 1;
+}
+
+
+bool MessageConnection::Send(int channel, const void* data, int size)
+{
+    if (channel < 0 || channel >= (int)channels.size() || size < 0 || size > MaxMessageSize)
+        return false;
+
+    Channel& c = channels[channel];
+    const unsigned char* bytes = (const unsigned char*)data;
+
+    if (c.type == ChannelUnreliableSequenced)
+    {
+        if ((int)c.sendQueue.size() >= MessageWindow)
+            return false;
+        c.sendQueue.emplace_back();
+        c.sendQueue.back().id = c.nextSendId++;
+        c.sendQueue.back().data.assign(bytes, bytes + size);
+    }
+    else
+    {
+        if ((uint16_t)(c.nextSendId - c.oldestUnacked) >= MessageWindow)
+            return false;
+        OutgoingMessage& message = c.sendBuffer[c.nextSendId % MessageWindow];
+        message.pending = true;
+        message.sent = false;
+        message.id = c.nextSendId++;
+        message.data.assign(bytes, bytes + size);
+    }
+
+    stats.messagesSent++;
+    return true;
+}
+
+
+int MessageConnection::Receive(int& channel, void* data, int size)
+{
+    if (delivered.empty())
+        return 0;
+
+    const vector<unsigned char>& message = delivered.front().second;
+    if ((int)message.size() > size)
+        return -1;
+
+    channel = delivered.front().first;
+    const int bytes = (int)message.size();
+    if (bytes > 0)
+        memcpy(data, message.data(), bytes);
+    delivered.pop_front();
+    stats.messagesReceived++;
+    return bytes;
+}
+
+
+void MessageConnection::ProcessPacket(const unsigned char* data, int size)
+{
+    stats.bundlesReceived++;
+
+    int offset = 0;
+    while (offset < size)
+    {
+        if (size - offset < MessageHeaderSize)
+        {
+            LOG_LIMITED(LOG_LEVEL_WARN, 10, "Truncated message header in bundle");
+            return;
+        }
+        const int channel = data[offset];
+        const uint16_t id = wire::LoadBigEndian<uint16_t>(data + offset + 1);
+        const int length = wire::LoadBigEndian<uint16_t>(data + offset + 3);
+        offset += MessageHeaderSize;
+        if (channel >= (int)channels.size() || length > size - offset)
+        {
+            LOG_LIMITED(LOG_LEVEL_WARN, 10, "Invalid message in bundle: channel = %d, length = %d", channel, length);
+            return;
+        }
+        ReceiveMessage(channel, id, data + offset, length);
+        offset += length;
+    }
+}
+
+
+int MessageConnection::ReceivePackets()
+{
+    unsigned char packet[MessagePacketSize];
+    uint16_t stream = DefaultStream;
+    int bundles = 0;
+    int bytes;
+    while ((bytes = connection.ReceivePacket(packet, sizeof(packet), stream)) > 0)
+    {
+        if (stream != MessageStream)
+            continue;
+        ProcessPacket(packet, bytes);
+        bundles++;
+    }
+    return bundles;
+}
+
+
+void MessageConnection::Update()
+{
+    const uint64_t now = connection.GetClock().Now();
+    ProcessAcks(now);
+
+    int bundles = 0;
+    while (bundles < MaxBundlesPerUpdate && SendBundle(now))
+        bundles++;
+
+    // nothing to send, but the peer is waiting for acks of what it sent: an ack-only datagram, which takes no
+    // sequence number and is not acked itself
+    if (bundles == 0 && connection.GetUnackedPackets() > 0 && connection.IsConnected())
+        connection.SendAck();
+}
+
+
+void MessageConnection::Reset()
+{
+    for (Channel& c : channels)
+    {
+        const MessageChannelType type = c.type;
+        c = Channel();
+        c.type = type;
+        if (type != ChannelUnreliableSequenced)
+        {
+            c.sendBuffer.resize(MessageWindow);
+            c.receiveBuffer.resize(MessageWindow);
+        }
+    }
+    sentBundles.assign(MessageWindow, SentBundle());
+    delivered.clear();
+    rtt = -1.0;
+    stats = MessageStats();
+}
+
+
+float MessageConnection::GetResendDelay() const
+{
+    if (rtt < 0.0)
+        return InitialMessageResend;
+    return max(MinMessageResend, MessageResendFactor * (float)rtt);
+}
+
+
+// Function Name: ProcessAcks
+// Function Description: Marks the messages of every bundle the connection reported acked since its last Update
+void MessageConnection::ProcessAcks(uint64_t now)
+{
+    unsigned int* acks = nullptr;
+    int count = 0;
+    connection.GetReliabilitySystem().GetAcks(&acks, count);
+
+    for (int i = 0; i < count; ++i)
+    {
+        SentBundle& bundle = sentBundles[acks[i] % MessageWindow];
+        if (!bundle.valid || bundle.sequence != acks[i])
+            continue;
+
+        const double sample = NsToSeconds(now > bundle.time ? now - bundle.time : 0);
+        rtt = rtt < 0.0 ? sample : rtt + (sample - rtt) * 0.125;
+
+        for (const MessageRef& message : bundle.messages)
+            Acked(message);
+        bundle.valid = false;
+        bundle.messages.clear();
+    }
+}
+
+
+// Function Name: Acked
+// Function Description: One reliable message has arrived; the send window moves past every acked message at its start
+void MessageConnection::Acked(const MessageRef& message)
+{
+    Channel& c = channels[message.channel];
+    OutgoingMessage& slot = c.sendBuffer[message.id % MessageWindow];
+    if (!slot.pending || slot.id != message.id)
+        return; // an earlier copy was acked already
+
+    slot.pending = false;
+    slot.data.clear();
+    stats.messagesAcked++;
+
+    while (c.oldestUnacked != c.nextSendId && !c.sendBuffer[c.oldestUnacked % MessageWindow].pending)
+        c.oldestUnacked++;
+}
+
+
+// Function Name: Due
+// Function Description: True if a reliable message has never been sent or its last copy is older than the resend delay
+bool MessageConnection::Due(const OutgoingMessage& message, uint64_t now, uint64_t resendDelay) const
+{
+    return message.pending && (!message.sent || now - message.sendTime >= resendDelay);
+}
+
+
+// Function Name: Deliver
+// Function Description: Queues a message for Receive
+void MessageConnection::Deliver(int channel, const unsigned char* data, int size)
+{
+    delivered.emplace_back(channel, vector<unsigned char>(data, data + size));
+}
+
+
+// Function Name: ReceiveMessage
+// Function Description: Applies the channel's delivery rule to one message taken out of a bundle
+void MessageConnection::ReceiveMessage(int channel, uint16_t id, const unsigned char* data, int size)
+{
+    Channel& c = channels[channel];
+
+    if (c.type == ChannelUnreliableSequenced)
+    {
+        if (c.received && (int16_t)(id - c.newestReceived) <= 0)
+        {
+            stats.duplicates++;
+            return;
+        }
+        c.received = true;
+        c.newestReceived = id;
+        Deliver(channel, data, size);
+        return;
+    }
+
+    if (c.type == ChannelReliableUnordered)
+    {
+        // the sender never has more than MessageWindow messages unacked, so older ids were all delivered
+        const int ahead = (int16_t)(id - c.newestReceived);
+        IncomingMessage& slot = c.receiveBuffer[id % MessageWindow];
+        if (ahead <= -MessageWindow || (slot.valid && slot.id == id))
+        {
+            stats.duplicates++;
+            return;
+        }
+        slot.valid = true;
+        slot.id = id;
+        if (ahead > 0)
+            c.newestReceived = id;
+        Deliver(channel, data, size);
+        return;
+    }
+
+    // reliable ordered: buffer what arrives early, deliver from nextReceiveId on
+    const int ahead = (int16_t)(id - c.nextReceiveId);
+    if (ahead < 0)
+    {
+        stats.duplicates++;
+        return;
+    }
+    if (ahead >= MessageWindow)
+    {
+        LOG_LIMITED(LOG_LEVEL_WARN, 10, "Message %u outside the receive window of channel %d", (unsigned)id, channel);
+        return;
+    }
+
+    IncomingMessage& slot = c.receiveBuffer[id % MessageWindow];
+    if (slot.valid && slot.id == id)
+    {
+        stats.duplicates++;
+        return;
+    }
+    slot.valid = true;
+    slot.id = id;
+    slot.data.assign(data, data + size);
+
+    while (true)
+    {
+        IncomingMessage& next = c.receiveBuffer[c.nextReceiveId % MessageWindow];
+        if (!next.valid || next.id != c.nextReceiveId)
+            break;
+        delivered.emplace_back(channel, move(next.data));
+        next.valid = false;
+        next.data.clear();
+        c.nextReceiveId++;
+    }
+}
+
+
+// Function Name: SendBundle
+// Function Description:
+//      -- Sends one datagram with as many due messages as fit, oldest first in every channel: unacked reliable
+//      -- messages whose resend delay has passed, new ones, then queued unreliable ones. Returns false if
+//      -- nothing was due (or the connection would not send).
+bool MessageConnection::SendBundle(uint64_t now)
+{
+    unsigned char bundle[MessagePacketSize];
+    int size = 0;
+    bool resent = false;
+    vector<MessageRef> carried;
+    const uint64_t resendDelay = SecondsToNs(GetResendDelay());
+
+    auto append = [&](int channel, const OutgoingMessage& message) -> bool
+    {
+        if (size + MessageHeaderSize + (int)message.data.size() > MessagePacketSize)
+            return false;
+        bundle[size] = (unsigned char)channel;
+        wire::StoreBigEndian<uint16_t>(bundle + size + 1, message.id);
+        wire::StoreBigEndian<uint16_t>(bundle + size + 3, (uint16_t)message.data.size());
+        if (!message.data.empty())
+            memcpy(bundle + size + MessageHeaderSize, message.data.data(), message.data.size());
+        size += MessageHeaderSize + (int)message.data.size();
+        return true;
+    };
+
+    for (int channel = 0; channel < (int)channels.size(); ++channel)
+    {
+        Channel& c = channels[channel];
+        if (c.type == ChannelUnreliableSequenced)
+        {
+            while (!c.sendQueue.empty() && append(channel, c.sendQueue.front()))
+                c.sendQueue.pop_front();
+            continue;
+        }
+
+        for (uint16_t id = c.oldestUnacked; id != c.nextSendId; ++id)
+        {
+            OutgoingMessage& message = c.sendBuffer[id % MessageWindow];
+            if (!Due(message, now, resendDelay))
+                continue;
+            if (!append(channel, message))
+                break;
+            if (message.sent)
+            {
+                resent = true;
+                stats.messagesResent++;
+            }
+            message.sent = true;
+            message.sendTime = now;
+            carried.push_back({ (uint8_t)channel, id });
+        }
+    }
+
+    if (size == 0)
+        return false;
+
+    const unsigned int sequence = connection.GetReliabilitySystem().GetLocalSequence();
+    if (!connection.SendPacket(bundle, size, MessageStream))
+        return false;
+
+    stats.bundlesSent++;
+    if (resent && connection.GetMetrics())
+        connection.GetMetrics()->retransmits.Add();
+
+    if (!carried.empty())
+    {
+        SentBundle& sent = sentBundles[sequence % MessageWindow];
+        sent.valid = true;
+        sent.sequence = sequence;
+        sent.time = now;
+        sent.messages = move(carried);
+    }
+    return true;
+}
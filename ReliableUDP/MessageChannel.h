@@ -0,0 +1,168 @@
+// File Name: MessageChannel.h
+// Date: 2026-10
+// File Description:
+//      -- Message channels on top of a ReliableConnection, for applications that exchange many small messages
+//      -- instead of a file. Each channel is reliable-ordered, reliable-unordered or unreliable-sequenced.
+//      -- Queued messages of all channels are bundled into as few datagrams as fit in MessagePacketSize, so a
+//      -- message of a few bytes does not pay for a header and a syscall of its own. Every datagram remembers
+//      -- the messages it carried; when the connection reports the datagram acked, those messages are done, and
+//      -- a reliable message that stays unacked is bundled again on its own - never the whole datagram.
+//      -- Bundles travel on their own stream (MessageStream), so they can share a connection with file streams.
+
+#ifndef _MESSAGE_CHANNEL_H_
+#define _MESSAGE_CHANNEL_H_
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "Net.h"
+
+namespace net
+{
+	enum MessageChannelType
+	{
+		ChannelReliableOrdered,		// every message arrives, in the order sent
+		ChannelReliableUnordered,	// every message arrives once, as soon as it is in
+		ChannelUnreliableSequenced	// sent once; a message older than one already delivered is dropped
+	};
+
+	const uint16_t MessageStream = 0xFFFF;		// stream the bundles are sent on
+	const int MessagePacketSize = 256;			// payload bytes of a bundle, the same as a file transfer packet
+	const int MessageHeaderSize = 5;			// channel (1 byte), message id (2 bytes) and length (2 bytes)
+	const int MaxMessageSize = MessagePacketSize - MessageHeaderSize;
+	const int MaxMessageChannels = 8;
+	const int MessageWindow = 1024;				// unacked messages per reliable channel; also the receive window
+	const int MaxBundlesPerUpdate = 32;			// datagrams one Update may send
+	const float InitialMessageResend = 0.1f;	// seconds before an unacked message is sent again, until an RTT is measured
+	const float MinMessageResend = 0.02f;
+	const float MessageResendFactor = 1.5f;		// otherwise resend after this many round trips
+
+
+	// Struct Name: MessageStats
+	// Struct Description: Totals of one MessageConnection since it was created or Reset
+	struct MessageStats
+	{
+		uint64_t messagesSent = 0;		// messages queued by Send
+		uint64_t messagesResent = 0;	// copies of reliable messages sent again because they were not acked in time
+		uint64_t messagesAcked = 0;
+		uint64_t messagesReceived = 0;	// messages handed out by Receive
+		uint64_t duplicates = 0;		// copies received of messages already delivered (or older, on a sequenced channel)
+		uint64_t bundlesSent = 0;
+		uint64_t bundlesReceived = 0;
+	};
+
+
+	// Class Name: MessageConnection
+	// Class Description:
+	//      -- Message channels over one ReliableConnection, which it does not own. Both ends must add the same
+	//      -- channels in the same order. Per frame the application receives (ReceivePackets, or ProcessPacket for
+	//      -- the MessageStream payloads of its own receive loop), calls Update before the connection's Update (it
+	//      -- reads the acks the connection collected while receiving), and takes the messages out with Receive.
+	//      -- Update sends the bundles, or an ack-only datagram when packets arrived, so the peer gets its acks.
+	class MessageConnection
+	{
+	public:
+
+		explicit MessageConnection(ReliableConnection& connection);
+
+		// Function Name: AddChannel
+		// Function Description: Adds a channel and returns its id (the order of the calls), or -1 if there are MaxMessageChannels already
+		int AddChannel(MessageChannelType type);
+
+		// Function Name: Send
+		// Function Description: Queues a message of up to MaxMessageSize bytes; returns false if it is too big or the channel's window is full
+		bool Send(int channel, const void* data, int size);
+
+		// Function Name: Receive
+		// Function Description: Copies out the next delivered message and its channel; returns its size, 0 if none is waiting, -1 if size is too small
+		int Receive(int& channel, void* data, int size);
+
+		// Function Name: ProcessPacket
+		// Function Description: Takes in the payload of a packet the application received on MessageStream
+		void ProcessPacket(const unsigned char* data, int size);
+
+		// Function Name: ReceivePackets
+		// Function Description: Receives everything waiting on the connection; packets of other streams are dropped. Returns the bundles received
+		int ReceivePackets();
+
+		// Function Name: Update
+		// Function Description: Marks acked messages done and sends due messages in bundles; call before the connection's Update
+		void Update();
+
+		// Function Name: Reset
+		// Function Description: Forgets every queued and buffered message and restarts the message ids (keeps the channels), e.g. after a reconnect
+		void Reset();
+
+		const MessageStats& GetStats() const
+		{
+			return stats;
+		}
+
+		// Function Name: GetResendDelay
+		// Function Description: Seconds an unacked reliable message waits before it is sent again
+		float GetResendDelay() const;
+
+	private:
+
+		struct OutgoingMessage
+		{
+			bool pending = false;		// queued and not acked yet
+			uint16_t id = 0;
+			uint64_t sendTime = 0;		// last time a copy went out
+			bool sent = false;
+			std::vector<unsigned char> data;
+		};
+
+		struct IncomingMessage
+		{
+			bool valid = false;
+			uint16_t id = 0;
+			std::vector<unsigned char> data;
+		};
+
+		struct Channel
+		{
+			MessageChannelType type;
+			uint16_t nextSendId = 0;
+			uint16_t oldestUnacked = 0;			// reliable: the send window starts here
+			std::vector<OutgoingMessage> sendBuffer;	// reliable: MessageWindow slots, by id
+			std::deque<OutgoingMessage> sendQueue;		// unreliable: sent once, then forgotten
+			uint16_t nextReceiveId = 0;			// ordered: next message to deliver
+			uint16_t newestReceived = 0xFFFF;	// unordered and sequenced: newest id received so far
+			bool received = false;				// sequenced: newestReceived is set
+			std::vector<IncomingMessage> receiveBuffer;	// reliable: MessageWindow slots, by id
+		};
+
+		struct MessageRef
+		{
+			uint8_t channel;
+			uint16_t id;
+		};
+
+		// the reliable messages a datagram carried, kept in a ring by its sequence
+		struct SentBundle
+		{
+			bool valid = false;
+			unsigned int sequence = 0;
+			uint64_t time = 0;
+			std::vector<MessageRef> messages;
+		};
+
+		void ProcessAcks(uint64_t now);
+		void Acked(const MessageRef& message);
+		bool Due(const OutgoingMessage& message, uint64_t now, uint64_t resendDelay) const;
+		void Deliver(int channel, const unsigned char* data, int size);
+		void ReceiveMessage(int channel, uint16_t id, const unsigned char* data, int size);
+		bool SendBundle(uint64_t now);
+
+		ReliableConnection& connection;
+		std::vector<Channel> channels;
+		std::vector<SentBundle> sentBundles;
+		std::deque<std::pair<int, std::vector<unsigned char>>> delivered;	// in the order Receive hands them out
+		double rtt = -1.0;				// smoothed send to ack time of bundles, seconds (-1 until the first ack)
+		MessageStats stats;
+	};
+}
+
+#endif // !_MESSAGE_CHANNEL_H_
@@ -0,0 +1,314 @@
+// File Name: Metrics.cpp
+// Date: 2026-10
+// File Description:
+//      -- Implements histogram snapshots and percentiles, the metrics registry with its JSON and Prometheus
+//      -- text renderings, and the background file exporter.
+
+#include "Metrics.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+using namespace net;
+
+
+// What is exported, in order. Times are recorded in microseconds and exported in seconds.
+struct CounterInfo
+{
+    const char* json;
+    const char* prometheus;
+    const char* help;
+    Counter ConnectionMetrics::* member;
+};
+
+struct GaugeInfo
+{
+    const char* json;
+    const char* prometheus;
+    const char* help;
+    Gauge ConnectionMetrics::* member;
+    double scale;
+};
+
+struct HistogramInfo
+{
+    const char* json;
+    const char* prometheus;
+    const char* help;
+    Histogram ConnectionMetrics::* member;
+    double scale;
+};
+
+static const CounterInfo Counters[] =
+{
+    { "packetsSent", "rudp_packets_sent_total", "Reliable packets sent", &ConnectionMetrics::packetsSent },
+    { "packetsReceived", "rudp_packets_received_total", "Reliable packets received", &ConnectionMetrics::packetsReceived },
+    { "packetsAcked", "rudp_packets_acked_total", "Sent packets acked by the peer", &ConnectionMetrics::packetsAcked },
+    { "packetsLost", "rudp_packets_lost_total", "Sent packets not acked within the maximum RTT", &ConnectionMetrics::packetsLost },
+    { "bytesSent", "rudp_bytes_sent_total", "Payload bytes sent", &ConnectionMetrics::bytesSent },
+    { "bytesReceived", "rudp_bytes_received_total", "Payload bytes received", &ConnectionMetrics::bytesReceived },
+    { "retransmits", "rudp_retransmits_total", "Datagrams sent again after an earlier copy was lost", &ConnectionMetrics::retransmits },
+    { "kernelDrops", "rudp_kernel_drops_total", "Datagrams the kernel dropped because the socket receive buffer was full", &ConnectionMetrics::kernelDrops },
+    { "acksSent", "rudp_acks_sent_total", "Ack-only datagrams sent", &ConnectionMetrics::acksSent },
+};
+
+static const GaugeInfo Gauges[] =
+{
+    { "rttSeconds", "rudp_rtt_seconds", "Smoothed round trip time", &ConnectionMetrics::rtt, 1e-6 },
+    { "sentBandwidthBps", "rudp_sent_bandwidth_bits_per_second", "Sent bandwidth over the last maximum RTT", &ConnectionMetrics::sentBandwidth, 1.0 },
+    { "ackedBandwidthBps", "rudp_acked_bandwidth_bits_per_second", "Acked bandwidth over the last maximum RTT", &ConnectionMetrics::ackedBandwidth, 1.0 },
+    { "sentQueueDepth", "rudp_sent_queue_depth", "Packets in the sent queue", &ConnectionMetrics::sentQueueDepth, 1.0 },
+    { "pendingAckDepth", "rudp_pending_ack_queue_depth", "Packets sent and not yet acked", &ConnectionMetrics::pendingAckDepth, 1.0 },
+    { "receivedQueueDepth", "rudp_received_queue_depth", "Packets kept to build ack bits", &ConnectionMetrics::receivedQueueDepth, 1.0 },
+    { "ackedQueueDepth", "rudp_acked_queue_depth", "Packets in the acked queue", &ConnectionMetrics::ackedQueueDepth, 1.0 },
+    { "receiveBufferBytes", "rudp_socket_receive_buffer_bytes", "Socket receive buffer granted by the kernel", &ConnectionMetrics::receiveBuffer, 1.0 },
+    { "sendBufferBytes", "rudp_socket_send_buffer_bytes", "Socket send buffer granted by the kernel", &ConnectionMetrics::sendBuffer, 1.0 },
+};
+
+static const HistogramInfo Histograms[] =
+{
+    { "rttSamplesSeconds", "rudp_rtt_sample_seconds", "Send to ack time of every acked packet", &ConnectionMetrics::rttSamples, 1e-6 },
+    { "inFlight", "rudp_in_flight_packets", "Packets awaiting an ack, sampled every update", &ConnectionMetrics::inFlight, 1.0 },
+};
+
+static const double Quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+static const char* const QuantileNames[] = { "p50", "p90", "p99", "p999" };
+
+
+// Function Name: Append
+// Function Description: printf into the end of a string
+static void Append(string& out, const char* format, ...)
+{
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length > 0)
+        out.append(line, min((size_t)length, sizeof(line) - 1));
+}
+
+
+// Function Name: Percentile
+// Parameters:
+//   - double q: quantile in 0..1
+// Return Value: uint64_t - upper bound of the bucket holding the sample of rank ceil(q * count), clamped to max
+uint64_t HistogramSnapshot::Percentile(double q) const
+{
+    if (count == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)(q * (double)count + 0.999999);
+    if (rank < 1)
+        rank = 1;
+    if (rank > count)
+        rank = count;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+            return min(Histogram::BucketUpperBound((int)i), max);
+    }
+    return max;
+}
+
+
+// Function Name: Snapshot
+// Function Description:
+//      -- Copies the buckets. Samples recorded during the copy may be counted in the totals but not yet
+//      -- in a bucket (or the other way round); percentiles are computed from the bucket sum so they stay consistent.
+HistogramSnapshot Histogram::Snapshot() const
+{
+    HistogramSnapshot snapshot;
+    snapshot.buckets.resize(BucketCount);
+    uint64_t total = 0;
+    for (int i = 0; i < BucketCount; ++i)
+    {
+        snapshot.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+        total += snapshot.buckets[i];
+    }
+    snapshot.count = total;
+    snapshot.sum = sum.load(std::memory_order_relaxed);
+    snapshot.max = max.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+
+
+MetricsRegistry& MetricsRegistry::Global()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+
+shared_ptr<ConnectionMetrics> MetricsRegistry::Register(const string& name)
+{
+    shared_ptr<ConnectionMetrics> metrics = make_shared<ConnectionMetrics>();
+    metrics->name = name;
+    lock_guard<std::mutex> lock(mutex);
+    connections.push_back(metrics);
+    return metrics;
+}
+
+
+void MetricsRegistry::Unregister(const shared_ptr<ConnectionMetrics>& metrics)
+{
+    lock_guard<std::mutex> lock(mutex);
+    connections.erase(remove(connections.begin(), connections.end(), metrics), connections.end());
+}
+
+
+vector<shared_ptr<ConnectionMetrics>> MetricsRegistry::Connections() const
+{
+    lock_guard<std::mutex> lock(mutex);
+    return connections;
+}
+
+
+// Function Name: ToJson
+// Function Description: {"connections":[{"name":"30000","packetsSent":...,"rttSamplesSeconds":{"count":...,"p99":...}}]}
+string MetricsRegistry::ToJson() const
+{
+    vector<shared_ptr<ConnectionMetrics>> list = Connections();
+
+    string out = "{\"connections\":[";
+    for (size_t c = 0; c < list.size(); ++c)
+    {
+        const ConnectionMetrics& metrics = *list[c];
+        Append(out, "%s{\"name\":\"%s\"", c == 0 ? "" : ",", metrics.name.c_str());
+
+        for (const CounterInfo& info : Counters)
+            Append(out, ",\"%s\":%llu", info.json, (unsigned long long)(metrics.*info.member).Get());
+
+        for (const GaugeInfo& info : Gauges)
+            Append(out, ",\"%s\":%.9g", info.json, (double)(metrics.*info.member).Get() * info.scale);
+
+        for (const HistogramInfo& info : Histograms)
+        {
+            HistogramSnapshot snapshot = (metrics.*info.member).Snapshot();
+            Append(out, ",\"%s\":{\"count\":%llu,\"sum\":%.9g,\"max\":%.9g", info.json,
+                (unsigned long long)snapshot.count, (double)snapshot.sum * info.scale, (double)snapshot.max * info.scale);
+            for (size_t q = 0; q < sizeof(Quantiles) / sizeof(Quantiles[0]); ++q)
+                Append(out, ",\"%s\":%.9g", QuantileNames[q], (double)snapshot.Percentile(Quantiles[q]) * info.scale);
+            out += "}";
+        }
+        out += "}";
+    }
+    out += "]}\n";
+    return out;
+}
+
+
+// Function Name: ToPrometheus
+// Function Description: Prometheus text exposition format; histograms are exported as summaries with quantiles
+string MetricsRegistry::ToPrometheus() const
+{
+    vector<shared_ptr<ConnectionMetrics>> list = Connections();
+    string out;
+
+    for (const CounterInfo& info : Counters)
+    {
+        Append(out, "# HELP %s %s\n# TYPE %s counter\n", info.prometheus, info.help, info.prometheus);
+        for (const shared_ptr<ConnectionMetrics>& metrics : list)
+            Append(out, "%s{connection=\"%s\"} %llu\n", info.prometheus, metrics->name.c_str(),
+                (unsigned long long)((*metrics).*info.member).Get());
+    }
+
+    for (const GaugeInfo& info : Gauges)
+    {
+        Append(out, "# HELP %s %s\n# TYPE %s gauge\n", info.prometheus, info.help, info.prometheus);
+        for (const shared_ptr<ConnectionMetrics>& metrics : list)
+            Append(out, "%s{connection=\"%s\"} %.9g\n", info.prometheus, metrics->name.c_str(),
+                (double)((*metrics).*info.member).Get() * info.scale);
+    }
+
+    for (const HistogramInfo& info : Histograms)
+    {
+        Append(out, "# HELP %s %s\n# TYPE %s summary\n", info.prometheus, info.help, info.prometheus);
+        for (const shared_ptr<ConnectionMetrics>& metrics : list)
+        {
+            HistogramSnapshot snapshot = ((*metrics).*info.member).Snapshot();
+            for (double q : Quantiles)
+                Append(out, "%s{connection=\"%s\",quantile=\"%g\"} %.9g\n", info.prometheus, metrics->name.c_str(),
+                    q, (double)snapshot.Percentile(q) * info.scale);
+            Append(out, "%s_sum{connection=\"%s\"} %.9g\n", info.prometheus, metrics->name.c_str(), (double)snapshot.sum * info.scale);
+            Append(out, "%s_count{connection=\"%s\"} %llu\n", info.prometheus, metrics->name.c_str(), (unsigned long long)snapshot.count);
+        }
+    }
+
+    return out;
+}
+
+
+// Function Name: WriteFile
+// Function Description: Writes a temporary file and renames it over path, so readers never see a partial file
+int MetricsRegistry::WriteFile(const string& path) const
+{
+    const bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    const string text = json ? ToJson() : ToPrometheus();
+
+    const string tempPath = path + ".tmp";
+#pragma warning(suppress : 4996)
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file)
+    {
+        LOG_ERROR("Cannot write metrics file: %s", tempPath.c_str());
+        return -1;
+    }
+    const bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+    if (fclose(file) != 0 || !written)
+    {
+        LOG_ERROR("Failed to write metrics file: %s", tempPath.c_str());
+        return -1;
+    }
+
+    remove(path.c_str()); // rename does not replace an existing file on Windows
+    if (rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        LOG_ERROR("Failed to replace metrics file: %s", path.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+
+
+MetricsExporter::MetricsExporter(const MetricsRegistry& registry, const string& path, float intervalSeconds)
+    : registry(registry), path(path), intervalSeconds(intervalSeconds)
+{
+    worker = thread(&MetricsExporter::Run, this);
+}
+
+
+MetricsExporter::~MetricsExporter()
+{
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+    registry.WriteFile(path);
+}
+
+
+void MetricsExporter::Run()
+{
+    const chrono::microseconds interval((long long)(intervalSeconds * 1e6f));
+
+    unique_lock<std::mutex> lock(mutex);
+    while (!wake.wait_for(lock, interval, [this] { return stopping; }))
+    {
+        lock.unlock();
+        registry.WriteFile(path);
+        lock.lock();
+    }
+}
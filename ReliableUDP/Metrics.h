@@ -0,0 +1,239 @@
+// File Name: Metrics.h
+// Date: 2026-10
+// File Description:
+//      -- Per-connection transfer metrics: relaxed atomic counters and gauges plus log-linear (HDR style)
+//      -- histograms. The connection records into them as events happen, so any thread can scrape a
+//      -- consistent-enough snapshot at any time without locks on the packet path and without walking queues.
+//      -- MetricsRegistry lists the live connections and renders them as JSON or Prometheus text;
+//      -- MetricsExporter rewrites such a file periodically from a background thread.
+
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h> // for _BitScanReverse64
+#endif
+
+namespace net
+{
+	// Class Name: Counter
+	// Class Description: Monotonic event count, never reset for the lifetime of the connection
+	class Counter
+	{
+	public:
+
+		void Add(uint64_t n = 1)
+		{
+			value.fetch_add(n, std::memory_order_relaxed);
+		}
+
+		uint64_t Get() const
+		{
+			return value.load(std::memory_order_relaxed);
+		}
+
+	private:
+
+		std::atomic<uint64_t> value{ 0 };
+	};
+
+
+	// Class Name: Gauge
+	// Class Description: Last sampled value of a level (queue depth, bandwidth, smoothed RTT)
+	class Gauge
+	{
+	public:
+
+		void Set(int64_t v)
+		{
+			value.store(v, std::memory_order_relaxed);
+		}
+
+		int64_t Get() const
+		{
+			return value.load(std::memory_order_relaxed);
+		}
+
+	private:
+
+		std::atomic<int64_t> value{ 0 };
+	};
+
+
+	// Copy of a Histogram taken by a scraper
+	struct HistogramSnapshot
+	{
+		uint64_t count = 0;
+		uint64_t sum = 0;
+		uint64_t max = 0;
+		std::vector<uint64_t> buckets;
+
+		// value at quantile q (0..1): upper bound of the bucket holding it, never above the largest value recorded
+		uint64_t Percentile(double q) const;
+	};
+
+
+	// Class Name: Histogram
+	// Class Description:
+	//      -- Distribution of unsigned integer samples in log-linear buckets: values below 16 are exact, above
+	//      -- that every power of two is split into 16 sub-buckets, so any value is reported within 1/16 (6.25%).
+	//      -- Recording is two relaxed atomic adds and a rarely contended max update.
+	class Histogram
+	{
+	public:
+
+		static const int SubBucketBits = 4;
+		static const int SubBuckets = 1 << SubBucketBits;
+		static const int BucketCount = (64 - SubBucketBits + 1) * SubBuckets;
+
+		Histogram()
+		{
+			for (int i = 0; i < BucketCount; ++i)
+				buckets[i].store(0, std::memory_order_relaxed);
+		}
+
+		void Record(uint64_t value)
+		{
+			buckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+			sum.fetch_add(value, std::memory_order_relaxed);
+			uint64_t seen = max.load(std::memory_order_relaxed);
+			while (value > seen && !max.compare_exchange_weak(seen, value, std::memory_order_relaxed))
+				;
+		}
+
+		HistogramSnapshot Snapshot() const;
+
+		static int BucketIndex(uint64_t value)
+		{
+			if (value < (uint64_t)SubBuckets)
+				return (int)value;
+			const int shift = HighestBit(value) - SubBucketBits;
+			return (shift + 1) * SubBuckets + (int)((value >> shift) - SubBuckets);
+		}
+
+		// largest value that falls into bucket index
+		static uint64_t BucketUpperBound(int index)
+		{
+			if (index < SubBuckets)
+				return (uint64_t)index;
+			const int shift = index / SubBuckets - 1;
+			const uint64_t lower = (uint64_t)(index % SubBuckets + SubBuckets) << shift;
+			return lower + ((1ULL << shift) - 1);
+		}
+
+	private:
+
+		static int HighestBit(uint64_t value)
+		{
+#if defined(_MSC_VER)
+			unsigned long bit;
+			_BitScanReverse64(&bit, value);
+			return (int)bit;
+#else
+			return 63 - __builtin_clzll(value);
+#endif
+		}
+
+		std::atomic<uint64_t> buckets[BucketCount];
+		std::atomic<uint64_t> sum{ 0 };
+		std::atomic<uint64_t> max{ 0 };
+	};
+
+
+	// Struct Name: ConnectionMetrics
+	// Struct Description: Everything recorded about one ReliableConnection; times are in microseconds, bandwidth in bits per second
+	struct ConnectionMetrics
+	{
+		std::string name;                   // "connection" label, the local port
+
+		Counter packetsSent;
+		Counter packetsReceived;
+		Counter packetsAcked;
+		Counter packetsLost;                // not acked within rtt_maximum
+		Counter bytesSent;                  // payload bytes (without the connection and reliability headers)
+		Counter bytesReceived;
+		Counter retransmits;                // datagrams the application sent again because an earlier copy was lost
+		Counter kernelDrops;                // datagrams the kernel dropped because the socket receive buffer was full
+		Counter acksSent;                   // ack-only datagrams (not counted in packetsSent)
+
+		Gauge rtt;                          // smoothed round trip time
+		Gauge sentBandwidth;
+		Gauge ackedBandwidth;
+		Gauge sentQueueDepth;
+		Gauge pendingAckDepth;              // packets in flight
+		Gauge receivedQueueDepth;
+		Gauge ackedQueueDepth;
+		Gauge receiveBuffer;                // socket buffer sizes in bytes, as granted by the kernel
+		Gauge sendBuffer;
+
+		Histogram rttSamples;               // send to ack of every acked packet, i.e. the delivery latency of its block
+		Histogram inFlight;                 // pendingAckDepth sampled once per update
+	};
+
+
+	// Class Name: MetricsRegistry
+	// Class Description:
+	//      -- The set of live ConnectionMetrics. Its mutex is only taken to register, unregister and scrape;
+	//      -- connections record through their own shared_ptr, so a scrape never blocks the packet path.
+	class MetricsRegistry
+	{
+	public:
+
+		// process wide registry every ReliableConnection registers with
+		static MetricsRegistry& Global();
+
+		std::shared_ptr<ConnectionMetrics> Register(const std::string& name);
+		void Unregister(const std::shared_ptr<ConnectionMetrics>& metrics);
+
+		std::vector<std::shared_ptr<ConnectionMetrics>> Connections() const;
+
+		std::string ToJson() const;
+		std::string ToPrometheus() const;
+
+		// writes ToJson() if the path ends in ".json", otherwise ToPrometheus(), replacing the file atomically; 0 on success
+		int WriteFile(const std::string& path) const;
+
+	private:
+
+		mutable std::mutex mutex;
+		std::vector<std::shared_ptr<ConnectionMetrics>> connections;
+	};
+
+
+	// Class Name: MetricsExporter
+	// Class Description: Rewrites a metrics file every interval from its own thread (e.g. for a node_exporter textfile collector)
+	class MetricsExporter
+	{
+	public:
+
+		MetricsExporter(const MetricsRegistry& registry, const std::string& path, float intervalSeconds);
+		~MetricsExporter(); // writes the file one last time
+
+		MetricsExporter(const MetricsExporter&) = delete;
+		MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+	private:
+
+		void Run();
+
+		const MetricsRegistry& registry;
+		std::string path;
+		float intervalSeconds;
+
+		std::mutex mutex;
+		std::condition_variable wake;
+		bool stopping = false;
+		std::thread worker;
+	};
+}
+
+#endif // !_METRICS_H_
@@ -8,6 +8,11 @@
 #define NET_H
 
 #include <cstring> // for memcpy
+#include "Serialize.h"
+#include "Metrics.h"
+#include "Log.h"
+#include "Trace.h"
+#include "IoRing.h"
 
 // platform detection
 
@@ -27,12 +32,17 @@
 
 #include <winsock2.h>
 #pragma comment( lib, "wsock32.lib" )
+#pragma comment( lib, "ws2_32.lib" )	// WSASendTo
 
 #elif PLATFORM == PLATFORM_MAC || PLATFORM == PLATFORM_UNIX
 
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
 
 #else
 
@@ -41,32 +51,158 @@
 #endif
 
 #include <assert.h>
+#include <stdio.h>
 #include <vector>
 #include <map>
 #include <stack>
 #include <list>
 #include <algorithm>
 #include <functional>
+#include <chrono>
+#include <deque>
+#include <memory>
 
 const int PacketSizeHack = 256 + 128;
 
 namespace net
 {
+	// wire headers
+	//  + every datagram starts with the connection header (protocol id)
+	//  + reliable connections follow it with the reliability header (sequence, ack, ack bits, stream)
+	//  + or, in an ack-only datagram, with the ack and ack bits alone (always shorter than a reliability header)
+
+	struct ConnectionHeader
+	{
+		uint32_t protocolId;
+	};
+
+	struct ReliableHeader
+	{
+		uint32_t sequence;
+		uint32_t ack;
+		uint32_t ack_bits;
+		uint16_t stream;	// independent stream the payload belongs to; sequence and acks are shared by all streams
+	};
+
+	const uint16_t DefaultStream = 0;
+
+	typedef wire::Layout<4,
+		wire::Field<&ConnectionHeader::protocolId>> ConnectionHeaderLayout;
+
+	typedef wire::Layout<14,
+		wire::Field<&ReliableHeader::sequence>,
+		wire::Field<&ReliableHeader::ack>,
+		wire::Field<&ReliableHeader::ack_bits>,
+		wire::Field<&ReliableHeader::stream>> ReliableHeaderLayout;
+
+	struct AckHeader
+	{
+		uint32_t ack;
+		uint32_t ack_bits;
+	};
+
+	typedef wire::Layout<8,
+		wire::Field<&AckHeader::ack>,
+		wire::Field<&AckHeader::ack_bits>> AckHeaderLayout;
+
+
 	// platform independent wait for n seconds
 
 #if PLATFORM == PLATFORM_WINDOWS
 
-	void wait(float seconds)
+	inline void wait(float seconds)
 	{
 		Sleep((int)(seconds * 1000.0f));
 	}
 
 #else
 
-#include <unistd.h>
-	void wait(float seconds) { usleep((int)(seconds * 1000000.0f)); }
+	inline void wait(float seconds) { usleep((int)(seconds * 1000000.0f)); }
+
+#endif
+
 
+	// Function Name: PinThread
+	// Function Description: Pins the calling thread to one CPU, so a busy-polling loop is never migrated; false where unsupported (macOS) or refused
+	inline bool PinThread(int cpu)
+	{
+#if PLATFORM == PLATFORM_WINDOWS
+		return cpu >= 0 && cpu < 64 && SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#elif defined(__linux__)
+		if (cpu < 0 || cpu >= CPU_SETSIZE)
+			return false;
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+		(void)cpu;
+		return false;
 #endif
+	}
+
+
+	// monotonic time
+	//  + every timestamp in the stack is nanoseconds on one monotonic clock, read when the event happens
+	//  + simulations install a ManualClock and advance it themselves
+
+	inline uint64_t MonotonicNs()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	inline uint64_t SecondsToNs(double seconds)
+	{
+		return (uint64_t)(seconds * 1000000000.0);
+	}
+
+	inline double NsToSeconds(uint64_t ns)
+	{
+		return ns / 1000000000.0;
+	}
+
+	// Class Name: Clock
+	// Class Description: Time source of a connection; the default reads the monotonic clock
+	class Clock
+	{
+	public:
+
+		virtual ~Clock() {}
+
+		virtual uint64_t Now() const
+		{
+			return MonotonicNs();
+		}
+
+		// shared default instance
+		static const Clock& System()
+		{
+			static Clock clock;
+			return clock;
+		}
+	};
+
+	// Class Name: ManualClock
+	// Class Description: Clock that only moves when told to, for simulated time
+	class ManualClock : public Clock
+	{
+	public:
+
+		uint64_t Now() const
+		{
+			return now;
+		}
+
+		void Advance(uint64_t ns)
+		{
+			now += ns;
+		}
+
+	private:
+
+		uint64_t now = 0;
+	};
 
 
 
@@ -183,6 +319,34 @@ namespace net
 
 
 
+	// scatter-gather sends
+	//  + a datagram can be sent from several buffers (headers, then payload) without copying them together first
+	//  + each layer prepends its header as one more segment
+
+	struct PacketSegment
+	{
+		const void* data;
+		int size;
+	};
+
+	const int MaxPacketSegments = 8;	// segments one datagram may be gathered from, headers included
+
+	const int RingReceiveSlots = 32;	// receives kept queued on the io_uring of a socket
+	const int RingSendSlots = 32;		// sends that may be in flight on the io_uring of a socket
+
+
+	// socket buffers
+	//  + the kernel drops datagrams silently once the receive buffer is full, which looks like network loss
+	//  + a connection sizes its buffers from the datagram rate times (RTT + the gap between two Updates), i.e. the bandwidth-delay product
+	//  + the drops the kernel still makes are counted through SO_RXQ_OVFL (Linux) and double the receive buffer
+
+	const int MinSocketBuffer = 256 * 1024;			// bytes; the buffers are never tuned below this
+	const int MaxSocketBuffer = 16 * 1024 * 1024;	// bytes; and never above this (Linux also caps at net.core.rmem_max / wmem_max)
+	const int DatagramOverhead = 1024;				// bytes of kernel bookkeeping (sk_buff) charged to the buffer per queued datagram
+	const float BufferHeadroom = 2.0f;				// buffer = headroom * bandwidth-delay product
+	const float BufferTuneInterval = 0.5f;			// seconds between two sizings
+
+
 	// Class Name: Socket
 	// Class Description: Encapsulates UDP socket operations
 	class Socket
@@ -201,8 +365,8 @@ namespace net
 
 
 		// Function Name: Open
-		// Function Description: Create and bind a UDP socket
-		bool Open(unsigned short port)
+		// Function Description: Creates a UDP socket and binds port on the interface with IPv4 address localAddress (host order, 0 = every interface)
+		bool Open(unsigned short port, unsigned int localAddress = 0)
 		{
 			assert(!IsOpen());
 
@@ -212,7 +376,7 @@ namespace net
 
 			if (socket <= 0)
 			{
-				printf("failed to create socket\n");
+				LOG_ERROR("failed to create socket");
 				socket = 0;
 				return false;
 			}
@@ -221,16 +385,27 @@ namespace net
 
 			sockaddr_in address;
 			address.sin_family = AF_INET;
-			address.sin_addr.s_addr = INADDR_ANY;
+			address.sin_addr.s_addr = localAddress != 0 ? htonl(localAddress) : INADDR_ANY;
 			address.sin_port = htons((unsigned short)port);
 
 			if (::bind(socket, (const sockaddr*)&address, sizeof(sockaddr_in)) < 0)
 			{
-				printf("failed to bind socket\n");
+				LOG_ERROR("failed to bind socket");
 				Close();
 				return false;
 			}
 
+			// count the datagrams the kernel drops for want of receive buffer; Receive reads the count
+
+#if defined(SO_RXQ_OVFL)
+			int enable = 1;
+			if (setsockopt(socket, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable)) != 0)
+				LOG_DEBUG("SO_RXQ_OVFL not supported, kernel drops are not counted");
+#endif
+			kernelDrops = 0;
+			receiveBufferSize = GetBufferOption(SO_RCVBUF);
+			sendBufferSize = GetBufferOption(SO_SNDBUF);
+
 			// set non-blocking io
 
 #if PLATFORM == PLATFORM_MAC || PLATFORM == PLATFORM_UNIX
@@ -238,7 +413,7 @@ namespace net
 			int nonBlocking = 1;
 			if (fcntl(socket, F_SETFL, O_NONBLOCK, nonBlocking) == -1)
 			{
-				printf("failed to set non-blocking socket\n");
+				LOG_ERROR("failed to set non-blocking socket");
 				Close();
 				return false;
 			}
@@ -248,7 +423,7 @@ namespace net
 			DWORD nonBlocking = 1;
 			if (ioctlsocket(socket, FIONBIO, &nonBlocking) != 0)
 			{
-				printf("failed to set non-blocking socket\n");
+				LOG_ERROR("failed to set non-blocking socket");
 				Close();
 				return false;
 			}
@@ -260,6 +435,10 @@ namespace net
 
 		void Close()
 		{
+#if RUDP_HAVE_IO_URING
+			if (ring)
+				ReleaseRing();
+#endif
 			if (socket != 0)
 			{
 #if PLATFORM == PLATFORM_MAC || PLATFORM == PLATFORM_UNIX
@@ -276,6 +455,117 @@ namespace net
 			return socket != 0;
 		}
 
+		// Function Name: GetHandle
+		// Function Description: The socket descriptor, to wait for it in poll / WSAPoll (0 when closed)
+		int GetHandle() const
+		{
+			return socket;
+		}
+
+		// Function Name: SetBufferSizes
+		// Function Description:
+		//			- Asks for receiveBytes / sendBytes of kernel buffer (0 leaves that one alone), counted the way the kernel
+		//			- charges it, overhead per datagram included. Beyond net.core.rmem_max / wmem_max Linux only grants more
+		//			- with CAP_NET_ADMIN (SO_RCVBUFFORCE). Returns false if a buffer stayed smaller than asked for
+		bool SetBufferSizes(int receiveBytes, int sendBytes)
+		{
+			if (socket == 0)
+				return false;
+			bool granted = true;
+			if (receiveBytes > 0)
+			{
+#if defined(SO_RCVBUFFORCE)
+				receiveBufferSize = SetBufferOption(SO_RCVBUF, SO_RCVBUFFORCE, receiveBytes);
+#else
+				receiveBufferSize = SetBufferOption(SO_RCVBUF, 0, receiveBytes);
+#endif
+				granted = receiveBufferSize >= receiveBytes;
+			}
+			if (sendBytes > 0)
+			{
+#if defined(SO_SNDBUFFORCE)
+				sendBufferSize = SetBufferOption(SO_SNDBUF, SO_SNDBUFFORCE, sendBytes);
+#else
+				sendBufferSize = SetBufferOption(SO_SNDBUF, 0, sendBytes);
+#endif
+				granted = granted && sendBufferSize >= sendBytes;
+			}
+			return granted;
+		}
+
+		// Function Name: SetBusyPoll
+		// Function Description:
+		//			- Lets a receive on the socket poll the device queue for up to microseconds instead of waiting for
+		//			- the interrupt (Linux SO_BUSY_POLL; above net.core.busy_read it needs CAP_NET_ADMIN). false where unsupported
+		bool SetBusyPoll(int microseconds)
+		{
+			if (socket == 0)
+				return false;
+#if defined(SO_BUSY_POLL)
+			return setsockopt(socket, SOL_SOCKET, SO_BUSY_POLL, &microseconds, sizeof(microseconds)) == 0;
+#else
+			(void)microseconds;
+			return false;
+#endif
+		}
+
+		int GetReceiveBufferSize() const
+		{
+			return receiveBufferSize;
+		}
+
+		int GetSendBufferSize() const
+		{
+			return sendBufferSize;
+		}
+
+		// Function Name: GetKernelDrops
+		// Function Description: Datagrams the kernel dropped because the receive buffer was full (Linux only, 0 elsewhere); reported with the next datagram that is queued
+		unsigned int GetKernelDrops() const
+		{
+			return kernelDrops;
+		}
+
+		// Function Name: UseRing
+		// Function Description:
+		//			- Moves the sends and receives of the open socket onto ring (Linux io_uring): receives stay queued
+		//			- in the kernel, sends are queued, and both are handed over with one system call per Flush
+		//			- The ring must outlive the socket; returns false where io_uring is unavailable
+		bool UseRing(IoRing& ring)
+		{
+			assert(IsOpen());
+#if RUDP_HAVE_IO_URING
+			if (!ring.IsOpen() || this->ring)
+				return false;
+			this->ring = &ring;
+			for (int i = 0; i < RingReceiveSlots; ++i)
+			{
+				receives.emplace_back(new RingReceive(*this));
+				ArmReceive(*receives.back());
+			}
+			for (int i = 0; i < RingSendSlots; ++i)
+			{
+				sends.emplace_back(new RingSend(*this));
+				freeSends.push_back(sends.back().get());
+			}
+			ring.Submit();
+			return true;
+#else
+			(void)ring;
+			return false;
+#endif
+		}
+
+		// Function Name: Flush
+		// Function Description: Hands the queued io_uring sends and receives to the kernel; nothing to do without a ring
+		void Flush()
+		{
+#if RUDP_HAVE_IO_URING
+			if (ring)
+				ring->Submit();
+#endif
+		}
+
 
 		// Function Name: Send
 		// Function Description: Send Packet
@@ -295,11 +585,83 @@ namespace net
 			address.sin_addr.s_addr = htonl(destination.GetAddress());
 			address.sin_port = htons((unsigned short)destination.GetPort());
 
+#if RUDP_HAVE_IO_URING
+			if (ring)
+			{
+				PacketSegment segment = { data, size };
+				return SendOnRing(address, &segment, 1);
+			}
+#endif
+
 			int sent_bytes = sendto(socket, (const char*)data, size, 0, (sockaddr*)&address, sizeof(sockaddr_in));
 
 			return sent_bytes == size;
 		}
 
+		// Function Name: Send
+		// Function Description: Sends one datagram gathered from count segments by the kernel (sendmsg / WSASendTo)
+		bool Send(const Address& destination, const PacketSegment segments[], int count)
+		{
+			assert(segments);
+			assert(count > 0 && count <= MaxPacketSegments);
+
+			if (socket == 0)
+				return false;
+
+			assert(destination.GetAddress() != 0);
+			assert(destination.GetPort() != 0);
+
+			sockaddr_in address;
+			address.sin_family = AF_INET;
+			address.sin_addr.s_addr = htonl(destination.GetAddress());
+			address.sin_port = htons((unsigned short)destination.GetPort());
+
+			int size = 0;
+
+#if RUDP_HAVE_IO_URING
+			if (ring)
+				return SendOnRing(address, segments, count);
+#endif
+
+#if PLATFORM == PLATFORM_MAC || PLATFORM == PLATFORM_UNIX
+
+			iovec vectors[MaxPacketSegments];
+			for (int i = 0; i < count; ++i)
+			{
+				vectors[i].iov_base = const_cast<void*>(segments[i].data);
+				vectors[i].iov_len = (size_t)segments[i].size;
+				size += segments[i].size;
+			}
+
+			msghdr message = {};
+			message.msg_name = &address;
+			message.msg_namelen = sizeof(sockaddr_in);
+			message.msg_iov = vectors;
+			message.msg_iovlen = count;
+
+			ssize_t sent_bytes = sendmsg(socket, &message, 0);
+
+			return sent_bytes == size;
+
+#elif PLATFORM == PLATFORM_WINDOWS
+
+			WSABUF buffers[MaxPacketSegments];
+			for (int i = 0; i < count; ++i)
+			{
+				buffers[i].buf = (CHAR*)segments[i].data;
+				buffers[i].len = (ULONG)segments[i].size;
+				size += segments[i].size;
+			}
+
+			DWORD sent_bytes = 0;
+			if (WSASendTo(socket, buffers, (DWORD)count, &sent_bytes, 0, (sockaddr*)&address, sizeof(sockaddr_in), NULL, NULL) != 0)
+				return false;
+
+			return (int)sent_bytes == size;
+
+#endif
+		}
+
 		int Receive(Address& sender, void* data, int size)
 		{
 			assert(data);
@@ -308,17 +670,45 @@ namespace net
 			if (socket == 0)
 				return false;
 
+#if RUDP_HAVE_IO_URING
+			if (ring)
+				return ReceiveOnRing(sender, data, size);
+#endif
+
 #if PLATFORM == PLATFORM_WINDOWS
 			typedef int socklen_t;
 #endif
 
 			sockaddr_in from;
+
+#if defined(SO_RXQ_OVFL)
+			iovec vector;
+			vector.iov_base = data;
+			vector.iov_len = (size_t)size;
+			unsigned char control[DropControlSize];
+
+			msghdr message = {};
+			message.msg_name = &from;
+			message.msg_namelen = sizeof(from);
+			message.msg_iov = &vector;
+			message.msg_iovlen = 1;
+			message.msg_control = control;
+			message.msg_controllen = sizeof(control);
+
+			int received_bytes = (int)recvmsg(socket, &message, 0);
+
+			if (received_bytes <= 0)
+				return 0;
+
+			ReadKernelDrops(message);
+#else
 			socklen_t fromLength = sizeof(from);
 
 			int received_bytes = recvfrom(socket, (char*)data, size, 0, (sockaddr*)&from, &fromLength);
 
 			if (received_bytes <= 0)
 				return 0;
+#endif
 
 			unsigned int address = ntohl(from.sin_addr.s_addr);
 			unsigned short port = ntohs(from.sin_port);
@@ -330,7 +720,423 @@ namespace net
 
 	private:
 
+#if PLATFORM == PLATFORM_WINDOWS
+		typedef int socklen_t;
+#endif
+
+		int GetBufferOption(int option) const
+		{
+			int bytes = 0;
+			socklen_t length = sizeof(bytes);
+			if (getsockopt(socket, SOL_SOCKET, option, (char*)&bytes, &length) != 0)
+				return 0;
+			return bytes;
+		}
+
+		// sets the option (then forceOption, if the plain one was capped) and returns the size the kernel reports
+		int SetBufferOption(int option, int forceOption, int bytes)
+		{
+#if defined(__linux__)
+			const int request = bytes / 2 + bytes % 2; // Linux doubles the value for its bookkeeping and reports the doubled size
+#else
+			const int request = bytes;
+#endif
+			setsockopt(socket, SOL_SOCKET, option, (const char*)&request, sizeof(request));
+			int reported = GetBufferOption(option);
+			if (reported < bytes && forceOption != 0)
+			{
+				setsockopt(socket, SOL_SOCKET, forceOption, (const char*)&request, sizeof(request));
+				reported = GetBufferOption(option);
+			}
+			return reported;
+		}
+
+#if defined(SO_RXQ_OVFL)
+		static const int DropControlSize = CMSG_SPACE(sizeof(uint32_t));
+
+		// the kernel attaches its running drop count to every datagram queued after the first drop
+		void ReadKernelDrops(msghdr& message)
+		{
+			for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header))
+			{
+				if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SO_RXQ_OVFL)
+				{
+					uint32_t drops = 0;
+					std::memcpy(&drops, CMSG_DATA(header), sizeof(drops));
+					if (drops > kernelDrops)
+						kernelDrops = drops;
+				}
+			}
+		}
+#endif
+
 		int socket;
+		int receiveBufferSize = 0;		// bytes, as reported by the kernel
+		int sendBufferSize = 0;
+		unsigned int kernelDrops = 0;	// running SO_RXQ_OVFL count
+
+#if RUDP_HAVE_IO_URING
+
+		// one queued receive; completed slots wait in ready until Receive hands them out and queues them again
+		struct RingReceive : public IoOperation
+		{
+			Socket& owner;
+			msghdr message;
+			iovec vector;
+			sockaddr_in from;
+			unsigned char data[PacketSizeHack];
+#if defined(SO_RXQ_OVFL)
+			unsigned char control[DropControlSize];
+#endif
+			int result = 0;
+			bool armed = false;
+
+			explicit RingReceive(Socket& owner) : owner(owner) {}
+
+			void Complete(int result)
+			{
+				this->result = result;
+				armed = false;
+				owner.ready.push_back(this);
+			}
+		};
+
+		// one send in flight; the datagram is copied in because the caller's buffers do not outlive the call
+		struct RingSend : public IoOperation
+		{
+			Socket& owner;
+			msghdr message;
+			iovec vector;
+			sockaddr_in to;
+			unsigned char data[PacketSizeHack];
+			int size = 0;
+
+			explicit RingSend(Socket& owner) : owner(owner) {}
+
+			void Complete(int result)
+			{
+				if (result != size)
+					LOG_LIMITED(LOG_LEVEL_WARN, 10, "io_uring send failed: %d", result);
+				owner.freeSends.push_back(this);
+			}
+		};
+
+		void ArmReceive(RingReceive& slot)
+		{
+			slot.vector.iov_base = slot.data;
+			slot.vector.iov_len = sizeof(slot.data);
+			slot.message = msghdr();
+			slot.message.msg_name = &slot.from;
+			slot.message.msg_namelen = sizeof(slot.from);
+			slot.message.msg_iov = &slot.vector;
+			slot.message.msg_iovlen = 1;
+#if defined(SO_RXQ_OVFL)
+			slot.message.msg_control = slot.control;
+			slot.message.msg_controllen = sizeof(slot.control);
+#endif
+
+			if (!ring->ReceiveMessage(socket, &slot.message, &slot))
+			{
+				ring->Submit();
+				if (!ring->ReceiveMessage(socket, &slot.message, &slot))
+				{
+					LOG_ERROR("io_uring submission queue full, receive slot dropped");
+					return;
+				}
+			}
+			slot.armed = true;
+		}
+
+		bool SendOnRing(const sockaddr_in& address, const PacketSegment segments[], int count)
+		{
+			while (freeSends.empty())
+			{
+				ring->Submit();
+				if (ring->Poll() == 0 && freeSends.empty())
+					ring->Wait(1);
+			}
+			RingSend* slot = freeSends.back();
+			freeSends.pop_back();
+
+			slot->size = 0;
+			for (int i = 0; i < count; ++i)
+			{
+				if (slot->size + segments[i].size > (int)sizeof(slot->data))
+				{
+					freeSends.push_back(slot);
+					return false;
+				}
+				std::memcpy(slot->data + slot->size, segments[i].data, segments[i].size);
+				slot->size += segments[i].size;
+			}
+
+			slot->to = address;
+			slot->vector.iov_base = slot->data;
+			slot->vector.iov_len = (size_t)slot->size;
+			slot->message = msghdr();
+			slot->message.msg_name = &slot->to;
+			slot->message.msg_namelen = sizeof(slot->to);
+			slot->message.msg_iov = &slot->vector;
+			slot->message.msg_iovlen = 1;
+
+			if (!ring->SendMessage(socket, &slot->message, slot))
+			{
+				ring->Submit();
+				if (!ring->SendMessage(socket, &slot->message, slot))
+				{
+					freeSends.push_back(slot);
+					return false;
+				}
+			}
+			return true;
+		}
+
+		int ReceiveOnRing(Address& sender, void* data, int size)
+		{
+			while (true)
+			{
+				if (ready.empty())
+				{
+					ring->Submit();
+					ring->Poll();
+				}
+				if (ready.empty())
+					return 0;
+
+				RingReceive* slot = ready.front();
+				ready.pop_front();
+
+				// errors (e.g. ICMP port unreachable) are dropped like a failed recvfrom
+				int received_bytes = slot->result;
+				if (received_bytes > 0)
+				{
+					if (received_bytes > size)
+						received_bytes = size;
+					std::memcpy(data, slot->data, received_bytes);
+					sender = Address(ntohl(slot->from.sin_addr.s_addr), ntohs(slot->from.sin_port));
+#if defined(SO_RXQ_OVFL)
+					ReadKernelDrops(slot->message);
+#endif
+				}
+				ArmReceive(*slot);
+				if (received_bytes > 0)
+					return received_bytes;
+			}
+		}
+
+		// cancels the queued receives and waits until the kernel is done with every slot
+		void ReleaseRing()
+		{
+			for (std::unique_ptr<RingReceive>& slot : receives)
+			{
+				if (slot->armed && !ring->Cancel(slot.get()))
+				{
+					ring->Submit();
+					ring->Cancel(slot.get());
+				}
+			}
+			ring->Submit();
+
+			auto busy = [this]()
+			{
+				for (std::unique_ptr<RingReceive>& slot : receives)
+					if (slot->armed)
+						return true;
+				return freeSends.size() < sends.size();
+			};
+			while (busy() && ring->InFlight() > 0)
+				ring->Wait(1);
+
+			ready.clear();
+			freeSends.clear();
+			receives.clear();
+			sends.clear();
+			ring = nullptr;
+		}
+
+		IoRing* ring = nullptr;
+		std::vector<std::unique_ptr<RingReceive>> receives;
+		std::vector<std::unique_ptr<RingSend>> sends;
+		std::deque<RingReceive*> ready;			// completed receives in completion order
+		std::vector<RingSend*> freeSends;
+
+#endif
+	};
+
+
+
+
+
+
+
+	// link emulation
+	//  + deterministic, seedable impairment of the datagrams a connection sends (no root, no netem)
+	//  + time is whatever the caller passes to Send and Update, so a ManualClock gives reproducible runs
+
+	struct LinkConditions
+	{
+		float loss = 0.0f;					// drop probability per datagram (good state of the burst model)
+		float burstEnter = 0.0f;			// Gilbert-Elliott: probability per datagram of moving from the good to the bad state
+		float burstExit = 1.0f;				// Gilbert-Elliott: probability per datagram of moving from the bad back to the good state
+		float burstLoss = 1.0f;				// drop probability per datagram in the bad state
+		float latency = 0.0f;				// one-way delay in seconds
+		float jitter = 0.0f;				// extra uniform delay in [0, jitter] seconds (independent per datagram, so it reorders)
+		float reorder = 0.0f;				// probability of holding a datagram back by reorderDelay so later ones overtake it
+		float reorderDelay = 0.005f;		// seconds
+		float duplicate = 0.0f;				// probability of delivering a datagram twice
+		float bandwidth = 0.0f;				// bytes per second the link can carry, 0 = unlimited
+		int queueLimit = 0;					// bytes that may wait for the bandwidth cap before tail drop, 0 = unlimited
+		unsigned int seed = 1;				// the same seed and the same sends give the same losses and delays
+	};
+
+	struct LinkStats
+	{
+		unsigned int sent = 0;				// datagrams handed to the link
+		unsigned int delivered = 0;			// datagrams handed to the socket (duplicates included)
+		unsigned int lost = 0;				// random and burst losses
+		unsigned int queueDrops = 0;		// tail drops at the bandwidth cap
+		unsigned int duplicated = 0;
+		unsigned int reordered = 0;
+	};
+
+	// Class Name: LinkEmulator
+	// Class Description: Holds back, drops and duplicates outgoing datagrams according to LinkConditions
+	class LinkEmulator
+	{
+	public:
+
+		LinkEmulator()
+		{
+			Configure(LinkConditions());
+		}
+
+		void Configure(const LinkConditions& conditions)
+		{
+			this->conditions = conditions;
+			state = conditions.seed != 0 ? conditions.seed : 1;
+			busyUntil = 0;
+			queuedBytes = 0;
+			bad = false;
+			pending.clear();
+			stats = LinkStats();
+		}
+
+		const LinkConditions& GetConditions() const
+		{
+			return conditions;
+		}
+
+		const LinkStats& GetStats() const
+		{
+			return stats;
+		}
+
+		// Function Name: Send
+		// Function Description: Passes a datagram to the link at time now; it reaches the socket now or in a later Update
+		bool Send(Socket& socket, const Address& destination, const void* data, int size, uint64_t now)
+		{
+			stats.sent++;
+
+			// Gilbert-Elliott two state loss model (plain random loss when burstEnter is 0)
+			if (bad ? Random() < conditions.burstExit : Random() < conditions.burstEnter)
+				bad = !bad;
+			if (Random() < (bad ? conditions.burstLoss : conditions.loss))
+			{
+				stats.lost++;
+				return true;
+			}
+
+			// serialization at the bandwidth cap, with a bounded queue in front of it
+			uint64_t release = now;
+			if (conditions.bandwidth > 0.0f)
+			{
+				if (busyUntil < now)
+				{
+					busyUntil = now;
+					queuedBytes = 0;
+				}
+				if (conditions.queueLimit > 0 && queuedBytes + size > conditions.queueLimit)
+				{
+					stats.queueDrops++;
+					return true;
+				}
+				busyUntil += SecondsToNs(size / (double)conditions.bandwidth);
+				queuedBytes += size;
+				release = busyUntil;
+			}
+
+			release += SecondsToNs(conditions.latency);
+			if (conditions.jitter > 0.0f)
+				release += SecondsToNs(Random() * conditions.jitter);
+			if (Random() < conditions.reorder)
+			{
+				release += SecondsToNs(conditions.reorderDelay);
+				stats.reordered++;
+			}
+
+			int copies = Random() < conditions.duplicate ? 2 : 1;
+			if (copies == 2)
+				stats.duplicated++;
+
+			for (int i = 0; i < copies; ++i)
+			{
+				// nothing to wait for: go straight out, unless that would overtake datagrams already waiting
+				if (release <= now && pending.empty())
+				{
+					socket.Send(destination, data, size);
+					stats.delivered++;
+					continue;
+				}
+
+				PendingDatagram datagram;
+				datagram.destination = destination;
+				datagram.size = size;
+				std::memcpy(datagram.data, data, size);
+				pending.insert(std::make_pair(release, datagram));
+			}
+			return true;
+		}
+
+		// Function Name: Update
+		// Function Description: Sends every datagram that is due at time now
+		void Update(uint64_t now, Socket& socket)
+		{
+			while (!pending.empty() && pending.begin()->first <= now)
+			{
+				const PendingDatagram& datagram = pending.begin()->second;
+				socket.Send(datagram.destination, datagram.data, datagram.size);
+				stats.delivered++;
+				pending.erase(pending.begin());
+			}
+			if (busyUntil <= now)
+				queuedBytes = 0;
+		}
+
+	private:
+
+		struct PendingDatagram
+		{
+			Address destination;
+			int size;
+			unsigned char data[PacketSizeHack];
+		};
+
+		// xorshift32: same sequence on every platform and standard library
+		float Random()
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return (state >> 8) * (1.0f / 16777216.0f);
+		}
+
+		LinkConditions conditions;
+		unsigned int state;
+		uint64_t busyUntil;					// when the bandwidth cap has finished sending everything queued
+		int queuedBytes;					// bytes serialized since the link was last idle
+		bool bad;							// Gilbert-Elliott state
+		std::multimap<uint64_t, PendingDatagram> pending; // by release time; equal times keep their send order
+		LinkStats stats;
 	};
 
 
@@ -372,15 +1178,21 @@ namespace net
 
 		// Function Name: Start
 		// Function Description:
-		//			- 1: Call Socket::Open(port) to create and bind a UDP socket
+		//			- 1: Call Socket::Open(port, localAddress) to create a UDP socket and bind it to port on the interface with address localAddress (0 = every interface)
 		//			- 2: Set the running flag to true
-		bool Start(int port)
+		bool Start(int port, unsigned int localAddress = 0)
 		{
 			assert(!running);
-			printf("start connection on port %d\n", port);
-			if (!socket.Open(port))
+			if (localAddress != 0)
+				LOG_INFO("start connection on %d.%d.%d.%d:%d", localAddress >> 24, (localAddress >> 16) & 0xFF,
+					(localAddress >> 8) & 0xFF, localAddress & 0xFF, port);
+			else
+				LOG_INFO("start connection on port %d", port);
+			if (!socket.Open(port, localAddress))
 				return false;
+			this->port = port;
 			running = true;
+			ResetBufferTuning();
 			OnStart();
 			return true;
 		}
@@ -388,7 +1200,7 @@ namespace net
 		void Stop()
 		{
 			assert(running);
-			printf("stop connection\n");
+			LOG_INFO("stop connection");
 			bool connected = IsConnected();
 			ClearData();
 			socket.Close();
@@ -403,12 +1215,17 @@ namespace net
 			return running;
 		}
 
+		int GetPort() const
+		{
+			return port;
+		}
+
 
 		// Function Name: Listen
 		//
 		void Listen()
 		{
-			printf("server listening for connection\n");
+			LOG_INFO("server listening for connection");
 
 			bool connected = IsConnected();
 			ClearData(); // clear the privous data
@@ -425,7 +1242,7 @@ namespace net
 		// 
 		void Connect(const Address& address)
 		{
-			printf("client connecting to %d.%d.%d.%d:%d\n",
+			LOG_INFO("client connecting to %d.%d.%d.%d:%d",
 				address.GetA(), address.GetB(), address.GetC(), address.GetD(), address.GetPort());
 
 			bool connected = IsConnected();
@@ -464,22 +1281,29 @@ namespace net
 			return mode;
 		}
 
-		virtual void Update(float deltaTime)
+		// Function Name: Update
+		// Function Description: Releases due emulated datagrams and times the connection out when nothing arrived for timeout seconds
+		virtual void Update()
 		{
 			assert(running);
-			timeoutAccumulator += deltaTime;
-			if (timeoutAccumulator > timeout)
+			const uint64_t now = clock->Now();
+			if (emulateLink)
+				link.Update(now, socket);
+			socket.Flush();
+			if (bufferTuning)
+				TuneSocketBuffers(now);
+			if (now > lastReceive + SecondsToNs(timeout))
 			{
 				if (state == Connecting)
 				{
-					printf("connect timed out\n");
+					LOG_WARN("connect timed out");
 					ClearData();
 					state = ConnectFail;
 					OnDisconnect();
 				}
 				else if (state == Connected)
 				{
-					printf("connection timed out\n");
+					LOG_WARN("connection timed out");
 					ClearData();
 					if (state == Connecting)
 						state = ConnectFail;
@@ -491,32 +1315,57 @@ namespace net
 		// Function Name: SendPacket
 		//
 		virtual bool SendPacket(const unsigned char data[], int size)
+		{
+			PacketSegment segment = { data, size };
+			return SendPacket(&segment, 1);
+		}
+
+		// Function Name: SendPacket
+		// Function Description: Sends the concatenation of count segments behind the connection header; the data is not copied
+		virtual bool SendPacket(const PacketSegment segments[], int count)
 		{
 			assert(running);
+			assert(count > 0 && count < MaxPacketSegments);
 			if (address.GetAddress() == 0)
 				return false;
 
-			// use PacketSizeHack declear the fixed array
-			unsigned char packet[PacketSizeHack] = {'\0'};
-
 			// Check if the data size exceeds the PacketSizeHack limit
-			if (size + 4 > PacketSizeHack)
+			int size = GetHeaderSize();
+			for (int i = 0; i < count; ++i)
+				size += segments[i].size;
+			if (size > PacketSizeHack)
 			{
-				printf("Error: Packet size exceeds maximum allowed size!\n");
+				LOG_ERROR("Error: Packet size exceeds maximum allowed size!");
 				return false;
 			}
 
 			// Fill in protocol headers
-			packet[0] = (unsigned char)(protocolId >> 24);
-			packet[1] = (unsigned char)((protocolId >> 16) & 0xFF);
-			packet[2] = (unsigned char)((protocolId >> 8) & 0xFF);
-			packet[3] = (unsigned char)((protocolId) & 0xFF);
+			unsigned char header[ConnectionHeaderLayout::size];
+			ConnectionHeader fields;
+			fields.protocolId = protocolId;
+			ConnectionHeaderLayout::Encode(fields, header);
 
-			// Copy the data
-			std::memcpy(&packet[4], data, size);
+			PacketSegment packet[MaxPacketSegments];
+			packet[0].data = header;
+			packet[0].size = (int)sizeof(header);
+			std::copy(segments, segments + count, packet + 1);
 
-			// Send packet
-			return socket.Send(address, packet, size + 4);
+			// the link emulator holds on to the datagram, so it gets its own copy
+			sentDatagrams++;
+			sentBytes += size;
+
+			if (emulateLink)
+			{
+				unsigned char buffer[PacketSizeHack];
+				int offset = 0;
+				for (int i = 0; i <= count; ++i)
+				{
+					std::memcpy(buffer + offset, packet[i].data, packet[i].size);
+					offset += packet[i].size;
+				}
+				return link.Send(socket, address, buffer, size, clock->Now());
+			}
+			return socket.Send(address, packet, count + 1);
 		}
 
 
@@ -534,20 +1383,21 @@ namespace net
 
 			if (bytes_read == 0)
 				return 0;
-			if (bytes_read <= 4)
+			receivedDatagrams++;
+			receivedBytes += bytes_read;
+			if (bytes_read <= GetHeaderSize())
 				return 0;
 
 			// Check if the protocol ID matches
-			if (packet[0] != (unsigned char)(protocolId >> 24) ||
-				packet[1] != (unsigned char)((protocolId >> 16) & 0xFF) ||
-				packet[2] != (unsigned char)((protocolId >> 8) & 0xFF) ||
-				packet[3] != (unsigned char)(protocolId & 0xFF))
+			ConnectionHeader header;
+			ConnectionHeaderLayout::Decode(header, packet);
+			if (header.protocolId != protocolId)
 				return 0;
 
 			// Handle connection in server mode
 			if (mode == Server && !IsConnected())
 			{
-				printf("server accepts connection from client %d.%d.%d.%d:%d\n",
+				LOG_INFO("server accepts connection from client %d.%d.%d.%d:%d",
 					sender.GetA(), sender.GetB(), sender.GetC(), sender.GetD(), sender.GetPort());
 				state = Connected;
 				address = sender;
@@ -559,17 +1409,17 @@ namespace net
 			{
 				if (mode == Client && state == Connecting)
 				{
-					printf("client completes connection with server\n");
+					LOG_INFO("client completes connection with server");
 					state = Connected;
 					OnConnect();
 				}
-				timeoutAccumulator = 0.0f;
+				lastReceive = clock->Now();
 
 				// Copy data to the caller-provided buffer
-				int data_size = bytes_read - 4;
+				int data_size = bytes_read - GetHeaderSize();
 				if (data_size > size) // Prevent buffer overflow
 					data_size = size;
-				memcpy(data, &packet[4], data_size);
+				memcpy(data, &packet[GetHeaderSize()], data_size);
 				return data_size;
 			}
 
@@ -578,7 +1428,95 @@ namespace net
 
 		int GetHeaderSize() const
 		{
-			return 4;
+			return (int)ConnectionHeaderLayout::size;
+		}
+
+		// Function Name: UseIoRing
+		// Function Description: Sends and receives through ring once the connection has started (see Socket::UseRing)
+		bool UseIoRing(IoRing& ring)
+		{
+			assert(running);
+			return socket.UseRing(ring);
+		}
+
+		// Function Name: SetBufferTuning
+		// Function Description: Turns the sizing of the socket buffers from the bandwidth-delay product on (the default) or off
+		void SetBufferTuning(bool enable)
+		{
+			bufferTuning = enable;
+		}
+
+		// Function Name: SetBufferSizes
+		// Function Description: Fixes the socket buffers at the given sizes (see Socket::SetBufferSizes) and turns the tuning off
+		bool SetBufferSizes(int receiveBytes, int sendBytes)
+		{
+			assert(running);
+			bufferTuning = false;
+			return socket.SetBufferSizes(receiveBytes, sendBytes);
+		}
+
+		// Function Name: SetBusyPoll
+		// Function Description: See Socket::SetBusyPoll; the caller spins on ReceivePacket instead of sleeping between polls
+		bool SetBusyPoll(int microseconds)
+		{
+			assert(running);
+			return socket.SetBusyPoll(microseconds);
+		}
+
+		int GetReceiveBufferSize() const
+		{
+			return socket.GetReceiveBufferSize();
+		}
+
+		int GetSendBufferSize() const
+		{
+			return socket.GetSendBufferSize();
+		}
+
+		// Function Name: GetKernelDrops
+		// Function Description: Datagrams to this connection's socket the kernel dropped because its receive buffer was full (Linux SO_RXQ_OVFL)
+		unsigned int GetKernelDrops() const
+		{
+			return socket.GetKernelDrops();
+		}
+
+		// Function Name: GetSocketHandle
+		// Function Description: Descriptor of the connection's socket; it is readable when a datagram is waiting (not with io_uring, which takes them first)
+		int GetSocketHandle() const
+		{
+			return socket.GetHandle();
+		}
+
+		// Function Name: SetLinkConditions
+		// Function Description: Routes every datagram this connection sends through an emulated link
+		void SetLinkConditions(const LinkConditions& conditions)
+		{
+			link.Configure(conditions);
+			emulateLink = true;
+		}
+
+		void ClearLinkConditions()
+		{
+			link.Configure(LinkConditions());
+			emulateLink = false;
+		}
+
+		const LinkEmulator& GetLinkEmulator() const
+		{
+			return link;
+		}
+
+		// Function Name: SetClock
+		// Function Description: Time source for timeouts and the link emulator; must outlive the connection
+		virtual void SetClock(const Clock& clock)
+		{
+			this->clock = &clock;
+			lastReceive = clock.Now();
+		}
+
+		const Clock& GetClock() const
+		{
+			return *clock;
 		}
 
 	protected:
@@ -588,12 +1526,89 @@ namespace net
 		virtual void OnConnect() {}
 		virtual void OnDisconnect() {}
 
+		// round trip time the socket buffers are sized for (a plain Connection does not measure one)
+		virtual float GetBufferRoundTripTime() const
+		{
+			return 0.0f;
+		}
+
 	private:
 
+		void ResetBufferTuning()
+		{
+			lastTune = 0;
+			lastUpdate = 0;
+			longestUpdateGap = 0;
+			sentDatagrams = receivedDatagrams = 0;
+			sentBytes = receivedBytes = 0;
+			tunedDrops = 0;
+			bufferCapped = false;
+			if (bufferTuning && socket.GetReceiveBufferSize() < MinSocketBuffer)
+				socket.SetBufferSizes(MinSocketBuffer, socket.GetSendBufferSize() < MinSocketBuffer ? MinSocketBuffer : 0);
+		}
+
+		// Function Name: TuneSocketBuffers
+		// Function Description:
+		//			- Every BufferTuneInterval, grows each buffer to BufferHeadroom times what arrives / leaves at the rate
+		//			- measured since the last sizing during the RTT plus the longest gap between two Updates (datagrams
+		//			- wait in the receive buffer until the application polls), at DatagramOverhead extra bytes each.
+		//			- New kernel drops double the receive buffer on top. Buffers only grow, up to MaxSocketBuffer
+		void TuneSocketBuffers(uint64_t now)
+		{
+			if (lastUpdate != 0 && now - lastUpdate > longestUpdateGap)
+				longestUpdateGap = now - lastUpdate;
+			lastUpdate = now;
+			if (lastTune == 0)
+			{
+				lastTune = now;
+				return;
+			}
+			const double elapsed = NsToSeconds(now - lastTune);
+			if (elapsed < BufferTuneInterval)
+				return;
+
+			const double window = GetBufferRoundTripTime() + NsToSeconds(longestUpdateGap);
+			const double receiveRate = (receivedBytes + (double)receivedDatagrams * DatagramOverhead) / elapsed;
+			const double sendRate = (sentBytes + (double)sentDatagrams * DatagramOverhead) / elapsed;
+			int receiveTarget = (int)std::min((double)MaxSocketBuffer, BufferHeadroom * receiveRate * window);
+			int sendTarget = (int)std::min((double)MaxSocketBuffer, BufferHeadroom * sendRate * window);
+
+			const unsigned int drops = socket.GetKernelDrops();
+			if (drops > tunedDrops)
+			{
+				receiveTarget = std::max(receiveTarget, (int)std::min((int64_t)MaxSocketBuffer, (int64_t)socket.GetReceiveBufferSize() * 2));
+				LOG_LIMITED(LOG_LEVEL_WARN, 1, "kernel dropped %u datagrams on port %d (receive buffer full, %d bytes)",
+					drops - tunedDrops, port, socket.GetReceiveBufferSize());
+				tunedDrops = drops;
+			}
+
+			// grow by at least a quarter at a time, so the buffers settle instead of following every sample
+			const int receiveBuffer = socket.GetReceiveBufferSize();
+			const int sendBuffer = socket.GetSendBufferSize();
+			const int receiveRequest = receiveTarget > receiveBuffer + receiveBuffer / 4 ? receiveTarget : 0;
+			const int sendRequest = sendTarget > sendBuffer + sendBuffer / 4 ? sendTarget : 0;
+			if (receiveRequest > 0 || sendRequest > 0)
+			{
+				const bool granted = socket.SetBufferSizes(receiveRequest, sendRequest);
+				LOG_DEBUG("socket buffers on port %d: receive %d, send %d bytes", port, socket.GetReceiveBufferSize(), socket.GetSendBufferSize());
+				if (!granted && !bufferCapped)
+				{
+					LOG_WARN("socket buffers on port %d capped at receive %d / send %d bytes (wanted %d / %d); raise net.core.rmem_max / wmem_max",
+						port, socket.GetReceiveBufferSize(), socket.GetSendBufferSize(), receiveRequest, sendRequest);
+					bufferCapped = true;
+				}
+			}
+
+			lastTune = now;
+			longestUpdateGap = 0;
+			sentDatagrams = receivedDatagrams = 0;
+			sentBytes = receivedBytes = 0;
+		}
+
 		void ClearData()
 		{
 			state = Disconnected;
-			timeoutAccumulator = 0.0f;
+			lastReceive = clock->Now();
 			address = Address();
 		}
 
@@ -610,11 +1625,27 @@ namespace net
 		float timeout;
 
 		bool running;
+		int port = 0;
 		Mode mode;		// None, Client, Server
 		State state;	// Disconnected, Listening, Connecting, ConnectFail, Connected
 		Socket socket;
-		float timeoutAccumulator;
+		const Clock* clock = &Clock::System();
+		uint64_t lastReceive;	// when the last packet from the peer arrived (or the connection was reset)
 		Address address;
+		bool emulateLink = false;
+		LinkEmulator link;
+
+		// socket buffer tuning, see TuneSocketBuffers
+		bool bufferTuning = true;
+		bool bufferCapped = false;		// the kernel granted less than asked for (warned once)
+		uint64_t lastTune = 0;
+		uint64_t lastUpdate = 0;
+		uint64_t longestUpdateGap = 0;	// ns between two Updates since lastTune
+		uint64_t sentDatagrams = 0;		// since lastTune
+		uint64_t receivedDatagrams = 0;
+		uint64_t sentBytes = 0;
+		uint64_t receivedBytes = 0;
+		unsigned int tunedDrops = 0;	// kernel drops already answered with a larger buffer
 	};
 
 
@@ -629,7 +1660,7 @@ namespace net
 	struct PacketData
 	{
 		unsigned int sequence;			// packet sequence number
-		float time;					    // time offset since packet was sent or received (depending on context)
+		uint64_t time;					// when the packet was sent, received or acked (depending on the queue), clock ns
 		int size;						// packet size in bytes
 	};
 
@@ -744,6 +1775,8 @@ namespace net
 			recv_packets = 0;
 			lost_packets = 0;
 			acked_packets = 0;
+			sent_bytes = 0;
+			acked_bytes = 0;
 			sent_bandwidth = 0.0f;
 			acked_bandwidth = 0.0f;
 			rtt = 0.0f;
@@ -754,19 +1787,26 @@ namespace net
 		{
 			if (sentQueue.exists(local_sequence))
 			{
-				printf("local sequence %d exists\n", local_sequence);
+				LOG_ERROR("local sequence %d exists", local_sequence);
 				for (PacketQueue::iterator itor = sentQueue.begin(); itor != sentQueue.end(); ++itor)
-					printf(" + %d\n", itor->sequence);
+					LOG_ERROR(" + %d", itor->sequence);
 			}
 			assert(!sentQueue.exists(local_sequence));
 			assert(!pendingAckQueue.exists(local_sequence));
+			TRACE_EVENT(TRACE_PACKET_SENT, local_sequence, size);
 			PacketData data;
 			data.sequence = local_sequence;
-			data.time = 0.0f;
+			data.time = clock->Now();
 			data.size = size;
 			sentQueue.push_back(data);
 			pendingAckQueue.push_back(data);
 			sent_packets++;
+			sent_bytes += size;
+			if (metrics)
+			{
+				metrics->packetsSent.Add();
+				metrics->bytesSent.Add(size);
+			}
 			local_sequence++;
 			if (local_sequence > max_sequence)
 				local_sequence = 0;
@@ -775,11 +1815,17 @@ namespace net
 		void PacketReceived(unsigned int sequence, int size)
 		{
 			recv_packets++;
+			TRACE_EVENT(TRACE_PACKET_RECEIVED, sequence, size);
+			if (metrics)
+			{
+				metrics->packetsReceived.Add();
+				metrics->bytesReceived.Add(size);
+			}
 			if (receivedQueue.exists(sequence))
 				return;
 			PacketData data;
 			data.sequence = sequence;
-			data.time = 0.0f;
+			data.time = clock->Now();
 			data.size = size;
 			receivedQueue.push_back(data);
 			if (sequence_more_recent(sequence, remote_sequence, max_sequence))
@@ -793,14 +1839,21 @@ namespace net
 
 		void ProcessAck(unsigned int ack, unsigned int ack_bits)
 		{
-			process_ack(ack, ack_bits, pendingAckQueue, ackedQueue, acks, acked_packets, rtt, max_sequence);
+			const size_t previous = ackedQueue.size();
+			process_ack(ack, ack_bits, pendingAckQueue, ackedQueue, acks, acked_packets, rtt, max_sequence, clock->Now(), metrics);
+
+			// newly acked packets were appended at the back
+			PacketQueue::reverse_iterator itor = ackedQueue.rbegin();
+			for (size_t added = ackedQueue.size() - previous; added > 0; --added, ++itor)
+				acked_bytes += itor->size;
 		}
 
-		void Update(float deltaTime)
+		// Function Name: Update
+		// Function Description: Expires old entries and refreshes the statistics; only touches entries that expire
+		void Update()
 		{
 			acks.clear();
-			AdvanceQueueTime(deltaTime);
-			UpdateQueues();
+			UpdateQueues(clock->Now());
 			UpdateStats();
 #ifdef NET_UNIT_TEST
 			Validate();
@@ -812,7 +1865,6 @@ namespace net
 			sentQueue.verify_sorted(max_sequence);
 			receivedQueue.verify_sorted(max_sequence);
 			pendingAckQueue.verify_sorted(max_sequence);
-			ackedQueue.verify_sorted(max_sequence);
 		}
 
 		// utility functions
@@ -856,10 +1908,11 @@ namespace net
 			return ack_bits;
 		}
 
+		// acked packets move to the back of acked_queue stamped with now, the ack time
 		static void process_ack(unsigned int ack, unsigned int ack_bits,
 			PacketQueue& pending_ack_queue, PacketQueue& acked_queue,
 			std::vector<unsigned int>& acks, unsigned int& acked_packets,
-			float& rtt, unsigned int max_sequence)
+			float& rtt, unsigned int max_sequence, uint64_t now, ConnectionMetrics* metrics = nullptr)
 		{
 			if (pending_ack_queue.empty())
 				return;
@@ -882,9 +1935,18 @@ namespace net
 
 				if (acked)
 				{
-					rtt += (itor->time - rtt) * 0.1f;
+					const uint64_t sample = now > itor->time ? now - itor->time : 0;
+					rtt += ((float)NsToSeconds(sample) - rtt) * 0.1f;
+					TRACE_EVENT(TRACE_PACKET_ACKED, itor->sequence, sample);
+					if (metrics)
+					{
+						metrics->packetsAcked.Add();
+						metrics->rttSamples.Record(sample / 1000);
+					}
 
-					acked_queue.insert_sorted(*itor, max_sequence);
+					PacketData data = *itor;
+					data.time = now;
+					acked_queue.push_back(data);
 					acks.push_back(itor->sequence);
 					acked_packets++;
 					itor = pending_ack_queue.erase(itor);
@@ -913,7 +1975,7 @@ namespace net
 
 		void GetAcks(unsigned int** acks, int& count)
 		{
-			*acks = &this->acks[0];
+			*acks = this->acks.data();
 			count = (int)this->acks.size();
 		}
 
@@ -954,32 +2016,36 @@ namespace net
 
 		int GetHeaderSize() const
 		{
-			return 12;
+			return (int)ReliableHeaderLayout::size;
 		}
 
-	protected:
-
-		void AdvanceQueueTime(float deltaTime)
+		// Function Name: SetMetrics
+		// Function Description: Records every event into metrics from now on (nullptr stops recording); Reset keeps it
+		void SetMetrics(ConnectionMetrics* metrics)
 		{
-			for (PacketQueue::iterator itor = sentQueue.begin(); itor != sentQueue.end(); itor++)
-				itor->time += deltaTime;
-
-			for (PacketQueue::iterator itor = receivedQueue.begin(); itor != receivedQueue.end(); itor++)
-				itor->time += deltaTime;
-
-			for (PacketQueue::iterator itor = pendingAckQueue.begin(); itor != pendingAckQueue.end(); itor++)
-				itor->time += deltaTime;
+			this->metrics = metrics;
+		}
 
-			for (PacketQueue::iterator itor = ackedQueue.begin(); itor != ackedQueue.end(); itor++)
-				itor->time += deltaTime;
+		// Function Name: SetClock
+		// Function Description: Time source for packet timestamps; must outlive the system
+		void SetClock(const Clock& clock)
+		{
+			this->clock = &clock;
 		}
 
-		void UpdateQueues()
+	protected:
+
+		// every queue is in timestamp order, so expiry only looks at the front
+		void UpdateQueues(uint64_t now)
 		{
-			const float epsilon = 0.001f;
+			const uint64_t epsilon = 1000000;
+			const uint64_t expiry = SecondsToNs(rtt_maximum) + epsilon;
 
-			while (sentQueue.size() && sentQueue.front().time > rtt_maximum + epsilon)
+			while (sentQueue.size() && sentQueue.front().time + expiry < now)
+			{
+				sent_bytes -= sentQueue.front().size;
 				sentQueue.pop_front();
+			}
 
 			if (receivedQueue.size())
 			{
@@ -989,38 +2055,44 @@ namespace net
 					receivedQueue.pop_front();
 			}
 
-			while (ackedQueue.size() && ackedQueue.front().time > rtt_maximum * 2 - epsilon)
+			while (ackedQueue.size() && ackedQueue.front().time + expiry < now)
+			{
+				acked_bytes -= ackedQueue.front().size;
 				ackedQueue.pop_front();
+			}
 
-			while (pendingAckQueue.size() && pendingAckQueue.front().time > rtt_maximum + epsilon)
+			while (pendingAckQueue.size() && pendingAckQueue.front().time + expiry < now)
 			{
+				TRACE_EVENT(TRACE_PACKET_LOST, pendingAckQueue.front().sequence, 0);
 				pendingAckQueue.pop_front();
 				lost_packets++;
+				if (metrics)
+					metrics->packetsLost.Add();
 			}
 		}
 
+		// bandwidth over the last rtt_maximum, from the running byte totals of the sent and acked queues
 		void UpdateStats()
 		{
-			int sent_bytes_per_second = 0;
-			for (PacketQueue::iterator itor = sentQueue.begin(); itor != sentQueue.end(); ++itor)
-				sent_bytes_per_second += itor->size;
-			int acked_packets_per_second = 0;
-			int acked_bytes_per_second = 0;
-			for (PacketQueue::iterator itor = ackedQueue.begin(); itor != ackedQueue.end(); ++itor)
+			sent_bandwidth = (float)(sent_bytes / rtt_maximum * (8 / 1000.0));
+			acked_bandwidth = (float)(acked_bytes / rtt_maximum * (8 / 1000.0));
+
+			if (metrics)
 			{
-				if (itor->time >= rtt_maximum)
-				{
-					acked_packets_per_second++;
-					acked_bytes_per_second += itor->size;
-				}
+				metrics->rtt.Set((int64_t)(rtt * 1000000.0f));
+				metrics->sentBandwidth.Set((int64_t)(sent_bandwidth * 1000.0f));
+				metrics->ackedBandwidth.Set((int64_t)(acked_bandwidth * 1000.0f));
+				metrics->sentQueueDepth.Set((int64_t)sentQueue.size());
+				metrics->pendingAckDepth.Set((int64_t)pendingAckQueue.size());
+				metrics->receivedQueueDepth.Set((int64_t)receivedQueue.size());
+				metrics->ackedQueueDepth.Set((int64_t)ackedQueue.size());
+				metrics->inFlight.Record(pendingAckQueue.size());
 			}
-			sent_bytes_per_second /= rtt_maximum;
-			acked_bytes_per_second /= rtt_maximum;
-			sent_bandwidth = sent_bytes_per_second * (8 / 1000.0f);
-			acked_bandwidth = acked_bytes_per_second * (8 / 1000.0f);
 		}
 
-	private:
+	protected:
+
+		// state is protected so benchmarks can set up large windows without replaying every packet
 
 		unsigned int max_sequence;			// maximum sequence value before wrap around (used to test sequence wrap at low # values)
 		unsigned int local_sequence;		// local sequence number for most recently sent packet
@@ -1030,6 +2102,8 @@ namespace net
 		unsigned int recv_packets;			// total number of packets received
 		unsigned int lost_packets;			// total number of packets lost
 		unsigned int acked_packets;			// total number of packets acked
+		uint64_t sent_bytes;				// bytes in sentQueue
+		uint64_t acked_bytes;				// bytes in ackedQueue
 
 		float sent_bandwidth;				// approximate sent bandwidth over the last second
 		float acked_bandwidth;				// approximate acked bandwidth over the last second
@@ -1039,9 +2113,12 @@ namespace net
 		std::vector<unsigned int> acks;		// acked packets from last set of packet receives. cleared each update!
 
 		PacketQueue sentQueue;				// sent packets used to calculate sent bandwidth (kept until rtt_maximum)
-		PacketQueue pendingAckQueue;		// sent packets which have not been acked yet (kept until rtt_maximum * 2 )
+		PacketQueue pendingAckQueue;		// sent packets which have not been acked yet (kept until rtt_maximum, then lost)
 		PacketQueue receivedQueue;			// received packets for determining acks to send (kept up to most recent recv sequence - 32)
-		PacketQueue ackedQueue;				// acked packets (kept until rtt_maximum * 2)
+		PacketQueue ackedQueue;				// acked packets in ack order, used to calculate acked bandwidth (kept until rtt_maximum)
+
+		ConnectionMetrics* metrics = nullptr;	// owned by the connection, outlives every use here
+		const Clock* clock = &Clock::System();
 	};
 
 
@@ -1066,9 +2143,6 @@ namespace net
 			: Connection(protocolId, timeout), reliabilitySystem(max_sequence)
 		{
 			ClearData();
-#ifdef NET_UNIT_TEST
-			packet_loss_mask = 0;
-#endif
 		}
 
 		~ReliableConnection()
@@ -1081,45 +2155,114 @@ namespace net
 
 		bool SendPacket(const unsigned char data[], int size)
 		{
-#ifdef NET_UNIT_TEST
-			if (reliabilitySystem.GetLocalSequence() & packet_loss_mask)
-			{
-				reliabilitySystem.PacketSent(size);
-				return true;
-			}
-#endif
-			const int header = 12;
+			PacketSegment segment = { data, size };
+			return SendPacket(&segment, 1, DefaultStream);
+		}
 
-			// Use PacketSizeHack as the size of the local array
-			unsigned char packet[PacketSizeHack] = { '\0' };
+		bool SendPacket(const PacketSegment segments[], int count)
+		{
+			return SendPacket(segments, count, DefaultStream);
+		}
 
-			// Ensure the packet size does not exceed PacketSizeHack
-			if (size + header > PacketSizeHack)
-			{
-				printf("Error: Packet size exceeds maximum allowed size!\n");
-				return false;
-			}
+		// Function Name: SendPacket
+		// Function Description: Sends data as part of stream; all streams share the sequence numbers, acks and send rate
+		bool SendPacket(const unsigned char data[], int size, uint16_t stream)
+		{
+			PacketSegment segment = { data, size };
+			return SendPacket(&segment, 1, stream);
+		}
+
+		// Function Name: SendPacket
+		// Function Description: Sends the concatenation of count segments behind the reliability header; the data is not copied
+		bool SendPacket(const PacketSegment segments[], int count, uint16_t stream)
+		{
+			assert(count > 0 && count < MaxPacketSegments - 1);
+
+			int size = 0;
+			for (int i = 0; i < count; ++i)
+				size += segments[i].size;
 
 			unsigned int seq = reliabilitySystem.GetLocalSequence();
 			unsigned int ack = reliabilitySystem.GetRemoteSequence();
 			unsigned int ack_bits = reliabilitySystem.GenerateAckBits();
 
-			// Write header and copy data into the packet
-			WriteHeader(packet, seq, ack, ack_bits);
-			std::memcpy(packet + header, data, size);
+			// the header goes in front of the caller's segments
+			unsigned char header[ReliableHeaderLayout::size];
+			WriteHeader(header, seq, ack, ack_bits, stream);
+
+			PacketSegment packet[MaxPacketSegments];
+			packet[0].data = header;
+			packet[0].size = (int)sizeof(header);
+			std::copy(segments, segments + count, packet + 1);
 
 			// Send the packet
-			if (!Connection::SendPacket(packet, size + header))
+			if (!Connection::SendPacket(packet, count + 1))
 				return false;
 
 			reliabilitySystem.PacketSent(size);
+			unackedPackets = 0; // the header carried the acks
+			lastSend = GetClock().Now();
 			return true;
 		}
 
+		// Function Name: SendAck
+		// Function Description: Sends the current acks in an ack-only datagram (12 bytes), which takes no sequence number and is never acked itself
+		bool SendAck()
+		{
+			AckHeader fields;
+			fields.ack = reliabilitySystem.GetRemoteSequence();
+			fields.ack_bits = reliabilitySystem.GenerateAckBits();
+			unsigned char header[AckHeaderLayout::size];
+			AckHeaderLayout::Encode(fields, header);
+
+			PacketSegment segment = { header, (int)sizeof(header) };
+			if (!Connection::SendPacket(&segment, 1))
+				return false;
+
+			unackedPackets = 0;
+			lastSend = GetClock().Now();
+			if (metrics)
+				metrics->acksSent.Add();
+			return true;
+		}
+
+		// Function Name: SetAckFrequency
+		// Function Description:
+		//	-- Sends an ack-only datagram once packets have arrived since this end last sent anything, or microseconds
+		//	-- after the first of them (checked on every receive and update; 0 turns either off), and at once for a
+		//	-- packet that does not follow the newest one (a gap, or a late packet filling one). Off by default.
+		void SetAckFrequency(int packets, int microseconds)
+		{
+			ackPackets = packets > 0 ? packets : 0;
+			ackDelay = microseconds > 0 ? (uint64_t)microseconds * 1000 : 0;
+		}
+
+		// Function Name: GetUnackedPackets
+		// Function Description: Packets received since this end last sent its acks
+		int GetUnackedPackets() const
+		{
+			return unackedPackets;
+		}
+
+		// Function Name: GetLastSendTime
+		// Function Description: When this end last sent a packet or an ack, clock ns
+		uint64_t GetLastSendTime() const
+		{
+			return lastSend;
+		}
+
 
 		int ReceivePacket(unsigned char data[], int size)
 		{
-			const int header = 12;
+			uint16_t stream;
+			return ReceivePacket(data, size, stream);
+		}
+
+		// Function Name: ReceivePacket
+		// Function Description: Receives the next payload and the stream it belongs to; returns its size, 0 if none is waiting
+		int ReceivePacket(unsigned char data[], int size, uint16_t& stream)
+		{
+			const int header = (int)ReliableHeaderLayout::size;
 
 			// Check if the provided buffer size is too small to hold the header
 			if (size <= header)
@@ -1131,12 +2274,19 @@ namespace net
 			// Ensure the packet size does not exceed PacketSizeHack
 			if (size + header > PacketSizeHack)
 			{
-				printf("Error: Packet size exceeds maximum allowed size!\n");
+				LOG_ERROR("Error: Packet size exceeds maximum allowed size!");
 				return false;
 			}
 
-			// Receive the packet
+			// Receive the packet; an ack-only datagram is processed here and the next one is read
 			int received_bytes = Connection::ReceivePacket(packet, size + header);
+			while (received_bytes == (int)AckHeaderLayout::size)
+			{
+				AckHeader acked;
+				AckHeaderLayout::Decode(acked, packet);
+				reliabilitySystem.ProcessAck(acked.ack, acked.ack_bits);
+				received_bytes = Connection::ReceivePacket(packet, size + header);
+			}
 			if (received_bytes == 0)
 				return false;
 			if (received_bytes <= header)
@@ -1146,12 +2296,21 @@ namespace net
 			unsigned int packet_sequence = 0;
 			unsigned int packet_ack = 0;
 			unsigned int packet_ack_bits = 0;
-			ReadHeader(packet, packet_sequence, packet_ack, packet_ack_bits);
+			ReadHeader(packet, packet_sequence, packet_ack, packet_ack_bits, stream);
+
+			// a packet other than the one after the newest means loss (or reordering): the sender hears of it at once
+			const bool inOrder = reliabilitySystem.GetReceivedPackets() == 0
+				|| packet_sequence == (reliabilitySystem.GetRemoteSequence() + 1) % (reliabilitySystem.GetMaxSequence() + 1ull);
 
 			// Update the reliability system with the received packet
 			reliabilitySystem.PacketReceived(packet_sequence, received_bytes - header);
 			reliabilitySystem.ProcessAck(packet_ack, packet_ack_bits);
 
+			if (unackedPackets++ == 0)
+				firstUnacked = GetClock().Now();
+			if ((ackPackets > 0 || ackDelay > 0) && (!inOrder || AckDue()))
+				SendAck();
+
 			// Copy the data to the caller-provided buffer
 			std::memcpy(data, packet + header, received_bytes - header);
 
@@ -1159,10 +2318,29 @@ namespace net
 			return received_bytes - header;
 		}
 
-		void Update(float deltaTime)
+		void Update()
 		{
-			Connection::Update(deltaTime);
-			reliabilitySystem.Update(deltaTime);
+			Connection::Update();
+			reliabilitySystem.Update();
+			if (ackDelay > 0 && AckDue())
+				SendAck();
+			if (metrics)
+			{
+				const unsigned int drops = GetKernelDrops();
+				if (drops > recordedDrops)
+				{
+					metrics->kernelDrops.Add(drops - recordedDrops);
+					recordedDrops = drops;
+				}
+				metrics->receiveBuffer.Set(GetReceiveBufferSize());
+				metrics->sendBuffer.Set(GetSendBufferSize());
+			}
+		}
+
+		void SetClock(const Clock& clock)
+		{
+			Connection::SetClock(clock);
+			reliabilitySystem.SetClock(clock);
 		}
 
 		int GetHeaderSize() const
@@ -1175,48 +2353,52 @@ namespace net
 			return reliabilitySystem;
 		}
 
-		// unit test controls
-
-#ifdef NET_UNIT_TEST
-		void SetPacketLossMask(unsigned int mask)
+		// Function Name: GetMetrics
+		// Function Description: Counters of this connection since its last Start (nullptr before the first Start); safe to read from any thread
+		std::shared_ptr<ConnectionMetrics> GetMetrics() const
 		{
-			packet_loss_mask = mask;
+			return metrics;
 		}
-#endif
 
 	protected:
 
-		void WriteInteger(unsigned char* data, unsigned int value)
+		void WriteHeader(unsigned char* header, unsigned int sequence, unsigned int ack, unsigned int ack_bits, uint16_t stream)
 		{
-			data[0] = (unsigned char)(value >> 24);
-			data[1] = (unsigned char)((value >> 16) & 0xFF);
-			data[2] = (unsigned char)((value >> 8) & 0xFF);
-			data[3] = (unsigned char)(value & 0xFF);
+			ReliableHeader fields;
+			fields.sequence = sequence;
+			fields.ack = ack;
+			fields.ack_bits = ack_bits;
+			fields.stream = stream;
+			ReliableHeaderLayout::Encode(fields, header);
 		}
 
-		void WriteHeader(unsigned char* header, unsigned int sequence, unsigned int ack, unsigned int ack_bits)
+		void ReadHeader(const unsigned char* header, unsigned int& sequence, unsigned int& ack, unsigned int& ack_bits, uint16_t& stream)
 		{
-			WriteInteger(header, sequence);
-			WriteInteger(header + 4, ack);
-			WriteInteger(header + 8, ack_bits);
+			ReliableHeader fields;
+			ReliableHeaderLayout::Decode(fields, header);
+			sequence = fields.sequence;
+			ack = fields.ack;
+			ack_bits = fields.ack_bits;
+			stream = fields.stream;
 		}
 
-		void ReadInteger(const unsigned char* data, unsigned int& value)
+		// a connection is listed in the global MetricsRegistry while it is running, named after its port
+		virtual float GetBufferRoundTripTime() const
 		{
-			value = (((unsigned int)data[0] << 24) | ((unsigned int)data[1] << 16) |
-				((unsigned int)data[2] << 8) | ((unsigned int)data[3]));
+			return reliabilitySystem.GetRoundTripTime();
 		}
 
-		void ReadHeader(const unsigned char* header, unsigned int& sequence, unsigned int& ack, unsigned int& ack_bits)
+		virtual void OnStart()
 		{
-			ReadInteger(header, sequence);
-			ReadInteger(header + 4, ack);
-			ReadInteger(header + 8, ack_bits);
+			recordedDrops = 0;
+			metrics = MetricsRegistry::Global().Register(std::to_string(GetPort()));
+			reliabilitySystem.SetMetrics(metrics.get());
 		}
 
 		virtual void OnStop()
 		{
 			ClearData();
+			MetricsRegistry::Global().Unregister(metrics);
 		}
 
 		virtual void OnDisconnect()
@@ -1229,13 +2411,25 @@ namespace net
 		void ClearData()
 		{
 			reliabilitySystem.Reset();
+			unackedPackets = 0;
 		}
 
-#ifdef NET_UNIT_TEST
-		unsigned int packet_loss_mask;			// mask sequence number, if non-zero, drop packet - for unit test only
-#endif
+		// true once the received packets have waited ackPackets packets or ackDelay for an ack
+		bool AckDue() const
+		{
+			if (unackedPackets == 0 || !IsConnected())
+				return false;
+			return (ackPackets > 0 && unackedPackets >= ackPackets) || (ackDelay > 0 && GetClock().Now() - firstUnacked >= ackDelay);
+		}
 
 		ReliabilitySystem reliabilitySystem;	// reliability system: manages sequence numbers and acks, tracks network stats etc
+		std::shared_ptr<ConnectionMetrics> metrics;
+		unsigned int recordedDrops = 0;	// kernel drops already added to metrics
+		int ackPackets = 0;				// ack-only datagram after this many received packets (0 = off)
+		uint64_t ackDelay = 0;			// ... or this long (ns) after the first of them (0 = off)
+		int unackedPackets = 0;			// received since the acks were last sent
+		uint64_t firstUnacked = 0;		// when the first of them arrived
+		uint64_t lastSend = 0;			// when this end last sent a packet or an ack
 	};
 }
 
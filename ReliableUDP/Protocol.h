@@ -9,36 +9,189 @@
 #define _PROTOCOL_H_
 
 #include <cstdint>
+#include "Serialize.h"
 
 #define PACKET_SIZE 256  // whole packet
 #define MAX_FILENAME_LENGTH 100
 #define MD5_HASH_LENGTH 16 
-#define PADDING_SIZE (PACKET_SIZE - sizeof(uint8_t) - MAX_FILENAME_LENGTH - sizeof(uint64_t) * 2 - MD5_HASH_LENGTH)
 
 #define PAYLOAD_SIZE   (PACKET_SIZE - sizeof(uint8_t) - sizeof(uint64_t)) // PACKET_SIZE - packetType - localSequence
 
+#define COMPRESSION_CHUNK_SIZE (64 * 1024) // uncompressed bytes per compression chunk
 
-typedef struct MetaPacket // 256 Bytes fixed
+// MetaPacket flags
+#define META_FLAG_COMPRESSED 0x01 // blocks carry a chunked, LZ4 compressed wire image instead of raw file bytes
+#define META_FLAG_RESUME     0x02 // receiver journals progress and answers with ResumePackets before blocks are sent
+
+#define META_FLAG_DELTA      0x04 // blocks carry a delta stream against the receiver's existing copy of the file
+#define META_FLAG_SIGNATURE_REQUEST 0x08 // first MetaPacket of a delta transfer: receiver answers with SignaturePackets
+
+#define RESUME_MAX_RANGES 15 // block ranges per ResumePacket
+
+#define DELTA_BLOCK_SIZE 1024     // bytes per signed block of the receiver's copy
+#define SIGNATURES_PER_PACKET 20  // BlockSignatures per SignaturePacket
+
+// Delta stream instructions
+#define DELTA_OP_COPY    1 // copy blocks of the receiver's copy
+#define DELTA_OP_LITERAL 2 // new bytes follow
+
+#define PARITY_PAYLOAD_OFFSET (sizeof(uint8_t) + sizeof(uint32_t) + sizeof(uint8_t)) // packetType + group + index
+
+// ChunkHeader kinds
+#define CHUNK_RAW 0 // chunk stored as is (incompressible data bypasses the compressor)
+#define CHUNK_LZ4 1 // chunk stored in LZ4 block format
+
+
+// The structs below are the in-memory form of each packet. What goes on the wire is described by the
+// matching *Layout typedef: fields are written back to back at fixed offsets, integers in network byte order,
+// and the rest of the 256 bytes is zero filled. Never memcpy/reinterpret_cast a packet struct to or from a buffer.
+
+typedef struct MetaPacket // 256 Bytes fixed on the wire
 {
     uint8_t   packetType; // 1 Byte
     char      filename[MAX_FILENAME_LENGTH]; // 100 Bytes
     uint64_t  fileSize; // 8 Bytes
     uint64_t  totalBlocks; // 8 Bytes
     uint8_t   md5[MD5_HASH_LENGTH]; // 16 Bytes (128 bits)
-    uint8_t   padding[PADDING_SIZE]; // 133 Bytes
+    uint8_t   flags; // 1 Byte  (META_FLAG_*)
+    uint64_t  wireSize; // 8 Bytes, bytes carried by the blocks (== fileSize unless compressed)
+    uint8_t   fecScheme; // 1 Byte  (FEC_NONE / FEC_XOR / FEC_REED_SOLOMON)
+    uint8_t   fecGroupSize; // 1 Byte, data blocks per FEC group (K)
+    uint8_t   fecParityCount; // 1 Byte, parity blocks per FEC group (M)
+    uint16_t  streamCount; // 2 Bytes, files the sender transfers side by side on the connection (0 = 1)
+    uint8_t   flowCount; // 1 Byte, parallel flows (connections) the blocks are split across (0 = 1)
+                                    // 108 Bytes zero padding
 }MetaPacket;
 
 
-#pragma pack(push, 1) // Sets the byte alignment of the structure to 1 byte, 
-                      // otherwiese the packetType will be auto fill seven zero after the packetType(uint_8) => 1000 0000 
-                      // and the payLoad will be lost 7 bytes data
-struct BlockPacket // 256 Bytes fixed
+struct BlockPacket // 256 Bytes fixed on the wire
 {
     uint8_t   packetType; // 1 Byte
     uint64_t  localSequence; // 8 Bytes
     char      payLoad[PAYLOAD_SIZE]; // Maximum 247 Bytes
 };
-#pragma pack(pop)
+
+
+struct ParityPacket // 256 Bytes fixed on the wire
+{
+    uint8_t   packetType; // 1 Byte
+    uint32_t  group; // 4 Bytes, FEC group index (covers blocks group * K .. group * K + K - 1)
+    uint8_t   index; // 1 Byte, parity block index within the group (0 .. M-1)
+    char      payLoad[PAYLOAD_SIZE]; // 247 Bytes, parity over the group's zero padded block payloads
+                                     // 3 Bytes zero padding
+};
+
+
+struct ResumePacket // 256 Bytes fixed on the wire, receiver -> sender
+{
+    uint8_t   packetType; // 1 Byte
+    uint8_t   last; // 1 Byte, 1 on the final ResumePacket of the reply
+    uint16_t  rangeCount; // 2 Bytes, used entries of the arrays below
+    uint64_t  rangeFirst[RESUME_MAX_RANGES]; // 120 Bytes, first block of each range already on the receiver
+    uint64_t  rangeLength[RESUME_MAX_RANGES]; // 120 Bytes, number of blocks in each range
+                                              // 12 Bytes zero padding
+};
+
+
+struct SignaturePacket // 256 Bytes fixed on the wire, receiver -> sender
+{
+    uint8_t   packetType; // 1 Byte
+    uint8_t   last; // 1 Byte, 1 on the final SignaturePacket of the reply
+    uint16_t  count; // 2 Bytes, used entries of the arrays below
+    uint64_t  firstIndex; // 8 Bytes, block index of the first signature
+    uint32_t  weak[SIGNATURES_PER_PACKET]; // 80 Bytes, rolling checksums
+    uint64_t  strong[SIGNATURES_PER_PACKET]; // 160 Bytes, truncated MD5s
+                                             // 4 Bytes zero padding
+};
+
+
+struct DeltaCopy // 13 Bytes, delta stream instruction
+{
+    uint8_t   op; // DELTA_OP_COPY
+    uint64_t  first; // first block of the receiver's copy
+    uint32_t  count; // number of consecutive blocks
+};
+
+
+struct DeltaLiteral // 5 Bytes + length, delta stream instruction
+{
+    uint8_t   op; // DELTA_OP_LITERAL
+    uint32_t  length; // number of new bytes that follow
+};
+
+
+struct ChunkHeader // 5 Bytes, precedes every chunk of a compressed wire image
+{
+    uint8_t   kind; // 1 Byte  (CHUNK_RAW / CHUNK_LZ4)
+    uint32_t  storedSize; // 4 Bytes, bytes of chunk data that follow
+};
+
+
+
+// Wire layouts
+
+typedef wire::Layout<PACKET_SIZE,
+    wire::Field<&MetaPacket::packetType>,
+    wire::Field<&MetaPacket::filename>,
+    wire::Field<&MetaPacket::fileSize>,
+    wire::Field<&MetaPacket::totalBlocks>,
+    wire::Field<&MetaPacket::md5>,
+    wire::Field<&MetaPacket::flags>,
+    wire::Field<&MetaPacket::wireSize>,
+    wire::Field<&MetaPacket::fecScheme>,
+    wire::Field<&MetaPacket::fecGroupSize>,
+    wire::Field<&MetaPacket::fecParityCount>,
+    wire::Field<&MetaPacket::streamCount>,
+    wire::Field<&MetaPacket::flowCount>> MetaPacketLayout;
+
+typedef wire::Layout<PACKET_SIZE,
+    wire::Field<&BlockPacket::packetType>,
+    wire::Field<&BlockPacket::localSequence>,
+    wire::Field<&BlockPacket::payLoad>> BlockPacketLayout;
+
+// the fields in front of a BlockPacket's payload, for sending the payload from a separate buffer
+typedef wire::Layout<PACKET_SIZE - PAYLOAD_SIZE,
+    wire::Field<&BlockPacket::packetType>,
+    wire::Field<&BlockPacket::localSequence>> BlockHeaderLayout;
+
+typedef wire::Layout<PACKET_SIZE,
+    wire::Field<&ParityPacket::packetType>,
+    wire::Field<&ParityPacket::group>,
+    wire::Field<&ParityPacket::index>,
+    wire::Field<&ParityPacket::payLoad>> ParityPacketLayout;
+
+typedef wire::Layout<PACKET_SIZE,
+    wire::Field<&ResumePacket::packetType>,
+    wire::Field<&ResumePacket::last>,
+    wire::Field<&ResumePacket::rangeCount>,
+    wire::Field<&ResumePacket::rangeFirst>,
+    wire::Field<&ResumePacket::rangeLength>> ResumePacketLayout;
+
+typedef wire::Layout<PACKET_SIZE,
+    wire::Field<&SignaturePacket::packetType>,
+    wire::Field<&SignaturePacket::last>,
+    wire::Field<&SignaturePacket::count>,
+    wire::Field<&SignaturePacket::firstIndex>,
+    wire::Field<&SignaturePacket::weak>,
+    wire::Field<&SignaturePacket::strong>> SignaturePacketLayout;
+
+typedef wire::Layout<13,
+    wire::Field<&DeltaCopy::op>,
+    wire::Field<&DeltaCopy::first>,
+    wire::Field<&DeltaCopy::count>> DeltaCopyLayout;
+
+typedef wire::Layout<5,
+    wire::Field<&DeltaLiteral::op>,
+    wire::Field<&DeltaLiteral::length>> DeltaLiteralLayout;
+
+typedef wire::Layout<5,
+    wire::Field<&ChunkHeader::kind>,
+    wire::Field<&ChunkHeader::storedSize>> ChunkHeaderLayout;
+
+static_assert(BlockPacketLayout::fieldBytes == PACKET_SIZE, "BlockPacket must fill the whole packet");
+static_assert(BlockPacketLayout::OffsetOf<2>() == PACKET_SIZE - PAYLOAD_SIZE, "payload offset mismatch");
+static_assert(BlockHeaderLayout::fieldBytes == BlockHeaderLayout::size, "BlockHeader must end where the payload starts");
+static_assert(ParityPacketLayout::OffsetOf<3>() == PARITY_PAYLOAD_OFFSET, "parity payload offset mismatch");
 
 #endif // !_PROTOCOL_H_
 
@@ -14,135 +14,153 @@
 #include <fstream>
 #include <string>
 #include <vector>
-#include <chrono> // for timmer
+#include <memory>
+#include <cstdlib>
 
 #include "Net.h"
-#include "FileProcess.h"
+#include "TransferSession.h"
+#include "Log.h"
+#include "Trace.h"
 
 
-//#define SHOW_ACKS
-
 using namespace std;
 using namespace net;
 
-const int ServerPort = 30000;
-const int ClientPort = 30001;
-const int ProtocolId = 0x11223344;
-const float DeltaTime = 1.0f / 30.0f;
-const float SendRate = 1.0f / 30.0f;
-const float TimeOut = 10.0f;
-const int PacketSize = 256;
 
 
-// Class Name: FlowControl
-// Class Description:
-class FlowControl
+// ----------------------------------------------
+
+// Function Name: PrintUsage
+// Function Description: Logs the command line of both modes
+static void PrintUsage(const char* program)
 {
-public:
+	LOG_ERROR(" Usage: %s [--paths n] [--flows n] [--io-uring] [--busy-poll] [--cpu n] [--ack-every n] [--ack-delay us] [--metrics file] [--trace file] [--log-level level]", program);
+	LOG_ERROR("        %s <IPv4> <fileName> [--file fileName]... [--compress] [--fec xor|rs[:K[:M]]] [--resume] [--delta] [--zero-copy] [--path local[,remote]]... [--md5-test] [options above]", program);
+}
 
-	FlowControl()
-	{
-		printf("flow control initialized\n");
-		Reset();
-	}
+// Function Name: ParseCount
+// Function Description: Reads a whole decimal integer between low and high; returns false for anything else
+static bool ParseCount(const char* text, long low, long high, int& value)
+{
+	char* end = NULL;
+	const long number = strtol(text, &end, 10);
+	if (end == text || *end != '\0' || number < low || number > high)
+		return false;
+	value = (int)number;
+	return true;
+}
 
-	void Reset()
+int main(int argc, char* argv[])
+{
+	enum Mode
 	{
-		mode = Bad;
-		penalty_time = 4.0f;
-		good_conditions_time = 0.0f;
-		penalty_reduction_accumulator = 0.0f;
-	}
+		Client,
+		Server
+	};
 
-	void Update(float deltaTime, float rtt)
+	// Parse command line arguments to determine mode of operation (Server or Client)
+	Mode mode = Server;
+	Address address;
+	const char* fileName = NULL; // for file that want to transfer
+	vector<string> fileNames; // every file of the run, each sent as its own stream (fileName first)
+	TransferOptions options; // compression, FEC, resume, delta, zero-copy, MD5 test, paths, flows, io_uring, busy-poll
+	int fecGroupSize = 0; // data blocks per FEC group
+	int fecParityCount = 0; // parity blocks per FEC group
+	const char* metricsPath = NULL; // file the connection metrics are exported to (.json or Prometheus text)
+	const char* tracePath = NULL; // binary event trace, see Tools/TraceConvert
+	int pinCpu = -1; // CPU the main thread is pinned to (-1 = not pinned)
+
+	// --metrics <file>, --trace <file>, --log-level <level>, --paths <n>, --flows <n>, --busy-poll, --cpu <n>, --ack-every <n>, --ack-delay <us> and --io-uring are accepted in both modes, so take them out before the positional arguments are read
+	for (int i = 1; i < argc; )
 	{
-		const float RTT_Threshold = 250.0f;
-
-		if (mode == Good)
+		const bool hasValue = i + 1 < argc;
+		int consumed = 2;
+		if (hasValue && strcmp(argv[i], "--metrics") == 0)
+		{
+			metricsPath = argv[i + 1];
+		}
+		else if (hasValue && strcmp(argv[i], "--trace") == 0)
+		{
+			tracePath = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "--io-uring") == 0)
+		{
+			options.ioUring = true;
+			consumed = 1;
+		}
+		else if (strcmp(argv[i], "--busy-poll") == 0)
 		{
-			if (rtt > RTT_Threshold)
+			options.busyPoll = true;
+			consumed = 1;
+		}
+		else if (hasValue && strcmp(argv[i], "--cpu") == 0)
+		{
+			pinCpu = atoi(argv[i + 1]);
+		}
+		else if (hasValue && strcmp(argv[i], "--ack-every") == 0)
+		{
+			if (!ParseCount(argv[i + 1], 0, MaxAckEveryPackets, options.ackPackets))
 			{
-				printf("*** dropping to bad mode ***\n");
-				mode = Bad;
-				if (good_conditions_time < 10.0f && penalty_time < 60.0f)
-				{
-					penalty_time *= 2.0f;
-					if (penalty_time > 60.0f)
-						penalty_time = 60.0f;
-					printf("penalty time increased to %.1f\n", penalty_time);
-				}
-				good_conditions_time = 0.0f;
-				penalty_reduction_accumulator = 0.0f;
-				return;
+				LOG_ERROR("--ack-every must be a number of packets between 0 and %d", MaxAckEveryPackets);
+				return 1;
 			}
-
-			good_conditions_time += deltaTime;
-			penalty_reduction_accumulator += deltaTime;
-
-			if (penalty_reduction_accumulator > 10.0f && penalty_time > 1.0f)
+		}
+		else if (hasValue && strcmp(argv[i], "--ack-delay") == 0)
+		{
+			if (!ParseCount(argv[i + 1], 0, MaxAckDelayMicroseconds, options.ackDelayMicroseconds))
 			{
-				penalty_time /= 2.0f;
-				if (penalty_time < 1.0f)
-					penalty_time = 1.0f;
-				printf("penalty time reduced to %.1f\n", penalty_time);
-				penalty_reduction_accumulator = 0.0f;
+				LOG_ERROR("--ack-delay must be a number of microseconds between 0 and %d", MaxAckDelayMicroseconds);
+				return 1;
 			}
 		}
-
-		if (mode == Bad)
+		else if (hasValue && strcmp(argv[i], "--paths") == 0)
 		{
-			if (rtt <= RTT_Threshold)
-				good_conditions_time += deltaTime;
-			else
-				good_conditions_time = 0.0f;
-
-			if (good_conditions_time > penalty_time)
+			options.pathCount = atoi(argv[i + 1]);
+			if (options.pathCount < 1 || options.pathCount > MaxPaths)
 			{
-				printf("*** upgrading to good mode ***\n");
-				good_conditions_time = 0.0f;
-				penalty_reduction_accumulator = 0.0f;
-				mode = Good;
-				return;
+				LOG_ERROR("--paths must be between 1 and %d", MaxPaths);
+				return 1;
 			}
 		}
-	}
+		else if (hasValue && strcmp(argv[i], "--flows") == 0)
+		{
+			options.flowCount = atoi(argv[i + 1]);
+			if (options.flowCount < 1 || options.flowCount > MaxFlows)
+			{
+				LOG_ERROR("--flows must be between 1 and %d", MaxFlows);
+				return 1;
+			}
+		}
+		else if (hasValue && strcmp(argv[i], "--log-level") == 0)
+		{
+			int level = LogParseLevel(argv[i + 1]);
+			if (level < 0)
+			{
+				LOG_ERROR("Unknown log level: %s (use trace, debug, info, warn, error or off)", argv[i + 1]);
+				return 1;
+			}
+			if (level < LOG_COMPILE_LEVEL)
+				LOG_WARN("Log level %s is compiled out of this build", argv[i + 1]);
+			LogSetLevel(level);
+		}
+		else
+		{
+			i++;
+			continue;
+		}
 
-	float GetSendRate()
-	{
-		return mode == Good ? 30.0f : 10.0f;
+		for (int j = i; j + consumed <= argc; j++)
+			argv[j] = argv[j + consumed];
+		argc -= consumed;
 	}
 
-private:
-
-	enum Mode
-	{
-		Good,
-		Bad
-	};
-
-	Mode mode;
-	float penalty_time;
-	float good_conditions_time;
-	float penalty_reduction_accumulator;
-};
-
-
-
-// ----------------------------------------------
-
-int main(int argc, char* argv[])
-{
-	enum Mode
+	// the server takes no positional argument, so an option left over here is a misspelled or misplaced one
+	if (argc >= 2 && strncmp(argv[1], "--", 2) == 0)
 	{
-		Client,
-		Server
-	};
-
-	// Parse command line arguments to determine mode of operation (Server or Client)
-	Mode mode = Server;
-	Address address;
-	const char* fileName = NULL; // for file that want to transfer
-	bool md5Test = false; // for test that verify file integrity function
+		LOG_ERROR("Unknown option: %s", argv[1]);
+		PrintUsage(argv[0]);
+		return 1;
+	}
 
 	if (argc >= 2)
 	{
@@ -156,13 +174,13 @@ int main(int argc, char* argv[])
 		}
 		else
 		{
-			fprintf(stderr, "Invalid Ip Address !!!\n");
+			LOG_ERROR("Invalid Ip Address !!!");
 			return 1;
 		}
 
 		if (a < 0 || a > 255 || b < 0 || b > 255 || c < 0 || c > 255 || d < 0 || d > 255)
 		{
-			fprintf(stderr, "Out of IPv4 range !!!! Ex. 127.0.0.1\n");
+			LOG_ERROR("Out of IPv4 range !!!! Ex. 127.0.0.1");
 			return 1;
 		}
 
@@ -172,295 +190,193 @@ int main(int argc, char* argv[])
 		{
 			// Retrieving the file from disk
 			fileName = argv[2];
-			printf("The file will be transfered: %s\n", fileName);
+			fileNames.push_back(fileName);
+			LOG_INFO("The file will be transfered: %s", fileName);
 
-			if (argc >= 4)
+			// Optional switches; anything else is rejected, so a typo cannot silently change the transfer
+			for (int i = 3; i < argc; i++)
 			{
-				md5Test = true;
-				printf("**MD5 test mode enabled.\n");
-			}
-		}
-		else
-		{
-			fprintf(stderr, "Please provide the filename you want to transfer !!!\n Usage: %s <IPv4> <fileName> <test(option)>\n", argv[0]);
-			return 1;
-		}
-	}
-
-
-	// First, Let's initialize the network socket library (call WSAStartup on Windows)
-	if (!InitializeSockets())
-	{
-		printf("failed to initialize sockets\n");
-		return 1;
-	}
-
-
-	// Then, Create a ReliableConnection object (ProtocolId for protocolID, Timeout for timeout)
-	ReliableConnection connection(ProtocolId, TimeOut);
-
-
-	// Select port based on mode
-	const int port = mode == Server ? ServerPort : ClientPort;
-
-
-	// Start the connection (bind port)
-	if (!connection.Start(port))
-	{
-		printf("could not start connection on port %d\n", port);
-		return 1;
-	}
-
-
-	// Set connection status of server and client
-	if (mode == Client)
-		connection.Connect(address); // Set the connection status to Connecting and store the destination server address
-	else
-		connection.Listen(); // Set the connection status to Listening
-
-
-
-
-
-	bool connected = false;
-	float sendAccumulator = 0.0f;
-	float statsAccumulator = 0.0f;
-
-	FlowControl flowControl;
-
-
-	FileBlock fileBlock;
-	int fileLoaded = -1;  // indicates if file loaddded
-	int allDone = -1;        // indicates if file sent successfully
-
-	chrono::high_resolution_clock::time_point startTime; // Timmer that calculate transmission time and rate
-	bool timingStarted = false;
-
-	// The main logic of load, send, recieve 
-	while (allDone != 0)
-	{
-		// Update flow control (adjust send rate based on RTT)
-		if (connection.IsConnected())
-			flowControl.Update(DeltaTime, connection.GetReliabilitySystem().GetRoundTripTime() * 1000.0f);
-
-
-		const float sendRate = flowControl.GetSendRate();
-
-
-
-
-		// detect changes in connection state
-
-		if (mode == Server && connected && !connection.IsConnected())
-		{
-			flowControl.Reset();
-			printf("reset flow control\n");
-			connected = false;
-		}
-
-
-
-		if (!connected && connection.IsConnected())
-		{
-			printf("client connected to server\n");
-			connected = true;
-
-			// if using client mode, then load file from computer and split the whole file content into multiple blocks.
-			if (mode == Client)
-			{
-				if (fileBlock.LoadFile(fileName) != 0)
+				if (strcmp(argv[i], "--compress") == 0)
 				{
-					fprintf(stderr, "Some error happen when loading file.\n");
-					return -1;
+					options.compress = true;
+					LOG_INFO("**Compression enabled.");
 				}
-
-				fileLoaded = 0;
-			}
-
-		}
-
-		if (!connected && connection.ConnectFailed())
-		{
-			printf("connection failed\n");
-			break;
-		}
-
-
-
-
-		// Send our Packets (Meta + Blocks)
-
-		sendAccumulator += DeltaTime;
-		while (sendAccumulator > 1.0f / sendRate)
-		{
-			unsigned char packet[PacketSize];
-			memset(packet, 0, sizeof(packet)); // Clear the buffer
-
-			static int metaSent = -1; // metaSent flags if metadata has been sent
-			static int n = 0; // n indicates current index of blocks
-
-			if (mode == Client && fileLoaded == 0)
-			{
-				// send the meta packet first if haven't send the meta packet yet
-				if (metaSent != 0)
+				else if (strcmp(argv[i], "--resume") == 0)
 				{
-					printf("Sending %s, %llu bytes, %llu total slices.\n",
-						fileBlock.GetMetaPacket().filename,
-						(unsigned long long)fileBlock.GetMetaPacket().fileSize, // here using long long, bcoz we were using uint_64
-						(unsigned long long)fileBlock.GetMetaPacket().totalBlocks);
-
-					// Copy the entire MetaPacket (fixed 256 bytes) into a packet and send it out later
-					memcpy(packet, &fileBlock.GetMetaPacket(), PacketSize);
-					metaSent = 0;
-
+					options.resume = true;
+					LOG_INFO("**Resumable transfer enabled.");
 				}
-				else // send the BlockPacket if the meta packet has been sent
+				else if (strcmp(argv[i], "--delta") == 0)
 				{
-					if (n < fileBlock.GetBlocks().size())
-					{
-						printf("Sending %d/%llu...\n",
-							n + 1,
-							(unsigned long long)fileBlock.GetMetaPacket().totalBlocks);
-
-						memcpy(packet, &fileBlock.GetBlocks()[n], PacketSize);
-						n++;
-
-						// here is temprory MD5 hard code test
-						if (md5Test)
-						{
-							packet[10] = 18; // 'R'
-							packet[11] = 10; // 'J'
-						}
-					}
-					else
+					options.delta = true;
+					LOG_INFO("**Delta transfer enabled.");
+				}
+				else if (strcmp(argv[i], "--zero-copy") == 0)
+				{
+					options.zeroCopy = true;
+					LOG_INFO("**Zero-copy send enabled.");
+				}
+				else if (strcmp(argv[i], "--file") == 0 && i + 1 < argc)
+				{
+					// further files go out at the same time, each on its own stream
+					if ((int)fileNames.size() >= MaxStreams)
 					{
-						// tell the user that all file content sent
-						printf("Finish Sent file: %s\n", fileName);
-						allDone = 0;
+						LOG_ERROR("At most %d files can be sent at once", MaxStreams);
+						return 1;
 					}
-				
+					fileNames.push_back(argv[++i]);
+					LOG_INFO("The file will be transfered: %s", fileNames.back().c_str());
 				}
-
-			}
-
-
-
-			// Keep Send Heartbeat Packet while sending the file packets
-			connection.SendPacket(packet, sizeof(packet));
-			sendAccumulator -= 1.0f / sendRate;
-		}
-
-
-		// Receive the Packet
-		while (true)
-		{
-			unsigned char packet[256];
-			int bytes_read = connection.ReceivePacket(packet, sizeof(packet));
-			if (bytes_read == 0)
-				break;
-
-			// only server have to execute the following things
-			if (mode == Server)
-			{
-				if (fileBlock.FinishedReceivedAllData() != 0) 
+				else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc)
 				{
-					if (!timingStarted)
+					// --path <local IPv4>[,<remote IPv4>]: one more path, bound to a local interface
+					int l[4] = { 0 }, r[4] = { 0 };
+#pragma warning(suppress : 4996)
+					int fields = sscanf(argv[++i], "%d.%d.%d.%d,%d.%d.%d.%d", &l[0], &l[1], &l[2], &l[3], &r[0], &r[1], &r[2], &r[3]);
+					if (fields != 4 && fields != 8)
 					{
-						startTime = chrono::high_resolution_clock::now();
-						timingStarted = true;
-						printf("Timing started: first data packet received.\n");
+						LOG_ERROR("Invalid path: %s (use <local IPv4>[,<remote IPv4>])", argv[i]);
+						return 1;
 					}
-
-					printf("----------------------------------------------------------------\n");
-					printf("Receiving data...\n");
-					int ret = fileBlock.ProcessReceivedPacket(packet, bytes_read);
-					if (ret != 0)
+					const unsigned int local = Address(l[0], l[1], l[2], l[3], 0).GetAddress();
+					const unsigned int remote = fields == 8 ? Address(r[0], r[1], r[2], r[3], 0).GetAddress() : 0;
+					options.pathAddresses.push_back(make_pair(local, remote));
+					if ((int)options.pathAddresses.size() + 1 > MaxPaths)
 					{
-						printf("Processed non-meta/block packet.\n");
+						LOG_ERROR("At most %d paths can be used", MaxPaths);
+						return 1;
 					}
-					printf("----------------------------------------------------------------\n");
+					LOG_INFO("**Path %d: local %s", (int)options.pathAddresses.size(), argv[i]);
 				}
-				else
+				else if (strcmp(argv[i], "--fec") == 0 && i + 1 < argc)
 				{
-					// Record the end time and calculate the transmission time
-					auto endTime = chrono::high_resolution_clock::now();
-					chrono::duration<double> transferTime = endTime - startTime;
-					double timeSec = transferTime.count();
+					// --fec xor[:K] or --fec rs[:K[:M]]
+					char scheme[8] = { 0 };
+					fecGroupSize = 0;
+					fecParityCount = 0;
+#pragma warning(suppress : 4996)
+					sscanf(argv[++i], "%7[a-z]:%d:%d", scheme, &fecGroupSize, &fecParityCount);
 
-					// Calculate transfer rate: file size (bytes) * 8 / (time seconds * 1e6) = Mbps
-					double speedMbps = (fileBlock.GetMetaPacket().fileSize * 8) / (timeSec * 1e6);
+					if (strcmp(scheme, "xor") == 0)
+						options.fecScheme = FEC_XOR;
+					else if (strcmp(scheme, "rs") == 0)
+						options.fecScheme = FEC_REED_SOLOMON;
+					else
+					{
+						LOG_ERROR("Unknown FEC scheme: %s (use xor or rs)", argv[i]);
+						return 1;
+					}
 
-					printf("*****************************************************************\n");
-					printf("All data received!\n");
-					printf("Transfer time: %.3f seconds, speed: %.3f Mbps\n", timeSec, speedMbps);
-					printf("Calculating the validation...\n");
+					if (fecGroupSize <= 0)
+						fecGroupSize = options.fecScheme == FEC_XOR ? 8 : 16;
+					if (fecParityCount <= 0)
+						fecParityCount = options.fecScheme == FEC_XOR ? 1 : 2;
 
-					if (fileBlock.VerifyFileContent())
+					if (fecGroupSize > FEC_MAX_GROUP_SIZE || fecParityCount > FEC_MAX_PARITY_COUNT)
 					{
-						// Save the data into the file
-						if (fileBlock.SaveFile() == 0)
-						{
-							allDone = 0;
-						}
+						LOG_ERROR("FEC group size must be <= %d and parity count <= %d", FEC_MAX_GROUP_SIZE, FEC_MAX_PARITY_COUNT);
+						return 1;
 					}
+					options.fecGroupSize = (uint8_t)fecGroupSize;
+					options.fecParityCount = (uint8_t)fecParityCount;
+					LOG_INFO("**FEC enabled: %s, group of %d blocks.", scheme, fecGroupSize);
+				}
+				else if (strcmp(argv[i], "--md5-test") == 0)
+				{
+					// corrupts every data block so the server's MD5 check has to fail
+					options.md5Test = true;
+					LOG_INFO("**MD5 test mode enabled.");
+				}
+				else
+				{
+					LOG_ERROR("Unknown option: %s", argv[i]);
+					PrintUsage(argv[0]);
+					return 1;
 				}
 			}
-		}
-		
-
-
 
+			// a delta stream is already smaller than the file and is rebuilt from scratch on every run
+			if (options.delta && (options.compress || options.resume))
+			{
+				LOG_ERROR("--delta cannot be combined with --compress or --resume");
+				return 1;
+			}
 
-		// show packets that were acked this frame
+			// the flows split the blocks of one file, which a delta only knows once the receiver's signatures are in
+			if (options.flowCount > 1 && (options.delta || fileNames.size() > 1 || options.pathCount > 1 || !options.pathAddresses.empty()))
+			{
+				LOG_ERROR("--flows splits a single file and cannot be combined with --file, --delta, --path or --paths");
+				return 1;
+			}
 
-#ifdef SHOW_ACKS
-		unsigned int* acks = NULL;
-		int ack_count = 0;
-		connection.GetReliabilitySystem().GetAcks(&acks, ack_count);
-		if (ack_count > 0)
+			// the MD5 test corrupts the packet buffer, which a zero-copy send never uses for the payload
+			if (options.zeroCopy && options.md5Test)
+			{
+				LOG_INFO("**MD5 test mode needs copied payloads, zero-copy send disabled.");
+				options.zeroCopy = false;
+			}
+		}
+		else
 		{
-			printf("acks: %d", acks[0]);
-			for (int i = 1; i < ack_count; ++i)
-				printf(",%d", acks[i]);
-			printf("\n");
+			LOG_ERROR("Please provide the filename you want to transfer !!!");
+			PrintUsage(argv[0]);
+			return 1;
 		}
-#endif
+	}
 
 
-		
-		// Update connection status (timeout detection, statistics)
-		connection.Update(DeltaTime);
+	// First, Let's initialize the network socket library (call WSAStartup on Windows)
+	if (!InitializeSockets())
+	{
+		LOG_ERROR("failed to initialize sockets");
+		return 1;
+	}
 
 
-		// show connection stats
+	// Then, bind the ports of every path and connect to the server or listen for the client
+	TransferSession session(mode == Client ? TransferSender : TransferReceiver, options);
+	if (session.Start(address) != 0)
+		return 1;
 
-		statsAccumulator += DeltaTime;
+	// low latency: the spinning thread is pinned so it keeps its cache
+	if (pinCpu >= 0)
+	{
+		if (PinThread(pinCpu))
+			LOG_INFO("**Main thread pinned to CPU %d", pinCpu);
+		else
+			LOG_WARN("Could not pin the main thread to CPU %d", pinCpu);
+	}
 
-		while (statsAccumulator >= 0.25f && connection.IsConnected())
-		{
-			float rtt = connection.GetReliabilitySystem().GetRoundTripTime();
+	// record transfer events until the program exits
+	if (tracePath)
+	{
+		if (TraceStart(tracePath) != 0)
+			return 1;
+		LOG_INFO("**Tracing events to %s", tracePath);
+	}
 
-			unsigned int sent_packets = connection.GetReliabilitySystem().GetSentPackets();
-			unsigned int acked_packets = connection.GetReliabilitySystem().GetAckedPackets();
-			unsigned int lost_packets = connection.GetReliabilitySystem().GetLostPackets();
+	// rewrite the metrics file once a second from a background thread, and once more on exit
+	unique_ptr<MetricsExporter> metricsExporter;
+	if (metricsPath)
+	{
+		metricsExporter.reset(new MetricsExporter(MetricsRegistry::Global(), metricsPath, 1.0f));
+		LOG_INFO("**Metrics exported to %s", metricsPath);
+	}
 
-			float sent_bandwidth = connection.GetReliabilitySystem().GetSentBandwidth();
-			float acked_bandwidth = connection.GetReliabilitySystem().GetAckedBandwidth();
 
-			printf("rtt %.1fms, sent %d, acked %d, lost %d (%.1f%%), sent bandwidth = %.1fkbps, acked bandwidth = %.1fkbps\n",
-				rtt * 1000.0f, sent_packets, acked_packets, lost_packets,
-				sent_packets > 0.0f ? (float)lost_packets / (float)sent_packets * 100.0f : 0.0f,
-				sent_bandwidth, acked_bandwidth);
+	// The main logic of load, send, recieve: the client sends its files, the server receives one transfer
+	int result = mode == Client ? session.Send(fileNames) : session.Receive();
 
-			statsAccumulator -= 0.25f;
-		}
+	// write the final metrics while the connections are still registered; Stop unregisters them
+	metricsExporter.reset();
+	session.Stop();
 
-		net::wait(DeltaTime);
-	}
 
+	// Complete the trace file (also done at exit for the early returns above)
+	TraceStop();
 
 	// After use program, we have to shutdown sockets; releasing resources from the Winsock library
 	ShutdownSockets();
 
-	return 0;
+	return result == 0 ? 0 : 1;
 }
@@ -0,0 +1,191 @@
+// File Name: Serialize.h
+// Date: 2026-10
+// File Description:
+//      -- Compile-time field descriptors used to describe the on-wire layout of every header and packet.
+//      -- A Layout lists the fields of a struct in wire order; their offsets are fixed at compile time and
+//      -- scalar fields are always stored in network (big-endian) byte order, so the encoded bytes no longer
+//      -- depend on the compiler's struct padding or on the host endianness.
+
+#ifndef _SERIALIZE_H_
+#define _SERIALIZE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(_MSC_VER)
+#include <stdlib.h> // for _byteswap_*
+#endif
+
+namespace wire
+{
+	// host byte order detection (all supported Windows targets are little-endian)
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	constexpr bool HostIsBigEndian = true;
+#else
+	constexpr bool HostIsBigEndian = false;
+#endif
+
+
+	inline uint8_t ByteSwap(uint8_t value) { return value; }
+
+	inline uint16_t ByteSwap(uint16_t value)
+	{
+#if defined(_MSC_VER)
+		return _byteswap_ushort(value);
+#else
+		return __builtin_bswap16(value);
+#endif
+	}
+
+	inline uint32_t ByteSwap(uint32_t value)
+	{
+#if defined(_MSC_VER)
+		return _byteswap_ulong(value);
+#else
+		return __builtin_bswap32(value);
+#endif
+	}
+
+	inline uint64_t ByteSwap(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		return _byteswap_uint64(value);
+#else
+		return __builtin_bswap64(value);
+#endif
+	}
+
+
+	// Function Name: StoreBigEndian
+	// Function Description: Writes an unsigned integer in network byte order with a single (unaligned) store.
+	template <typename T>
+	inline void StoreBigEndian(unsigned char* out, T value)
+	{
+		static_assert(std::is_unsigned<T>::value, "wire scalars must be unsigned integers");
+		if (!HostIsBigEndian)
+			value = ByteSwap(value);
+		std::memcpy(out, &value, sizeof(T));
+	}
+
+	// Function Name: LoadBigEndian
+	// Function Description: Reads an unsigned integer stored in network byte order with a single (unaligned) load.
+	template <typename T>
+	inline T LoadBigEndian(const unsigned char* in)
+	{
+		static_assert(std::is_unsigned<T>::value, "wire scalars must be unsigned integers");
+		T value;
+		std::memcpy(&value, in, sizeof(T));
+		if (!HostIsBigEndian)
+			value = ByteSwap(value);
+		return value;
+	}
+
+
+
+
+	// MemberTraits splits a pointer-to-member into the owning struct and the member type
+
+	template <auto Member>
+	struct MemberTraits;
+
+	template <typename S, typename T, T S::* Member>
+	struct MemberTraits<Member>
+	{
+		typedef S Struct;
+		typedef T Type;
+	};
+
+
+
+
+	// Class Name: Field
+	// Class Description:
+	//      -- Describes one struct member on the wire.
+	//      -- Unsigned integers are byte swapped to big-endian, byte arrays (filename, md5, payload) are copied verbatim,
+	//      -- arrays of wider integers are stored element by element in big-endian.
+	template <auto Member>
+	struct Field
+	{
+		typedef typename MemberTraits<Member>::Struct Struct;
+		typedef typename MemberTraits<Member>::Type Type;
+		typedef typename std::remove_extent<Type>::type Element;
+
+		static constexpr size_t size = sizeof(Type);
+		static constexpr size_t count = sizeof(Type) / sizeof(Element);
+
+		static void Encode(const Struct& s, unsigned char* out)
+		{
+			if constexpr (std::is_array<Type>::value && sizeof(Element) == 1)
+				std::memcpy(out, s.*Member, size);
+			else if constexpr (std::is_array<Type>::value)
+			{
+				for (size_t i = 0; i < count; ++i)
+					StoreBigEndian(out + i * sizeof(Element), (s.*Member)[i]);
+			}
+			else
+				StoreBigEndian(out, s.*Member);
+		}
+
+		static void Decode(Struct& s, const unsigned char* in)
+		{
+			if constexpr (std::is_array<Type>::value && sizeof(Element) == 1)
+				std::memcpy(s.*Member, in, size);
+			else if constexpr (std::is_array<Type>::value)
+			{
+				for (size_t i = 0; i < count; ++i)
+					(s.*Member)[i] = LoadBigEndian<Element>(in + i * sizeof(Element));
+			}
+			else
+				s.*Member = LoadBigEndian<Type>(in);
+		}
+	};
+
+
+
+
+	// Class Name: Layout
+	// Class Description:
+	//      -- A fixed-size wire record made of the listed fields packed back to back (no padding).
+	//      -- Offsets are computed at compile time; any bytes after the last field up to Size are zero on encode.
+	template <size_t Size, typename... Fields>
+	struct Layout
+	{
+		static constexpr size_t size = Size;
+		static constexpr size_t fieldBytes = (Fields::size + ... + 0);
+
+		static_assert(sizeof...(Fields) > 0, "a layout needs at least one field");
+		static_assert(fieldBytes <= Size, "fields do not fit into the layout size");
+
+		// Byte offset of the Index-th field
+		template <size_t Index>
+		static constexpr size_t OffsetOf()
+		{
+			constexpr size_t sizes[] = { Fields::size... };
+			size_t offset = 0;
+			for (size_t i = 0; i < Index; ++i)
+				offset += sizes[i];
+			return offset;
+		}
+
+		template <typename S>
+		static void Encode(const S& s, unsigned char* out)
+		{
+			size_t offset = 0;
+			((Fields::Encode(s, out + offset), offset += Fields::size), ...);
+			if (fieldBytes < Size)
+				std::memset(out + fieldBytes, 0, Size - fieldBytes);
+		}
+
+		template <typename S>
+		static void Decode(S& s, const unsigned char* in)
+		{
+			size_t offset = 0;
+			((Fields::Decode(s, in + offset), offset += Fields::size), ...);
+		}
+	};
+}
+
+#endif // !_SERIALIZE_H_
@@ -0,0 +1,224 @@
+// File Name: Trace.cpp
+// Date: 2026-10
+// File Description:
+//      -- Implements the per-thread event rings and the writer thread that drains them into the trace file.
+
+#include "Trace.h"
+#include "Log.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+#define TRACE_RING_SIZE     65536   // events per thread (power of two)
+#define TRACE_DRAIN_MS      50      // how often the writer empties the rings
+
+
+// Class Name: TraceRing
+// Class Description: Single producer (the recording thread), single consumer (the writer) ring of events
+class TraceRing
+{
+
+private:
+
+    TraceEvent events[TRACE_RING_SIZE];
+    atomic<uint64_t> head{ 0 };     // next slot the producer writes
+    atomic<uint64_t> tail{ 0 };     // next slot the consumer reads
+
+public:
+
+    uint8_t thread = 0;
+    atomic<uint64_t> dropped{ 0 };
+
+    void Push(const TraceEvent& event)
+    {
+        const uint64_t at = head.load(memory_order_relaxed);
+        if (at - tail.load(memory_order_acquire) >= TRACE_RING_SIZE)
+        {
+            dropped.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+        events[at & (TRACE_RING_SIZE - 1)] = event;
+        head.store(at + 1, memory_order_release);
+    }
+
+    void Drain(vector<TraceEvent>& out)
+    {
+        const uint64_t from = tail.load(memory_order_relaxed);
+        const uint64_t to = head.load(memory_order_acquire);
+        for (uint64_t at = from; at != to; ++at)
+            out.push_back(events[at & (TRACE_RING_SIZE - 1)]);
+        tail.store(to, memory_order_release);
+    }
+
+};
+
+
+// State of the running trace
+static mutex traceLock;                              // guards everything below except the rings' contents
+static vector<shared_ptr<TraceRing>> traceRings;     // every thread that recorded, kept until the trace stops
+static FILE* traceFile = nullptr;
+static thread traceWriter;
+static condition_variable traceWake;
+static bool traceStopping = false;
+static chrono::steady_clock::time_point traceStart;
+static atomic<uint32_t> traceGeneration{ 0 };        // bumped by TraceStart so threads register a fresh ring
+
+
+// Function Name: ThreadRing
+// Function Description: The calling thread's ring, registered on its first event of the current trace
+static TraceRing& ThreadRing()
+{
+    thread_local shared_ptr<TraceRing> ring;
+    thread_local uint32_t generation = 0;
+
+    const uint32_t current = traceGeneration.load(memory_order_acquire);
+    if (!ring || generation != current)
+    {
+        ring = make_shared<TraceRing>();
+        generation = current;
+        lock_guard<mutex> guard(traceLock);
+        ring->thread = (uint8_t)traceRings.size();
+        traceRings.push_back(ring);
+    }
+    return *ring;
+}
+
+
+// Function Name: WriteEvents
+// Function Description: Drains every ring and appends the events to the file; called with traceLock held
+static void WriteEvents(vector<TraceEvent>& batch)
+{
+    batch.clear();
+    for (const shared_ptr<TraceRing>& ring : traceRings)
+        ring->Drain(batch);
+
+    unsigned char raw[TraceEventLayout::size];
+    for (const TraceEvent& event : batch)
+    {
+        TraceEventLayout::Encode(event, raw);
+        fwrite(raw, 1, sizeof(raw), traceFile);
+    }
+}
+
+
+static void WriterLoop()
+{
+    vector<TraceEvent> batch;
+    unique_lock<mutex> guard(traceLock);
+    while (!traceStopping)
+    {
+        traceWake.wait_for(guard, chrono::milliseconds(TRACE_DRAIN_MS));
+        WriteEvents(batch);
+    }
+}
+
+
+
+uint64_t TraceNow()
+{
+    return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - traceStart).count();
+}
+
+
+void TraceRecord(uint8_t type, uint64_t id, uint64_t value)
+{
+    TraceRecordAt(TraceNow(), type, id, value);
+}
+
+
+void TraceRecordAt(uint64_t time, uint8_t type, uint64_t id, uint64_t value)
+{
+    TraceRing& ring = ThreadRing();
+    TraceEvent event;
+    event.time = time;
+    event.id = id;
+    event.value = value;
+    event.type = type;
+    event.thread = ring.thread;
+    ring.Push(event);
+}
+
+
+int TraceStart(const char* path)
+{
+    lock_guard<mutex> guard(traceLock);
+    if (traceFile)
+    {
+        LOG_ERROR("A trace is already being written");
+        return -1;
+    }
+
+#pragma warning(suppress : 4996)
+    traceFile = fopen(path, "wb");
+    if (!traceFile)
+    {
+        LOG_ERROR("Cannot create trace file: %s", path);
+        return -1;
+    }
+
+    TraceFileHeader header;
+    header.magic = TRACE_MAGIC;
+    header.version = TRACE_VERSION;
+    header.eventSize = (uint16_t)TraceEventLayout::size;
+    header.startUnixNs = (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    header.reserved = 0;
+    unsigned char raw[TraceFileHeaderLayout::size];
+    TraceFileHeaderLayout::Encode(header, raw);
+    fwrite(raw, 1, sizeof(raw), traceFile);
+
+    static bool exitHandler = false;
+    if (!exitHandler)
+    {
+        atexit(TraceStop);
+        exitHandler = true;
+    }
+
+    traceRings.clear();
+    traceStart = chrono::steady_clock::now();
+    traceStopping = false;
+    traceGeneration.fetch_add(1, memory_order_release);
+    traceWriter = thread(WriterLoop);
+    TraceEnabled.store(true, memory_order_release);
+    return 0;
+}
+
+
+void TraceStop()
+{
+    {
+        lock_guard<mutex> guard(traceLock);
+        if (!traceFile)
+            return;
+        TraceEnabled.store(false, memory_order_release);
+        traceStopping = true;
+    }
+    traceWake.notify_one();
+    traceWriter.join();
+
+    lock_guard<mutex> guard(traceLock);
+    vector<TraceEvent> batch;
+    WriteEvents(batch);
+
+    // events recorded by a thread that had already seen TraceEnabled are lost here; they are too few to matter
+    uint64_t dropped = 0;
+    for (const shared_ptr<TraceRing>& ring : traceRings)
+        dropped += ring->dropped.load(memory_order_relaxed);
+    TraceEvent summary = { TraceNow(), 0, dropped, TRACE_DROPPED, 0 };
+    unsigned char raw[TraceEventLayout::size];
+    TraceEventLayout::Encode(summary, raw);
+    fwrite(raw, 1, sizeof(raw), traceFile);
+    if (dropped > 0)
+        LOG_WARN("Trace ring full, %llu events dropped", (unsigned long long)dropped);
+
+    fclose(traceFile);
+    traceFile = nullptr;
+    traceRings.clear();
+}
@@ -0,0 +1,126 @@
+// File Name: Trace.h
+// Date: 2026-10
+// File Description:
+//      -- Low-overhead event tracing for offline analysis of slow transfers.
+//      -- Each thread records fixed size events (packet sent / received / acked / lost, flow control changes,
+//      -- disk reads and writes) into its own lock-free single-producer ring; a writer thread drains the rings
+//      -- into a compact binary file. Tools/TraceConvert turns the file into a Chrome trace or CSV.
+//      -- When tracing is off, every TRACE_EVENT costs one relaxed atomic load.
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "Serialize.h"
+
+
+#define TRACE_MAGIC    0x52545243   // "RTRC"
+#define TRACE_VERSION  1
+
+// Event types. "id" and "value" mean:
+#define TRACE_PACKET_SENT      1    // sequence, payload bytes
+#define TRACE_PACKET_RECEIVED  2    // sequence, payload bytes
+#define TRACE_PACKET_ACKED     3    // sequence, send to ack time in ns
+#define TRACE_PACKET_LOST      4    // sequence, 0
+#define TRACE_FLOW_MODE        5    // 1 = good / 0 = bad, penalty time in ms
+#define TRACE_SEND_RATE        6    // 0, packets per second
+#define TRACE_DISK_READ        7    // bytes, duration in ns (the event time is the start)
+#define TRACE_DISK_WRITE       8    // bytes, duration in ns (the event time is the start)
+#define TRACE_DROPPED          9    // 0, events lost because a ring was full (written once at the end)
+
+
+struct TraceFileHeader // 24 Bytes at the start of the trace file
+{
+    uint32_t  magic;
+    uint16_t  version;
+    uint16_t  eventSize;        // TraceEventLayout::size
+    uint64_t  startUnixNs;      // wall clock when tracing started, to line the trace up with other logs
+    uint64_t  reserved;
+};
+
+struct TraceEvent // 26 Bytes per event, in the order they were drained (sort by time to get a timeline)
+{
+    uint64_t  time;             // ns since tracing started (monotonic clock)
+    uint64_t  id;
+    uint64_t  value;
+    uint8_t   type;
+    uint8_t   thread;           // small number per recording thread
+};
+
+typedef wire::Layout<24,
+    wire::Field<&TraceFileHeader::magic>,
+    wire::Field<&TraceFileHeader::version>,
+    wire::Field<&TraceFileHeader::eventSize>,
+    wire::Field<&TraceFileHeader::startUnixNs>,
+    wire::Field<&TraceFileHeader::reserved>> TraceFileHeaderLayout;
+
+typedef wire::Layout<26,
+    wire::Field<&TraceEvent::time>,
+    wire::Field<&TraceEvent::id>,
+    wire::Field<&TraceEvent::value>,
+    wire::Field<&TraceEvent::type>,
+    wire::Field<&TraceEvent::thread>> TraceEventLayout;
+
+
+// Set while a trace file is open
+inline std::atomic<bool> TraceEnabled{ false };
+
+#define TRACE_EVENT(type, id, value) \
+    do { if (TraceEnabled.load(std::memory_order_relaxed)) TraceRecord(type, id, value); } while (0)
+
+
+// Function Name: TraceStart
+// Function Description: Opens path and starts recording; the file is completed by TraceStop (also called at exit)
+// Return Value: int - 0 on success, -1 if the file cannot be created or a trace is already running
+int TraceStart(const char* path);
+
+// Function Name: TraceStop
+// Function Description: Stops recording, writes the remaining events and closes the file
+void TraceStop();
+
+// Function Name: TraceNow
+// Return Value: uint64_t - ns since tracing started, the time base of every event
+uint64_t TraceNow();
+
+// Function Name: TraceRecord
+// Function Description: Appends an event to the calling thread's ring (dropped and counted if the ring is full)
+void TraceRecord(uint8_t type, uint64_t id, uint64_t value);
+void TraceRecordAt(uint64_t time, uint8_t type, uint64_t id, uint64_t value);
+
+
+
+// Class Name: TraceSpan
+// Class Description: Records a disk read or write covering the lifetime of the object
+class TraceSpan
+{
+
+private:
+
+    uint8_t type;
+    uint64_t bytes;
+    uint64_t start;
+    bool active;
+
+public:
+
+    TraceSpan(uint8_t type, uint64_t bytes)
+        : type(type), bytes(bytes), start(0), active(TraceEnabled.load(std::memory_order_relaxed))
+    {
+        if (active)
+            start = TraceNow();
+    }
+
+    ~TraceSpan()
+    {
+        if (active && TraceEnabled.load(std::memory_order_relaxed))
+            TraceRecordAt(start, type, bytes, TraceNow() - start);
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+};
+
+#endif // !_TRACE_H_
@@ -0,0 +1,1067 @@
+// File Name: TransferSession.cpp
+// Date: 2026-10
+// File Description:
+//      -- Implements TransferSession: the paths with their flow control, the worker threads of parallel flows, and
+//      -- the frame loop that sends the streams' packets (or the receiver's replies), receives, and updates every path.
+
+#include "TransferSession.h"
+#include "Log.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <thread>
+
+//#define SHOW_ACKS
+
+using namespace std;
+using namespace net;
+
+
+
+// Class Name: FlowControl
+// Class Description:
+class FlowControl
+{
+public:
+
+    explicit FlowControl(uint64_t now)
+    {
+        LOG_INFO("flow control initialized");
+        Reset(now);
+    }
+
+    void Reset(uint64_t now)
+    {
+        mode = Bad;
+        penalty_time = 4.0f;
+        good_conditions_start = now;
+        penalty_reduction_start = now;
+        TraceState();
+    }
+
+    // Function Name: Update
+    // Function Description: Switches between good and bad mode from the rtt (ms) measured at time now (ns)
+    void Update(uint64_t now, float rtt)
+    {
+        const float RTT_Threshold = 250.0f;
+
+        if (mode == Good)
+        {
+            if (rtt > RTT_Threshold)
+            {
+                LOG_INFO("*** dropping to bad mode ***");
+                mode = Bad;
+                if (NsToSeconds(now - good_conditions_start) < 10.0 && penalty_time < 60.0f)
+                {
+                    penalty_time *= 2.0f;
+                    if (penalty_time > 60.0f)
+                        penalty_time = 60.0f;
+                    LOG_INFO("penalty time increased to %.1f", penalty_time);
+                }
+                good_conditions_start = now;
+                penalty_reduction_start = now;
+                TraceState();
+                return;
+            }
+
+            if (NsToSeconds(now - penalty_reduction_start) > 10.0 && penalty_time > 1.0f)
+            {
+                penalty_time /= 2.0f;
+                if (penalty_time < 1.0f)
+                    penalty_time = 1.0f;
+                LOG_INFO("penalty time reduced to %.1f", penalty_time);
+                penalty_reduction_start = now;
+                TraceState();
+            }
+        }
+
+        if (mode == Bad)
+        {
+            if (rtt > RTT_Threshold)
+                good_conditions_start = now;
+
+            if (NsToSeconds(now - good_conditions_start) > penalty_time)
+            {
+                LOG_INFO("*** upgrading to good mode ***");
+                good_conditions_start = now;
+                penalty_reduction_start = now;
+                mode = Good;
+                TraceState();
+                return;
+            }
+        }
+    }
+
+    float GetSendRate()
+    {
+        return mode == Good ? 30.0f : 10.0f;
+    }
+
+private:
+
+    // records the mode, penalty time and resulting send rate in the event trace
+    void TraceState()
+    {
+        TRACE_EVENT(TRACE_FLOW_MODE, mode == Good ? 1 : 0, (uint64_t)(penalty_time * 1000.0f));
+        TRACE_EVENT(TRACE_SEND_RATE, 0, (uint64_t)GetSendRate());
+    }
+
+    enum Mode
+    {
+        Good,
+        Bad
+    };
+
+    Mode mode;
+    float penalty_time;
+    uint64_t good_conditions_start;     // since when the rtt has been below the threshold
+    uint64_t penalty_reduction_start;   // last penalty change or mode switch
+};
+
+
+
+// Class Name: TransferPath
+// Class Description:
+//      -- One path of a transfer: its own socket on a local / remote address pair, its own ReliabilitySystem (RTT,
+//      -- loss) and flow control. Path 0 carries the MetaPackets and the receiver's replies; blocks and parity go out
+//      -- on whichever path is due next, so with several paths each one gets blocks in proportion to its capacity.
+class TransferPath
+{
+public:
+
+    TransferPath(int index, uint64_t now) : index(index), connection(ProtocolId, TimeOut), flowControl(now)
+    {
+    }
+
+    // Function Name: GetCapacity
+    // Function Description:
+    //      -- Packets per second to send on this path: rate (the flow control's, or a fixed one), scaled down by the
+    //      -- share of the bytes sent over the last second that were not acked (at most to a quarter, so a lossy
+    //      -- path keeps probing)
+    float GetCapacity(float rate)
+    {
+        const float sent = connection.GetReliabilitySystem().GetSentBandwidth();
+        const float acked = connection.GetReliabilitySystem().GetAckedBandwidth();
+        if (sent > 0.0f && acked < sent)
+            rate *= max(acked / sent, 0.25f);
+        return rate;
+    }
+
+    int index;
+    ReliableConnection connection;
+    FlowControl flowControl;
+    uint64_t nextSend = 0;  // when the next packet is due
+    bool connected = false;
+    bool down = false;      // a secondary path that failed to connect or timed out; no longer used
+    Address remote;         // where the sender connects this path to
+    unsigned int local = 0; // local address the path is bound to (0 = any)
+};
+
+
+
+// Class Name: ParallelFlow
+// Class Description:
+//      -- One extra flow of a parallel transfer: a worker thread driving its own ReliableConnection on the ports of
+//      -- path i, so every flow is a separate 5-tuple with its own flow control and per-flow rate budget. It sends
+//      -- its share of the file's blocks (and their parity) once the main flow's MetaPacket has been acked; the
+//      -- receiver reassembles all flows of the stream into one FileBlock. Only the worker touches the connection.
+class ParallelFlow
+{
+public:
+
+    ParallelFlow(int index, OutgoingStream& primary, uint64_t first, uint64_t end, bool busyPoll)
+        : path(index, MonotonicNs()), stream(primary, first, end), firstBlock(first), endBlock(end), busyPoll(busyPoll)
+    {
+    }
+
+    ~ParallelFlow()
+    {
+        Stop();
+    }
+
+    // Function Name: Start
+    // Function Description: Binds clientPort + 2i, starts connecting to serverPort + 2i of server and starts the worker; 0 on success, -1 on error (logged)
+    int Start(const Address& server, int serverPort, int clientPort)
+    {
+        const int port = clientPort + 2 * path.index;
+        if (!path.connection.Start(port))
+        {
+            LOG_ERROR("could not start connection on port %d", port);
+            return -1;
+        }
+        if (busyPoll)
+            path.connection.SetBusyPoll(BusyPollMicroseconds);
+        path.connection.Connect(Address(server.GetAddress(), (unsigned short)(serverPort + 2 * path.index)));
+        worker = thread(&ParallelFlow::Run, this);
+        return 0;
+    }
+
+    // Function Name: Begin
+    // Function Description: Lets the worker send its blocks (the receiver knows the file)
+    void Begin()
+    {
+        go = true;
+    }
+
+    // Function Name: HandBack
+    // Function Description: If the flow failed, queues its blocks on primary (once) and returns true
+    bool HandBack(OutgoingStream& primary)
+    {
+        if (!failed || handedBack)
+            return false;
+        LOG_WARN("flow %d failed, its blocks go to the main flow", path.index);
+        primary.TakeOver(firstBlock, endBlock);
+        handedBack = true;
+        return true;
+    }
+
+    // Function Name: Finished
+    // Function Description: True once every block of the flow has been sent, by the flow itself or handed back
+    bool Finished() const
+    {
+        return sent || handedBack;
+    }
+
+    // Function Name: SentBlocks
+    // Function Description: Blocks the worker has sent so far
+    uint64_t SentBlocks() const
+    {
+        return stream.sentBlocks;
+    }
+
+    // Function Name: Stop
+    // Function Description: Ends the worker and waits for it
+    void Stop()
+    {
+        stop = true;
+        if (worker.joinable())
+            worker.join();
+    }
+
+private:
+
+    // Function Name: Run
+    // Function Description: The worker: the connection and send part of the frame loop for this flow alone
+    void Run()
+    {
+        path.nextSend = MonotonicNs();
+        while (!stop)
+        {
+            const uint64_t now = MonotonicNs();
+
+            if (path.connection.IsConnected())
+                path.flowControl.Update(now, path.connection.GetReliabilitySystem().GetRoundTripTime() * 1000.0f);
+
+            if (!path.connected && path.connection.IsConnected())
+            {
+                LOG_INFO("flow %d connected", path.index);
+                path.connected = true;
+            }
+            if ((path.connected && !path.connection.IsConnected()) || (!path.connected && path.connection.ConnectFailed()))
+            {
+                if (!sent)
+                    failed = true;
+                break;
+            }
+
+            // blocks once the receiver knows the file and has answered on this flow, heartbeats until then
+            const uint64_t sendInterval = SecondsToNs(1.0f / path.flowControl.GetSendRate());
+            if (now > path.nextSend + sendInterval)
+                path.nextSend = now;
+            while (path.nextSend <= now)
+            {
+                unsigned char packet[PacketSize];
+                memset(packet, 0, sizeof(packet));
+                PacketSegment segments[3];
+                int segmentCount = 0;
+
+                const bool filled = go && path.connected && !stream.finished
+                    && stream.NextPacket(now, false, path.connection.GetReliabilitySystem().GetLocalSequence(), packet, segments, segmentCount);
+                if (stream.finished && !sent)
+                {
+                    ReliabilitySystem& reliability = path.connection.GetReliabilitySystem();
+                    LOG_INFO("flow %d: rtt %.1fms, sent %d, acked %d, lost %d", path.index, reliability.GetRoundTripTime() * 1000.0f,
+                        reliability.GetSentPackets(), reliability.GetAckedPackets(), reliability.GetLostPackets());
+                    sent = true;
+                }
+
+                if (segmentCount > 0)
+                    path.connection.SendPacket(segments, segmentCount, stream.id);
+                else
+                    path.connection.SendPacket(packet, sizeof(packet), filled ? stream.id : HeartbeatStream);
+                path.nextSend += sendInterval;
+            }
+
+            // nothing comes back on a flow but acks, which ReceivePacket processes
+            unsigned char packet[PacketSize];
+            uint16_t streamId = DefaultStream;
+            while (path.connection.ReceivePacket(packet, sizeof(packet), streamId) > 0)
+                ;
+
+            path.connection.Update();
+            if (!busyPoll)
+                net::wait(DeltaTime);
+        }
+    }
+
+    TransferPath path;
+    OutgoingStream stream;
+    const uint64_t firstBlock;
+    const uint64_t endBlock;
+    const bool busyPoll;            // spin like the session's frame loop instead of sleeping DeltaTime
+    thread worker;
+    atomic<bool> go{ false };
+    atomic<bool> stop{ false };
+    atomic<bool> sent{ false };     // set by the worker once its last packet is out
+    atomic<bool> failed{ false };   // set by the worker when the flow could not connect or timed out first
+    bool handedBack = false;        // session thread only
+};
+
+
+
+TransferSession::TransferSession(TransferRole role, const TransferOptions& options) : role(role), options(options)
+{
+}
+
+
+TransferSession::~TransferSession()
+{
+    Stop();
+}
+
+
+// Function Name: Start
+// Function Description: Binds the ports of every path, then connects to server (sender) or listens; 0 on success, -1 on error (logged)
+int TransferSession::Start(const Address& server)
+{
+    Stop();
+
+    // one ReliableConnection per path; a receiver listens on the ports of every flow as well
+    int pathCount = max(options.pathCount, (int)options.pathAddresses.size() + 1);
+    if (role == TransferReceiver)
+        pathCount = max(pathCount, options.flowCount); // flow i arrives on the port of path i
+    for (int i = 0; i < pathCount; ++i)
+    {
+        paths.emplace_back(new TransferPath(i, Now()));
+        TransferPath& path = *paths.back();
+        path.connection.SetClock(*clock);
+        path.remote = Address(server.GetAddress(), (unsigned short)(options.serverPort + 2 * i));
+        if (i > 0 && i <= (int)options.pathAddresses.size())
+        {
+            path.local = options.pathAddresses[i - 1].first;
+            if (options.pathAddresses[i - 1].second != 0)
+                path.remote = Address(options.pathAddresses[i - 1].second, path.remote.GetPort());
+        }
+
+        const int port = (role == TransferReceiver ? options.serverPort : options.clientPort) + 2 * i;
+        if (!path.connection.Start(port, path.local))
+        {
+            LOG_ERROR("could not start connection on port %d", port);
+            Stop();
+            return -1;
+        }
+    }
+
+    // batch the datagrams and the file reads / writes through one io_uring; fall back to plain system calls without it
+    if (options.ioUring)
+    {
+        bool ringUsed = ring.Open() == 0;
+        for (unique_ptr<TransferPath>& path : paths)
+            ringUsed = ringUsed && path->connection.UseIoRing(ring);
+        if (ringUsed)
+            LOG_INFO("**Socket and file I/O through io_uring");
+        else
+            LOG_WARN("io_uring is not available, using blocking socket and file I/O");
+    }
+
+    for (unique_ptr<TransferPath>& path : paths)
+        path->connection.SetAckFrequency(options.ackPackets, options.ackDelayMicroseconds);
+
+    // low latency: poll the device queue on every receive and never sleep
+    if (options.busyPoll)
+    {
+        bool busyPollSet = true;
+        for (unique_ptr<TransferPath>& path : paths)
+            busyPollSet = path->connection.SetBusyPoll(BusyPollMicroseconds) && busyPollSet;
+        LOG_INFO("**Busy-poll mode%s", busyPollSet ? "" : " (SO_BUSY_POLL unavailable, spinning only)");
+    }
+
+    for (unique_ptr<TransferPath>& path : paths)
+    {
+        if (role == TransferSender)
+            path->connection.Connect(path->remote); // Set the connection status to Connecting and store the destination server address
+        else
+            path->connection.Listen(); // Set the connection status to Listening
+        path->nextSend = Now();
+    }
+    if (paths.size() > 1)
+        LOG_INFO("**Multipath transfer over %d paths", (int)paths.size());
+
+    nextStats = Now() + SecondsToNs(StatsInterval);
+    connectFailed = false;
+    return 0;
+}
+
+
+// Function Name: Stop
+// Function Description: Closes the sockets and drops any unfinished transfer
+void TransferSession::Stop()
+{
+    flows.clear();
+    outgoing.clear();
+    incoming.clear();
+    currentGroup = -1;
+    for (unique_ptr<TransferPath>& path : paths)
+    {
+        if (path->connection.IsRunning())
+            path->connection.Stop();
+    }
+    paths.clear();
+}
+
+
+ReliableConnection& TransferSession::GetConnection()
+{
+    return paths[0]->connection;
+}
+
+
+// Function Name: SetClock
+// Function Description: Installs the clock on the session and on the connections of its paths, now and at the next Start
+void TransferSession::SetClock(const Clock& clock)
+{
+    this->clock = &clock;
+    for (unique_ptr<TransferPath>& path : paths)
+        path->connection.SetClock(clock);
+}
+
+
+// Function Name: WaitFrame
+// Function Description: The time between two frames of a transfer: the caller's frame wait, else a sleep of DeltaTime unless busy-polling
+void TransferSession::WaitFrame()
+{
+    if (frameWait)
+        frameWait();
+    else if (!options.busyPoll)
+        net::wait(DeltaTime);
+}
+
+
+// Function Name: Send
+// Function Description:
+//      -- Loads the files (one stream each, so the first datagram of each stream is its MetaPacket), starts the
+//      -- parallel flows, and runs frames until every packet is out. The streams of each Send are a new transfer
+//      -- group, so late packets of the last transfer are never taken for the new one.
+int TransferSession::Send(const vector<string>& fileNames)
+{
+    if (role != TransferSender || paths.empty())
+    {
+        LOG_ERROR("Send needs a started sender session");
+        return -1;
+    }
+    if (fileNames.empty() || (int)fileNames.size() > MaxStreams)
+    {
+        LOG_ERROR("Between 1 and %d files can be sent at once", MaxStreams);
+        return -1;
+    }
+
+    // the flows split the blocks of one file, which a delta only knows once the receiver's signatures are in
+    if (options.flowCount > 1 && (options.delta || fileNames.size() > 1 || paths.size() > 1))
+    {
+        LOG_ERROR("Parallel flows split a single file and cannot be combined with several files, paths or a delta");
+        return -1;
+    }
+
+    // a path that timed out or failed since the last transfer connects again on the socket it already has
+    const uint64_t start = Now();
+    for (unique_ptr<TransferPath>& path : paths)
+    {
+        path->connection.Update(); // notices a timeout that happened between the transfers
+        if (path->down || path->connection.ConnectFailed() || (path->connected && !path->connection.IsConnected()))
+        {
+            path->connection.Connect(path->remote);
+            path->flowControl.Reset(start);
+            path->connected = false;
+            path->down = false;
+        }
+    }
+    connectFailed = false;
+
+    streamBase = (uint16_t)(nextGroup * MaxStreams);
+    nextGroup = (nextGroup + 1) % MaxTransferGroups;
+    for (size_t i = 0; i < fileNames.size(); ++i)
+    {
+        outgoing.emplace_back(new OutgoingStream((uint16_t)(streamBase + i), fileNames[i].c_str()));
+        OutgoingStream& stream = *outgoing.back();
+        stream.resume = options.resume;
+        stream.zeroCopy = options.zeroCopy;
+
+        FileBlock& fileBlock = stream.fileBlock;
+        if (ring.IsOpen())
+            fileBlock.SetIoRing(&ring);
+        fileBlock.SetCompression(options.compress);
+        fileBlock.SetFec(options.fecScheme, options.fecGroupSize, options.fecParityCount);
+        fileBlock.SetResume(options.resume);
+        fileBlock.SetDelta(options.delta);
+        fileBlock.SetZeroCopy(options.zeroCopy);
+        fileBlock.SetStreamCount((uint16_t)fileNames.size());
+        fileBlock.SetFlowCount((uint8_t)options.flowCount);
+        if (fileBlock.LoadFile(fileNames[i].c_str()) != 0)
+        {
+            LOG_ERROR("Some error happen when loading file %s.", fileNames[i].c_str());
+            outgoing.clear();
+            return -1;
+        }
+    }
+
+    // the frame loop sends the first share of a split file, a worker thread per flow the others
+    if (options.flowCount > 1)
+    {
+        OutgoingStream& primary = *outgoing[0];
+        uint64_t first = 0, end = 0;
+        primary.fileBlock.GetFlowRange(0, first, end);
+        primary.SetRange(first, end);
+        for (int i = 1; i < options.flowCount; ++i)
+        {
+            primary.fileBlock.GetFlowRange(i, first, end);
+            if (first >= end)
+                break; // fewer blocks than flows
+            flows.emplace_back(new ParallelFlow(i, primary, first, end, options.busyPoll));
+            if (flows.back()->Start(paths[0]->remote, options.serverPort, options.clientPort) != 0)
+            {
+                flows.clear();
+                outgoing.clear();
+                return -1;
+            }
+        }
+        LOG_INFO("**Parallel transfer over %d flows", (int)flows.size() + 1);
+    }
+
+    reported.assign(outgoing.size(), false);
+    nextStream = 0;
+    sendStart = start;
+
+    int result = 0;
+    while (true)
+    {
+        const uint64_t now = Now();
+        Frame(now);
+        if (connectFailed || cancelled)
+        {
+            result = -1;
+            break;
+        }
+        if (CheckSent(now))
+            break;
+        WaitFrame();
+    }
+
+    cancelled = false;
+    flows.clear();
+    outgoing.clear();
+    reported.clear();
+    return result;
+}
+
+
+// Function Name: Receive
+// Function Description: Runs frames until every file of the current transfer (the first one to arrive) is saved or has failed
+int TransferSession::Receive()
+{
+    if (role != TransferReceiver || paths.empty())
+    {
+        LOG_ERROR("Receive needs a started receiver session");
+        return -1;
+    }
+
+    while (!CurrentTransferDone())
+    {
+        if (cancelled)
+        {
+            cancelled = false;
+            return -1;
+        }
+        Frame(Now());
+        WaitFrame();
+    }
+    return EndReceive();
+}
+
+
+// Function Name: Poll
+// Function Description: One frame between transfers, so the peer sees heartbeats and acks and no connection times out
+void TransferSession::Poll()
+{
+    if (!paths.empty())
+        Frame(Now());
+}
+
+
+// Function Name: Frame
+// Function Description: One iteration over every path: connection state, the packets due, the packets received, then the acks and updates
+void TransferSession::Frame(uint64_t now)
+{
+    for (unique_ptr<TransferPath>& pathPtr : paths)
+    {
+        TransferPath& path = *pathPtr;
+        if (path.down)
+            continue;
+
+        // Update flow control (adjust send rate based on RTT)
+        if (path.connection.IsConnected())
+            path.flowControl.Update(now, path.connection.GetReliabilitySystem().GetRoundTripTime() * 1000.0f);
+
+        // detect changes in connection state
+
+        if (role == TransferReceiver && path.connected && !path.connection.IsConnected())
+        {
+            path.flowControl.Reset(now);
+            LOG_INFO("reset flow control");
+            path.connected = false;
+        }
+
+        if (!path.connected && path.connection.IsConnected())
+        {
+            if (path.index == 0)
+                LOG_INFO("client connected to server");
+            else
+                LOG_INFO("path %d connected", path.index);
+            path.connected = true;
+        }
+
+        if (role == TransferSender && path.connected && !path.connection.IsConnected())
+        {
+            if (path.index == 0)
+            {
+                LOG_WARN("connection lost");
+                connectFailed = true;
+                break;
+            }
+            LOG_WARN("path %d timed out, its blocks go to the other paths", path.index);
+            path.down = true;
+            continue;
+        }
+
+        if (!path.connected && path.connection.ConnectFailed())
+        {
+            if (path.index == 0)
+            {
+                LOG_WARN("connection failed");
+                connectFailed = true;
+                break;
+            }
+            LOG_WARN("path %d failed to connect", path.index);
+            path.down = true;
+            continue;
+        }
+
+        SendPackets(path, now);
+
+        // Receive the Packet
+        while (true)
+        {
+            unsigned char packet[PacketSize];
+            uint16_t streamId = DefaultStream;
+            int bytes_read = path.connection.ReceivePacket(packet, sizeof(packet), streamId);
+            if (bytes_read == 0)
+                break;
+
+            // the sender only cares about the receiver's resume and signature replies
+            if (role == TransferSender && (packet[0] == TYPE_RESUME || packet[0] == TYPE_SIGNATURE))
+            {
+                // (late copies are dropped once the flows read the stream's file from their threads)
+                const size_t index = (size_t)(uint16_t)(streamId - streamBase);
+                if (index < outgoing.size() && !(flows.size() > 0 && outgoing[index]->Streaming()))
+                    outgoing[index]->fileBlock.ProcessReceivedPacket(packet, bytes_read);
+            }
+
+            if (role == TransferReceiver)
+                ReceivePacket(streamId, packet, bytes_read);
+        }
+    }
+
+    // the MetaPacket of a stream is delivered once any copy of it is acked (MetaPackets only use the primary path)
+    ReliableConnection& connection = paths[0]->connection;
+    if (role == TransferSender && !outgoing.empty())
+    {
+        unsigned int* acks = NULL;
+        int ack_count = 0;
+        connection.GetReliabilitySystem().GetAcks(&acks, ack_count);
+        for (const unique_ptr<OutgoingStream>& stream : outgoing)
+            stream->ProcessAcks(acks, ack_count, now);
+
+        // the other flows start once the receiver knows the file; the main flow sends the blocks of one that failed
+        for (unique_ptr<ParallelFlow>& flow : flows)
+        {
+            if (outgoing[0]->Streaming())
+                flow->Begin();
+            flow->HandBack(*outgoing[0]);
+        }
+    }
+
+    // show packets that were acked this frame
+
+#ifdef SHOW_ACKS
+    unsigned int* acks = NULL;
+    int ack_count = 0;
+    connection.GetReliabilitySystem().GetAcks(&acks, ack_count);
+    if (ack_count > 0)
+    {
+        string line = "acks: " + to_string(acks[0]);
+        for (int i = 1; i < ack_count; ++i)
+            line += "," + to_string(acks[i]);
+        LOG_DEBUG("%s", line.c_str());
+    }
+#endif
+
+    // Update connection status (timeout detection, statistics)
+    for (unique_ptr<TransferPath>& path : paths)
+        path->connection.Update();
+
+    if (now >= nextStats && connection.IsConnected())
+        ReportStats(now);
+}
+
+
+// Function Name: SendPackets
+// Function Description:
+//      -- Sends the packets due on path at its send rate. The sender's streams take turns for the ticks; the
+//      -- receiver answers resumable or delta MetaPackets on the primary path. A sender tick without a packet is a
+//      -- heartbeat on HeartbeatStream, a receiver tick without a reply at most an ack-only datagram.
+void TransferSession::SendPackets(TransferPath& path, uint64_t now)
+{
+    // one path sends at its flow control rate (or the fixed rate of the options); several share the blocks by their measured capacity
+    const float pathRate = options.sendRate > 0.0f ? options.sendRate : path.flowControl.GetSendRate();
+    const float sendRate = paths.size() > 1 ? path.GetCapacity(pathRate) : pathRate;
+
+    // after a stall, carry on at the send rate instead of sending the missed packets in a burst
+    const uint64_t sendInterval = SecondsToNs(1.0f / sendRate);
+    if (now > path.nextSend + sendInterval)
+        path.nextSend = now;
+    while (path.nextSend <= now)
+    {
+        unsigned char packet[PacketSize];
+        memset(packet, 0, sizeof(packet)); // Clear the buffer
+
+        PacketSegment segments[3];
+        int segmentCount = 0;
+        uint16_t streamId = HeartbeatStream;
+        bool ackOnly = false;
+
+        // secondary paths carry blocks once the receiver has answered on them, so none are sent into a port nobody listens on
+        if (role == TransferSender && (path.index == 0 || path.connected))
+        {
+            // the streams share the send rate: each tick goes to the next stream that has something to send
+            for (size_t k = 0; k < outgoing.size(); ++k)
+            {
+                const size_t index = (nextStream + k) % outgoing.size();
+                OutgoingStream& stream = *outgoing[index];
+                if (stream.finished)
+                    continue;
+                const uint64_t resent = stream.resentPackets;
+                if (stream.NextPacket(now, path.index == 0, path.connection.GetReliabilitySystem().GetLocalSequence(), packet, segments, segmentCount))
+                {
+                    streamId = stream.id;
+                    nextStream = index + 1;
+                    if (stream.resentPackets != resent)
+                        path.connection.GetMetrics()->retransmits.Add();
+
+                    // here is temprory MD5 hard code test
+                    if (options.md5Test && packet[0] == TYPE_DATA)
+                    {
+                        packet[10] = 18; // 'R'
+                        packet[11] = 10; // 'J'
+                    }
+                    break;
+                }
+            }
+        }
+        else if (role == TransferReceiver)
+        {
+            // answer a resumable or delta MetaPacket with the block ranges / signatures of what is already here
+            ackOnly = true;
+            map<uint16_t, unique_ptr<IncomingStream>>::iterator itor = incoming.lower_bound(nextReply);
+            for (size_t k = 0; path.index == 0 && k < incoming.size(); ++k, ++itor)
+            {
+                if (itor == incoming.end())
+                    itor = incoming.begin();
+                if (itor->second->fileBlock.NextReplyPacket(packet))
+                {
+                    streamId = itor->first;
+                    nextReply = (uint16_t)(itor->first + 1);
+                    ackOnly = false;
+                    break;
+                }
+            }
+        }
+
+        if (ackOnly)
+        {
+            // the receiver has nothing to say but acks: a 12-byte ack-only datagram instead of a zero packet, sent
+            // on the tick only if the ack frequency is off, or to keep the connection alive while nothing arrives
+            const bool ackFrequency = options.ackPackets > 0 || options.ackDelayMicroseconds > 0;
+            if ((!ackFrequency && path.connection.GetUnackedPackets() > 0) || now - path.connection.GetLastSendTime() >= SecondsToNs(AckKeepAlive))
+                path.connection.SendAck();
+        }
+        else if (segmentCount > 0)
+            path.connection.SendPacket(segments, segmentCount, streamId);
+        else
+            path.connection.SendPacket(packet, sizeof(packet), streamId);
+        path.nextSend += sendInterval;
+    }
+}
+
+
+// Function Name: ReceivePacket
+// Function Description:
+//      -- Receiver side: a stream opens with its MetaPacket (anything else on an unknown stream, such as the
+//      -- heartbeats on HeartbeatStream, is ignored); the packet goes into the stream's FileBlock, which is verified
+//      -- and saved once complete.
+void TransferSession::ReceivePacket(uint16_t streamId, const unsigned char* packet, int size)
+{
+    map<uint16_t, unique_ptr<IncomingStream>>::iterator itor = incoming.find(streamId);
+    if (itor == incoming.end())
+    {
+        if (packet[0] != TYPE_META)
+            return;
+        if ((int)incoming.size() >= MaxStreams)
+        {
+            LOG_LIMITED(LOG_LEVEL_WARN, 10, "Too many streams, stream %d ignored", streamId);
+            return;
+        }
+        // a late copy of the MetaPacket of a file that was just received would open it again
+        map<uint16_t, MetaPacket>::iterator finished = retired.find(streamId);
+        if (finished != retired.end() && Now() < retiredUntil)
+        {
+            MetaPacket meta;
+            MetaPacketLayout::Decode(meta, packet);
+            if (meta.fileSize == finished->second.fileSize && memcmp(meta.md5, finished->second.md5, MD5_HASH_LENGTH) == 0)
+                return;
+        }
+        itor = incoming.emplace(streamId, unique_ptr<IncomingStream>(new IncomingStream())).first;
+        if (ring.IsOpen())
+            itor->second->fileBlock.SetIoRing(&ring);
+        itor->second->fileBlock.SetOutputDirectory(options.outputDirectory);
+        if (currentGroup < 0)
+            currentGroup = streamId / MaxStreams;
+    }
+    IncomingStream& stream = *itor->second;
+    FileBlock& fileBlock = stream.fileBlock;
+
+    if (fileBlock.FinishedReceivedAllData() != 0)
+    {
+        if (!stream.timingStarted)
+        {
+            stream.startTime = Now();
+            stream.timingStarted = true;
+            LOG_INFO("Timing started: first packet of stream %d received.", streamId);
+        }
+
+        LOG_TRACE("----------------------------------------------------------------");
+        LOG_TRACE("Receiving data...");
+        int ret = fileBlock.ProcessReceivedPacket(packet, size);
+        if (ret != 0)
+        {
+            LOG_TRACE("Processed non-meta/block packet.");
+        }
+        LOG_TRACE("----------------------------------------------------------------");
+    }
+
+    if (fileBlock.FinishedReceivedAllData() == 0 && !stream.saved && !stream.failed)
+    {
+        // Record the end time and calculate the transmission time
+        double timeSec = NsToSeconds(Now() - stream.startTime);
+
+        // Calculate transfer rate: file size (bytes) * 8 / (time seconds * 1e6) = Mbps
+        double speedMbps = (fileBlock.GetMetaPacket().fileSize * 8) / (timeSec * 1e6);
+
+        LOG_INFO("*****************************************************************");
+        LOG_INFO("All data received: %s", fileBlock.GetMetaPacket().filename);
+        LOG_INFO("Transfer time: %.3f seconds, speed: %.3f Mbps", timeSec, speedMbps);
+        LOG_INFO("Calculating the validation...");
+
+        // Save the data into the file
+        if (fileBlock.VerifyFileContent() && fileBlock.SaveFile() == 0)
+            stream.saved = true;
+        else
+            stream.failed = true;
+
+        if (completionCallback)
+        {
+            TransferResult result;
+            result.fileName = fileBlock.GetMetaPacket().filename;
+            result.stream = streamId;
+            result.fileSize = fileBlock.GetMetaPacket().fileSize;
+            result.seconds = timeSec;
+            result.status = stream.saved ? 0 : -1;
+            result.blocksRecovered = fileBlock.GetRecoveredBlocks();
+            completionCallback(result);
+        }
+    }
+}
+
+
+// Function Name: ReportStats
+// Function Description: Logs the statistics of every connected path, reports the progress and checkpoints resumable receives
+void TransferSession::ReportStats(uint64_t now)
+{
+    TransferProgress progress;
+    for (unique_ptr<TransferPath>& path : paths)
+    {
+        if (!path->connection.IsConnected())
+            continue;
+
+        ReliabilitySystem& reliability = path->connection.GetReliabilitySystem();
+        float rtt = reliability.GetRoundTripTime();
+
+        unsigned int sent_packets = reliability.GetSentPackets();
+        unsigned int acked_packets = reliability.GetAckedPackets();
+        unsigned int lost_packets = reliability.GetLostPackets();
+
+        float sent_bandwidth = reliability.GetSentBandwidth();
+        float acked_bandwidth = reliability.GetAckedBandwidth();
+
+        char name[16] = "";
+        if (paths.size() > 1)
+            snprintf(name, sizeof(name), "path %d: ", path->index);
+
+        // datagrams the kernel dropped at this end were not lost on the network
+        LOG_INFO("%srtt %.1fms, sent %d, acked %d, lost %d (%.1f%%), sent bandwidth = %.1fkbps, acked bandwidth = %.1fkbps, kernel drops %u, buffers %d/%d KB",
+            name, rtt * 1000.0f, sent_packets, acked_packets, lost_packets,
+            sent_packets > 0.0f ? (float)lost_packets / (float)sent_packets * 100.0f : 0.0f,
+            sent_bandwidth, acked_bandwidth, path->connection.GetKernelDrops(),
+            path->connection.GetReceiveBufferSize() / 1024, path->connection.GetSendBufferSize() / 1024);
+
+        if (path->index == 0)
+            progress.rtt = rtt;
+        progress.sentBandwidth += sent_bandwidth;
+        progress.ackedBandwidth += acked_bandwidth;
+    }
+
+    nextStats = now + SecondsToNs(StatsInterval);
+
+    // persist the receive progress of a resumable transfer
+    for (map<uint16_t, unique_ptr<IncomingStream>>::value_type& stream : incoming)
+        stream.second->fileBlock.Checkpoint();
+
+    if (!progressCallback)
+        return;
+
+    if (role == TransferSender && !outgoing.empty())
+    {
+        for (size_t i = 0; i < outgoing.size(); ++i)
+        {
+            const uint64_t total = outgoing[i]->fileBlock.GetMetaPacket().totalBlocks;
+            uint64_t sent = outgoing[i]->sentBlocks;
+            if (i == 0)
+            {
+                for (unique_ptr<ParallelFlow>& flow : flows)
+                    sent += flow->SentBlocks();
+            }
+            progress.files++;
+            progress.filesDone += reported[i] ? 1 : 0;
+            progress.blocks += total;
+            progress.blocksDone += min(sent, total); // blocks sent again after a lost MetaPacket count once
+        }
+        progressCallback(progress);
+    }
+    else if (role == TransferReceiver && currentGroup >= 0)
+    {
+        size_t expected = 1;
+        for (map<uint16_t, unique_ptr<IncomingStream>>::value_type& stream : incoming)
+        {
+            if (stream.first / MaxStreams != currentGroup)
+                continue;
+            FileBlock& fileBlock = stream.second->fileBlock;
+            expected = max(expected, (size_t)fileBlock.GetMetaPacket().streamCount);
+            progress.files++;
+            progress.filesDone += stream.second->saved || stream.second->failed ? 1 : 0;
+            progress.blocks += fileBlock.GetMetaPacket().totalBlocks;
+            progress.blocksDone += fileBlock.GetReceivedBlocks();
+        }
+        progress.files = max(progress.files, expected);
+        progressCallback(progress);
+    }
+}
+
+
+// Function Name: CheckSent
+// Function Description: Reports each stream once it has sent its last packet (a split file: once every flow has too); true once all have
+bool TransferSession::CheckSent(uint64_t now)
+{
+    bool finished = true;
+    for (size_t i = 0; i < outgoing.size(); ++i)
+    {
+        OutgoingStream& stream = *outgoing[i];
+        bool sent = stream.finished;
+        if (i == 0)
+        {
+            for (const unique_ptr<ParallelFlow>& flow : flows)
+                sent = sent && flow->Finished();
+        }
+        finished = finished && sent;
+
+        if (sent && !reported[i])
+        {
+            reported[i] = true;
+            if (completionCallback)
+            {
+                TransferResult result;
+                result.fileName = stream.fileName;
+                result.stream = stream.id;
+                result.fileSize = stream.fileBlock.GetMetaPacket().fileSize;
+                result.seconds = NsToSeconds(now - sendStart);
+                result.status = 0;
+                completionCallback(result);
+            }
+        }
+    }
+    return finished;
+}
+
+
+// Function Name: CurrentTransferDone
+// Function Description: True once as many files of the current transfer as its MetaPackets announced are saved or have failed
+bool TransferSession::CurrentTransferDone() const
+{
+    if (currentGroup < 0)
+        return false;
+
+    size_t expected = 1;
+    size_t done = 0;
+    for (const map<uint16_t, unique_ptr<IncomingStream>>::value_type& stream : incoming)
+    {
+        if (stream.first / MaxStreams != currentGroup)
+            continue;
+        expected = max(expected, (size_t)stream.second->fileBlock.GetMetaPacket().streamCount);
+        if (stream.second->saved || stream.second->failed)
+            done++;
+    }
+    return done >= expected;
+}
+
+
+// Function Name: EndReceive
+// Function Description:
+//      -- Drops the files of the current transfer (remembering their MetaPackets for a while, to ignore late copies)
+//      -- and makes the next transfer that has already started current; 0 if every file was saved, else -1
+int TransferSession::EndReceive()
+{
+    int result = 0;
+    retired.clear();
+    for (map<uint16_t, unique_ptr<IncomingStream>>::iterator itor = incoming.begin(); itor != incoming.end(); )
+    {
+        if (itor->first / MaxStreams != currentGroup)
+        {
+            ++itor;
+            continue;
+        }
+        if (!itor->second->saved)
+            result = -1;
+        retired[itor->first] = itor->second->fileBlock.GetMetaPacket();
+        itor = incoming.erase(itor);
+    }
+    retiredUntil = Now() + SecondsToNs(ReplyTimeOut);
+    currentGroup = incoming.empty() ? -1 : incoming.begin()->first / MaxStreams;
+    return result;
+}
@@ -0,0 +1,242 @@
+// File Name: TransferSession.h
+// Date: 2026-10
+// File Description:
+//      -- The sender and receiver of the ReliableUDP tool as an embeddable class. A session binds its sockets once
+//      -- and then runs any number of transfers over them, so a long-lived process keeps its connections (and their
+//      -- RTT, flow control and socket buffers) warm between files instead of starting the tool for each one.
+
+#ifndef _TRANSFER_SESSION_H_
+#define _TRANSFER_SESSION_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Net.h"
+#include "FileProcess.h"
+#include "TransferStream.h"
+
+const int ServerPort = 30000;
+const int ClientPort = 30001;
+const int ProtocolId = 0x11223344;
+const float DeltaTime = 1.0f / 30.0f; // sleep between two frames of a transfer
+const float StatsInterval = 0.25f;
+const float TimeOut = 10.0f;
+const int PacketSize = 256;
+const int MaxStreams = 64; // files transferred side by side on one connection
+const int MaxPaths = 8; // sub-paths of a multipath transfer; path i uses serverPort + 2i / clientPort + 2i
+const int MaxFlows = MaxPaths; // parallel flows of one file; flow i uses the ports of path i
+const int BusyPollMicroseconds = 50; // SO_BUSY_POLL budget per receive in busy-poll mode
+const int MaxTransferGroups = 0xFFFF / MaxStreams; // transfer i sends its files on streams i * MaxStreams + k
+const int AckEveryPackets = 2; // received packets an ack-only datagram is sent after, unless this end sent something first
+const int AckDelayMicroseconds = 20000; // longest a received packet waits for its ack
+const int MaxAckEveryPackets = 32; // an ack covers its sequence and the 32 before it, so a longer run could leave packets unacked
+const int MaxAckDelayMicroseconds = 1000000; // an ack held longer than the one-second keep-alive is of no use
+
+
+enum TransferRole
+{
+    TransferSender,     // connects to the receiver and sends files
+    TransferReceiver    // listens and saves the files it is sent
+};
+
+
+// Struct Name: TransferOptions
+// Struct Description: Settings of a session; the file settings of the sender are announced in each MetaPacket
+struct TransferOptions
+{
+    int serverPort = ServerPort;    // receiver: first port it listens on; sender: first port it connects to
+    int clientPort = ClientPort;    // sender: first port it binds
+    bool compress = false;
+    uint8_t fecScheme = FEC_NONE;
+    uint8_t fecGroupSize = 0;
+    uint8_t fecParityCount = 0;
+    bool resume = false;
+    bool delta = false;
+    bool zeroCopy = false;
+    bool md5Test = false;           // sender: corrupts every data block so the receiver's MD5 check has to fail
+    int pathCount = 1;              // paths of a multipath transfer (receiver: ports to listen on)
+    std::vector<std::pair<unsigned int, unsigned int>> pathAddresses; // sender: local and remote IPv4 of paths 1.. (0 = any / the server)
+    int flowCount = 1;              // parallel flows a single file is split across (receiver: ports to listen on)
+    bool ioUring = false;           // socket and file I/O through an io_uring (Linux)
+    bool busyPoll = false;          // spin on the sockets instead of sleeping DeltaTime between frames
+    int ackPackets = AckEveryPackets;               // ack frequency (ReliableConnection::SetAckFrequency); 0 and 0: the receiver acks once per send tick
+    int ackDelayMicroseconds = AckDelayMicroseconds;
+    float sendRate = 0.0f;          // packets per second per path (parallel flows excluded); 0: the flow control's 10 or 30
+    std::string outputDirectory;    // receiver: where files are saved (empty: the path the sender announced)
+};
+
+
+// Struct Name: TransferProgress
+// Struct Description: State of the running transfer, reported every StatsInterval
+struct TransferProgress
+{
+    size_t files = 0;           // files of the transfer (receiver: announced so far)
+    size_t filesDone = 0;       // sent, or saved / failed
+    uint64_t blocks = 0;        // blocks of those files
+    uint64_t blocksDone = 0;    // blocks sent, or received and rebuilt
+    float rtt = 0.0f;           // seconds, primary path
+    float sentBandwidth = 0.0f; // kbps, all paths
+    float ackedBandwidth = 0.0f;
+};
+
+
+// Struct Name: TransferResult
+// Struct Description: End of one file: the sender has sent its last packet, or the receiver has verified (and saved) it
+struct TransferResult
+{
+    std::string fileName;
+    uint16_t stream = net::DefaultStream;
+    uint64_t fileSize = 0;
+    double seconds = 0.0;   // since the transfer started (receiver: since the file's first packet)
+    int status = 0;         // 0 = done, -1 = checksum mismatch or not saved
+    uint64_t blocksRecovered = 0;   // receiver: blocks rebuilt from FEC parity
+};
+
+
+class TransferPath;
+class ParallelFlow;
+
+// Class Name: TransferSession
+// Class Description:
+//      -- One end of a connection (plus its extra paths) and the transfers over it. Start binds and connects or
+//      -- listens; each Send / Receive then runs one transfer on the calling thread until it is over, reporting
+//      -- through the callbacks. Between transfers Poll keeps the connections alive; a sender whose connection
+//      -- timed out meanwhile connects again on its next Send. InitializeSockets must have been called.
+class TransferSession
+{
+public:
+
+    TransferSession(TransferRole role, const TransferOptions& options = TransferOptions());
+    ~TransferSession();
+
+    TransferSession(const TransferSession&) = delete;
+    TransferSession& operator=(const TransferSession&) = delete;
+
+    // Function Name: Start
+    // Function Description: Binds the ports of every path, then connects to server (sender) or listens; 0 on success, -1 on error (logged)
+    int Start(const net::Address& server = net::Address());
+
+    // Function Name: Stop
+    // Function Description: Closes the sockets (also done by the destructor)
+    void Stop();
+
+    // Function Name: Send
+    // Function Description: Sends the files side by side, one stream each; 0 once every packet is out, -1 if a file cannot be loaded or the connection fails
+    int Send(const std::vector<std::string>& fileNames);
+
+    // Function Name: Receive
+    // Function Description: Receives the next transfer; 0 once all of its files are verified and saved, -1 if one of them is not
+    int Receive();
+
+    // Function Name: Poll
+    // Function Description: One frame without a transfer of its own: heartbeats, replies, acks and timeouts (receiver: also starts on the next transfer)
+    void Poll();
+
+    // Function Name: Cancel
+    // Function Description: Makes the running Send / Receive return -1 after its current frame; may be called from any thread
+    void Cancel()
+    {
+        cancelled = true;
+    }
+
+    void SetProgressCallback(std::function<void(const TransferProgress&)> callback)
+    {
+        progressCallback = std::move(callback);
+    }
+
+    void SetCompletionCallback(std::function<void(const TransferResult&)> callback)
+    {
+        completionCallback = std::move(callback);
+    }
+
+    // Function Name: SetClock
+    // Function Description: Time source of the session and its connections, e.g. a net::ManualClock for simulated runs; must outlive the session (parallel flows keep the system clock)
+    void SetClock(const net::Clock& clock);
+
+    // Function Name: SetFrameWait
+    // Function Description: Called between two frames of Send / Receive instead of sleeping DeltaTime, e.g. to advance a simulated clock and run the peer
+    void SetFrameWait(std::function<void()> wait)
+    {
+        frameWait = std::move(wait);
+    }
+
+    // Function Name: GetOptions
+    // Function Description: The file settings (compression, FEC, resume, delta, ...) may change between transfers, the paths and ports may not
+    TransferOptions& GetOptions()
+    {
+        return options;
+    }
+
+    // Function Name: GetConnection
+    // Function Description: Connection of the primary path (valid after Start)
+    net::ReliableConnection& GetConnection();
+
+private:
+
+    // one iteration of the transfer loop over every path at time now
+    void Frame(uint64_t now);
+
+    // sends what is due on path: the next block of a stream (sender) or a reply (receiver), else a heartbeat
+    void SendPackets(TransferPath& path, uint64_t now);
+
+    // takes a received packet of the receiver's stream streamId into its FileBlock and finishes the file once complete
+    void ReceivePacket(uint16_t streamId, const unsigned char* packet, int size);
+
+    // logs the statistics of every path, reports progress and checkpoints resumable receives
+    void ReportStats(uint64_t now);
+
+    // sender: reports the streams that have sent their last packet; true once all have
+    bool CheckSent(uint64_t now);
+
+    // receiver: true once every file of the current transfer is saved or failed
+    bool CurrentTransferDone() const;
+
+    // receiver: forgets the finished files of the current transfer, moves on to the next one; returns 0 or -1
+    int EndReceive();
+
+    // time of the session's clock
+    uint64_t Now() const
+    {
+        return clock->Now();
+    }
+
+    // between two frames of Send / Receive: the frame wait, else DeltaTime's sleep (none in busy-poll mode)
+    void WaitFrame();
+
+    TransferRole role;
+    TransferOptions options;
+    IoRing ring;    // declared before the paths so it outlives their sockets
+    std::vector<std::unique_ptr<TransferPath>> paths;
+    uint64_t nextStats = 0;
+    std::atomic<bool> cancelled{ false };
+    bool connectFailed = false;
+    const net::Clock* clock = &net::Clock::System();
+
+    std::function<void(const TransferProgress&)> progressCallback;
+    std::function<void(const TransferResult&)> completionCallback;
+    std::function<void()> frameWait;
+
+    // sender: the files of the running transfer, on the streams from streamBase on
+    std::vector<std::unique_ptr<OutgoingStream>> outgoing;
+    std::vector<std::unique_ptr<ParallelFlow>> flows;
+    std::vector<bool> reported;     // completion reported, per outgoing stream
+    size_t nextStream = 0;          // stream that gets the next send tick
+    uint16_t streamBase = 0;
+    int nextGroup = 0;              // transfer group of the next Send
+    uint64_t sendStart = 0;
+
+    // receiver: the streams the sender has opened, by stream id; the current transfer is the group of the first one
+    std::map<uint16_t, std::unique_ptr<IncomingStream>> incoming;
+    int currentGroup = -1;
+    std::map<uint16_t, MetaPacket> retired; // files of the last finished transfer; late copies of their MetaPackets are ignored
+    uint64_t retiredUntil = 0;
+    uint16_t nextReply = 0;         // stream whose reply packets go out next
+};
+
+#endif // !_TRANSFER_SESSION_H_
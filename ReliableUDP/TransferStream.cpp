@@ -0,0 +1,233 @@
+// File Name: TransferStream.cpp
+// Date: 2026-10
+// File Description:
+//      -- Implements the send side of a file stream: MetaPacket (0-RTT with an initial window), resume and delta
+//      -- negotiation, blocks and FEC parity in order, and the block ranges of parallel flows.
+
+#include "TransferStream.h"
+#include "Log.h"
+
+using namespace std;
+using namespace net;
+
+
+
+// Function Name: OutgoingStream
+// Function Description: A stream of its own file, loaded later through fileBlock
+OutgoingStream::OutgoingStream(uint16_t id, const char* fileName) : id(id), fileName(fileName), ownedFile(new FileBlock()), fileBlock(*ownedFile)
+{
+}
+
+
+// Function Name: OutgoingStream
+// Function Description:
+//      -- A parallel flow of primary: sends the blocks [first, end) of the same loaded file and their parity, but no
+//      -- MetaPacket; only started once primary is Streaming
+OutgoingStream::OutgoingStream(OutgoingStream& primary, uint64_t first, uint64_t end)
+    : id(primary.id), fileName(primary.fileName), fileBlock(primary.fileBlock), zeroCopy(primary.zeroCopy), metaSent(true), metaConfirmed(true)
+{
+    SetRange(first, end);
+}
+
+
+// Function Name: SetRange
+// Function Description: Restricts the stream to the blocks [first, end) and the parity of their FEC groups (first starts a group)
+void OutgoingStream::SetRange(uint64_t first, uint64_t end)
+{
+    const MetaPacket& meta = fileBlock.GetMetaPacket();
+    firstBlock = first;
+    endBlock = end;
+    n = (int)first;
+    parityNext = meta.fecScheme != FEC_NONE ? (size_t)(first / meta.fecGroupSize * meta.fecParityCount) : 0;
+    parityEnd = parityNext;
+}
+
+
+// Function Name: TakeOver
+// Function Description: Queues the blocks [first, end) of a flow that failed, sent after the stream's own range
+void OutgoingStream::TakeOver(uint64_t first, uint64_t end)
+{
+    ranges.push_back(make_pair(first, end));
+    finished = false;
+}
+
+
+// Function Name: Streaming
+// Function Description: True once the receiver knows the file and any resume negotiation is over, so other flows may send its blocks
+bool OutgoingStream::Streaming() const
+{
+    return metaConfirmed && (!resume || resumeGaveUp || fileBlock.ResumeNegotiated());
+}
+
+
+// Function Name: NextPacket
+// Function Description:
+//      -- Fills in the next packet of the stream (meta, parity or block; a zero-copy block as header, payload and
+//      -- padding segments) and returns true, or returns false if the stream has nothing to send at time now.
+//      -- sequence is the reliable sequence the packet will be sent with; MetaPackets are only sent on the
+//      -- primary path (whose acks ProcessAcks sees), other paths get nothing until the stream's next block.
+bool OutgoingStream::NextPacket(uint64_t now, bool primary, unsigned int sequence, unsigned char* packet, PacketSegment* segments, int& segmentCount)
+{
+    static const unsigned char padding[PAYLOAD_SIZE] = { 0 };
+
+    if (metaRewind)
+    {
+        LOG_INFO("First MetaPacket of %s was lost, sending the initial blocks again.", fileName);
+        SetRange(firstBlock, endBlock);
+        metaRewind = false;
+    }
+
+    const MetaPacket& meta = fileBlock.GetMetaPacket();
+
+    // send the meta packet first if haven't send the meta packet yet
+    if (!metaSent)
+    {
+        if (!primary)
+            return false;
+        LOG_INFO("Sending %s, %llu bytes, %llu total slices.",
+            meta.filename,
+            (unsigned long long)meta.fileSize, // here using long long, bcoz we were using uint_64
+            (unsigned long long)meta.totalBlocks);
+
+        // Encode the MetaPacket (fixed 256 bytes) into a packet and send it out later
+        MetaPacketLayout::Encode(meta, packet);
+        metaSent = true;
+        if (!metaConfirmed)
+        {
+            metaSequences.push_back(sequence);
+            metaSentAt = now;
+        }
+        return true;
+    }
+
+    if (fileBlock.DeltaPending())
+    {
+        // wait while the receiver streams the signatures of its copy, then send the delta instead of the file;
+        // only give up once they stop arriving
+        if (lastSignature == 0 || fileBlock.SignatureCount() != signaturesSeen)
+        {
+            signaturesSeen = fileBlock.SignatureCount();
+            lastSignature = now;
+        }
+        if (fileBlock.SignaturesComplete() || NsToSeconds(now - lastSignature) >= ReplyTimeOut)
+        {
+            if (!fileBlock.SignaturesComplete())
+                LOG_INFO("Signatures incomplete (%zu received), unmatched data is sent as literals.", signaturesSeen);
+            fileBlock.BuildDelta();
+            metaSent = false; // announce the size of the delta stream
+        }
+        return false;
+    }
+
+    if (resume && !fileBlock.ResumeNegotiated() && !resumeGaveUp)
+    {
+        // wait while the receiver reports which blocks it already has
+        if (resumeStart == 0)
+            resumeStart = now;
+        if (NsToSeconds(now - resumeStart) >= ReplyTimeOut)
+        {
+            LOG_INFO("No resume reply from receiver, sending the whole file.");
+            resumeGaveUp = true;
+        }
+        return false;
+    }
+
+    if (parityNext < parityEnd) // send the parity of the group that was just completed
+    {
+        ParityPacketLayout::Encode(fileBlock.GetParityPackets()[parityNext], packet);
+        if (parityNext < parityDone)
+            resentPackets++;
+        parityNext++;
+        parityDone = max(parityDone, parityNext);
+        return true;
+    }
+
+    if (!metaConfirmed && (uint64_t)n >= min((uint64_t)InitialWindow, meta.totalBlocks))
+    {
+        // the initial window is out: hold the remaining blocks (and the end of the transfer) until the
+        // MetaPacket is acked, and announce it again in case it was lost; the receiver ignores repeats
+        if (!primary || NsToSeconds(now - metaSentAt) < MetaRepeatInterval)
+            return false;
+        LOG_DEBUG("MetaPacket of %s not acked yet, sending it again.", fileName);
+        MetaPacketLayout::Encode(meta, packet);
+        resentPackets++;
+        metaSequences.push_back(sequence);
+        metaSentAt = now;
+        return true;
+    }
+
+    // skip blocks the receiver already has; the last block is always sent so it can finish
+    const uint64_t end = min(endBlock, meta.totalBlocks);
+    while (n + 1 < (int)meta.totalBlocks && (uint64_t)n < end && fileBlock.PeerHasBlock(n))
+        n++;
+
+    if ((uint64_t)n >= end)
+    {
+        if (!ranges.empty())
+        {
+            LOG_INFO("Sending blocks %llu-%llu of %s for a failed flow.", (unsigned long long)ranges.front().first, (unsigned long long)ranges.front().second, fileName);
+            SetRange(ranges.front().first, ranges.front().second);
+            ranges.erase(ranges.begin());
+            return false;
+        }
+
+        // tell the user that all file content sent
+        if (firstBlock == 0 && end == meta.totalBlocks)
+            LOG_INFO("Finish Sent file: %s", fileName);
+        else
+            LOG_INFO("Finish Sent blocks %llu-%llu of %s", (unsigned long long)firstBlock, (unsigned long long)end, fileName);
+        finished = true;
+        return false;
+    }
+
+    LOG_TRACE("Sending %s %d/%llu...", fileName, n + 1, (unsigned long long)meta.totalBlocks);
+
+    if (zeroCopy)
+    {
+        BlockPacket header;
+        header.packetType = TYPE_DATA;
+        header.localSequence = n;
+        BlockHeaderLayout::Encode(header, packet);
+
+        const uint8_t* payload = nullptr;
+        const int payloadSize = (int)fileBlock.GetBlockPayload(n, payload);
+        segments[0] = { packet, (int)BlockHeaderLayout::size };
+        segments[1] = { payload, payloadSize };
+        segments[2] = { padding, (int)PAYLOAD_SIZE - payloadSize };
+        segmentCount = payloadSize < (int)PAYLOAD_SIZE ? 3 : 2;
+    }
+    else
+        BlockPacketLayout::Encode(fileBlock.GetBlocks()[n], packet);
+    if (n < blocksEnd)
+        resentPackets++;
+    n++;
+    blocksEnd = max(blocksEnd, n);
+    sentBlocks++;
+
+    // release the parity packets of every group whose last block has been passed
+    if (meta.fecScheme != FEC_NONE)
+    {
+        size_t groups = n == (int)meta.totalBlocks ? (size_t)((n + meta.fecGroupSize - 1) / meta.fecGroupSize) : (size_t)(n / meta.fecGroupSize);
+        parityEnd = groups * meta.fecParityCount;
+    }
+    return true;
+}
+
+
+// Function Name: ProcessAcks
+// Function Description:
+//      -- The MetaPacket is delivered once any copy of it is acked; if that was not the first copy, the blocks
+//      -- sent behind the first one arrived before the receiver knew the file and are sent again.
+void OutgoingStream::ProcessAcks(const unsigned int* acks, int count, uint64_t now)
+{
+    for (int i = 0; i < count && !metaConfirmed; ++i)
+    {
+        vector<unsigned int>::iterator copy = find(metaSequences.begin(), metaSequences.end(), acks[i]);
+        if (copy != metaSequences.end())
+        {
+            metaConfirmed = true;
+            metaRewind = copy != metaSequences.begin();
+            LOG_DEBUG("MetaPacket of %s acked after %.1f ms", fileName, NsToSeconds(now - metaSentAt) * 1000.0);
+        }
+    }
+}
@@ -0,0 +1,109 @@
+// File Name: TransferStream.h
+// Date: 2026-10
+// File Description:
+//      -- Per-file send and receive state of a transfer (OutgoingStream / IncomingStream). Everything a file
+//      -- needs between two send ticks lives in these objects, so any number of transfers can run in one
+//      -- process: side by side on one connection (one stream each), or on connections of their own.
+
+#ifndef _TRANSFER_STREAM_H_
+#define _TRANSFER_STREAM_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Net.h"
+#include "FileProcess.h"
+
+const float ReplyTimeOut = 2.0f;        // how long the sender waits for the receiver's Resume/Signature packets
+const int InitialWindow = 32;           // blocks the sender streams before the receiver has acked the MetaPacket
+const float MetaRepeatInterval = 0.5f;  // how often an unacked MetaPacket is sent again once the initial window is used up
+const float AckKeepAlive = 1.0f;        // receiver: seconds without sending after which an ack-only datagram keeps the connection alive
+const uint16_t HeartbeatStream = 0xFFFE; // sender: stream of the zero packets of idle ticks, above every transfer group's streams and below MessageStream
+
+
+// Class Name: OutgoingStream
+// Class Description:
+//      -- Send side of one file. Every file of a run is its own stream on the connection; the streams take turns
+//      -- for the send ticks, so one that is waiting for the receiver (resume, delta signatures, MetaPacket ack)
+//      -- or whose packets are lost never holds up the others.
+class OutgoingStream
+{
+public:
+
+    OutgoingStream(uint16_t id, const char* fileName);
+
+    // A parallel flow of primary: sends the blocks [first, end) of the same loaded file and their parity, but no
+    // MetaPacket; only started once primary is Streaming
+    OutgoingStream(OutgoingStream& primary, uint64_t first, uint64_t end);
+
+    // Restricts the stream to the blocks [first, end) and the parity of their FEC groups (first starts a group)
+    void SetRange(uint64_t first, uint64_t end);
+
+    // Queues the blocks [first, end) of a flow that failed, sent after the stream's own range
+    void TakeOver(uint64_t first, uint64_t end);
+
+    // True once the receiver knows the file and any resume negotiation is over, so other flows may send its blocks
+    bool Streaming() const;
+
+    // Fills in the next packet of the stream (meta, parity or block; a zero-copy block as header, payload and
+    // padding segments) and returns true, or returns false if the stream has nothing to send at time now.
+    // sequence is the reliable sequence the packet will be sent with; MetaPackets are only sent on the
+    // primary path (whose acks ProcessAcks sees), other paths get nothing until the stream's next block.
+    bool NextPacket(uint64_t now, bool primary, unsigned int sequence, unsigned char* packet, net::PacketSegment* segments, int& segmentCount);
+
+    // The MetaPacket is delivered once any copy of it is acked; if that was not the first copy, the blocks
+    // sent behind the first one arrived before the receiver knew the file and are sent again.
+    void ProcessAcks(const unsigned int* acks, int count, uint64_t now);
+
+    uint16_t id;
+    const char* fileName;
+    std::unique_ptr<FileBlock> ownedFile; // the loaded file, unless this stream is a parallel flow of another one
+    FileBlock& fileBlock;
+    bool resume = false;    // wait for the receiver's ResumePackets before the blocks
+    bool zeroCopy = false;  // send block payloads straight from the mapped file
+    bool finished = false;  // every packet of the file has been sent
+    std::atomic<uint64_t> sentBlocks{ 0 }; // blocks sent so far (a parallel flow's are read by the session thread)
+    uint64_t resentPackets = 0; // MetaPacket copies sent because the first was not acked, and blocks / parity sent again after it was lost
+
+private:
+
+    bool metaSent = false; // metaSent flags if metadata has been sent
+    int n = 0; // n indicates current index of blocks
+    int blocksEnd = 0; // blocks before this one have been sent at least once
+    size_t parityDone = 0; // parity packets before this one have been sent at least once
+    size_t parityNext = 0; // next parity packet to send
+    size_t parityEnd = 0; // parity packets released so far (a group's parity follows its last block)
+    uint64_t firstBlock = 0; // range of blocks the stream sends (a parallel flow sends a share of the file)
+    uint64_t endBlock = UINT64_MAX;
+    std::vector<std::pair<uint64_t, uint64_t>> ranges; // ranges of failed flows taken over after this one
+    uint64_t resumeStart = 0; // when the sender started waiting for the receiver's ResumePackets
+    bool resumeGaveUp = false; // no ResumePackets within ReplyTimeOut
+    uint64_t lastSignature = 0; // when the last new SignaturePacket from the receiver was seen
+    size_t signaturesSeen = 0; // signatures counted at lastSignature
+
+    // 0-RTT start: the MetaPacket is the stream's first packet and the blocks follow without waiting for the
+    // server's reply; past InitialWindow blocks the stream waits until one copy of the MetaPacket has been acked
+    std::vector<unsigned int> metaSequences; // reliable sequence of every MetaPacket copy sent before the ack
+    bool metaConfirmed = false;
+    bool metaRewind = false; // the first copy was lost: send the initial window again
+    uint64_t metaSentAt = 0;
+};
+
+
+// Class Name: IncomingStream
+// Class Description: Receive side of one stream: its own reassembly buffer and timing
+class IncomingStream
+{
+public:
+
+    FileBlock fileBlock;
+    uint64_t startTime = 0; // Timmer that calculate transmission time and rate
+    bool timingStarted = false;
+    bool saved = false;     // verified and written to disk
+    bool failed = false;    // the checksum did not match
+};
+
+#endif // !_TRANSFER_STREAM_H_
@@ -0,0 +1,199 @@
+// File Name: TraceConvert.cpp
+// Date: 2026-10
+// File Description:
+//      -- Converts a binary event trace written with ReliableUDP --trace into a Chrome trace (open it in
+//      -- chrome://tracing or ui.perfetto.dev) or a CSV file with one event per line.
+//      -- The Chrome trace shows packets as instant events, disk reads / writes as slices, and RTT, packets
+//      -- in flight, send rate and flow control mode as counters.
+//      -- Usage: TraceConvert <trace.bin> <out.json|out.csv>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Trace.h"
+
+using namespace std;
+
+
+// Function Name: EventName
+// Return Value: const char* - name of an event type as used in both output formats
+static const char* EventName(uint8_t type)
+{
+    switch (type)
+    {
+    case TRACE_PACKET_SENT:     return "sent";
+    case TRACE_PACKET_RECEIVED: return "received";
+    case TRACE_PACKET_ACKED:    return "acked";
+    case TRACE_PACKET_LOST:     return "lost";
+    case TRACE_FLOW_MODE:       return "flow_mode";
+    case TRACE_SEND_RATE:       return "send_rate";
+    case TRACE_DISK_READ:       return "disk_read";
+    case TRACE_DISK_WRITE:      return "disk_write";
+    case TRACE_DROPPED:         return "dropped";
+    default:                    return "unknown";
+    }
+}
+
+
+// Function Name: ReadTrace
+// Function Description: Reads the header and every event, sorted by time
+// Return Value: int - 0 on success, -1 if the file is missing or is not a trace
+static int ReadTrace(const char* path, TraceFileHeader& header, vector<TraceEvent>& events)
+{
+#pragma warning(suppress : 4996)
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Cannot open trace: %s\n", path);
+        return -1;
+    }
+
+    unsigned char raw[TraceEventLayout::size > TraceFileHeaderLayout::size ? TraceEventLayout::size : TraceFileHeaderLayout::size];
+    if (fread(raw, 1, TraceFileHeaderLayout::size, file) != TraceFileHeaderLayout::size)
+    {
+        fprintf(stderr, "Trace is empty: %s\n", path);
+        fclose(file);
+        return -1;
+    }
+    TraceFileHeaderLayout::Decode(header, raw);
+    if (header.magic != TRACE_MAGIC || header.version != TRACE_VERSION || header.eventSize != TraceEventLayout::size)
+    {
+        fprintf(stderr, "Not a version %d trace file: %s\n", TRACE_VERSION, path);
+        fclose(file);
+        return -1;
+    }
+
+    while (fread(raw, 1, TraceEventLayout::size, file) == TraceEventLayout::size)
+    {
+        TraceEvent event;
+        TraceEventLayout::Decode(event, raw);
+        events.push_back(event);
+    }
+    fclose(file);
+
+    stable_sort(events.begin(), events.end(), [](const TraceEvent& a, const TraceEvent& b) { return a.time < b.time; });
+    return 0;
+}
+
+
+// Function Name: WriteCsv
+// Function Description: time_ns,thread,event,id,value
+static void WriteCsv(FILE* out, const vector<TraceEvent>& events)
+{
+    fprintf(out, "time_ns,thread,event,id,value\n");
+    for (const TraceEvent& event : events)
+        fprintf(out, "%llu,%d,%s,%llu,%llu\n", (unsigned long long)event.time, event.thread, EventName(event.type),
+            (unsigned long long)event.id, (unsigned long long)event.value);
+}
+
+
+// Function Name: WriteChrome
+// Function Description: Chrome trace event format, timestamps in microseconds
+static void WriteChrome(FILE* out, const TraceFileHeader& header, const vector<TraceEvent>& events)
+{
+    fprintf(out, "{\"otherData\":{\"startUnixNs\":%llu},\"traceEvents\":[\n", (unsigned long long)header.startUnixNs);
+    fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"ReliableUDP\"}}");
+
+    long long inFlight = 0;
+    for (const TraceEvent& event : events)
+    {
+        const double ts = event.time / 1000.0;
+        const char* name = EventName(event.type);
+        const unsigned long long id = (unsigned long long)event.id;
+        const unsigned long long value = (unsigned long long)event.value;
+
+        switch (event.type)
+        {
+        case TRACE_PACKET_SENT:
+        case TRACE_PACKET_RECEIVED:
+            fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"packet\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"seq\":%llu,\"bytes\":%llu}}",
+                name, ts, event.thread, id, value);
+            break;
+
+        case TRACE_PACKET_ACKED:
+            fprintf(out, ",\n{\"name\":\"acked\",\"cat\":\"packet\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"seq\":%llu,\"rtt_ms\":%.3f}}",
+                ts, event.thread, id, value / 1e6);
+            fprintf(out, ",\n{\"name\":\"rtt_ms\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{\"sample\":%.3f}}", ts, value / 1e6);
+            break;
+
+        case TRACE_PACKET_LOST:
+            fprintf(out, ",\n{\"name\":\"lost\",\"cat\":\"packet\",\"ph\":\"i\",\"s\":\"p\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"seq\":%llu}}",
+                ts, event.thread, id);
+            break;
+
+        case TRACE_FLOW_MODE:
+            fprintf(out, ",\n{\"name\":\"flow_mode\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{\"good\":%llu}}", ts, id);
+            fprintf(out, ",\n{\"name\":\"penalty_s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{\"penalty\":%.3f}}", ts, value / 1e3);
+            break;
+
+        case TRACE_SEND_RATE:
+            fprintf(out, ",\n{\"name\":\"send_rate\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{\"pps\":%llu}}", ts, value);
+            break;
+
+        case TRACE_DISK_READ:
+        case TRACE_DISK_WRITE:
+            fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"disk\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"bytes\":%llu}}",
+                name, ts, value / 1000.0, event.thread, id);
+            break;
+
+        case TRACE_DROPPED:
+            fprintf(out, ",\n{\"name\":\"dropped_events\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"pid\":1,\"tid\":0,\"args\":{\"count\":%llu}}", ts, value);
+            break;
+        }
+
+        // packets in flight as seen by the sender
+        if (event.type == TRACE_PACKET_SENT || event.type == TRACE_PACKET_ACKED || event.type == TRACE_PACKET_LOST)
+        {
+            inFlight += event.type == TRACE_PACKET_SENT ? 1 : -1;
+            fprintf(out, ",\n{\"name\":\"in_flight\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{\"packets\":%lld}}", ts, inFlight);
+        }
+    }
+
+    fprintf(out, "\n]}\n");
+}
+
+
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: %s <trace.bin> <out.json|out.csv>\n", argv[0]);
+        return 1;
+    }
+
+    TraceFileHeader header;
+    vector<TraceEvent> events;
+    if (ReadTrace(argv[1], header, events) != 0)
+        return 1;
+
+#pragma warning(suppress : 4996)
+    FILE* out = fopen(argv[2], "w");
+    if (!out)
+    {
+        fprintf(stderr, "Cannot create %s\n", argv[2]);
+        return 1;
+    }
+
+    const string outPath = argv[2];
+    const bool csv = outPath.size() >= 4 && outPath.compare(outPath.size() - 4, 4, ".csv") == 0;
+    if (csv)
+        WriteCsv(out, events);
+    else
+        WriteChrome(out, header, events);
+    fclose(out);
+
+    size_t counts[TRACE_DROPPED + 1] = { 0 };
+    for (const TraceEvent& event : events)
+    {
+        if (event.type <= TRACE_DROPPED)
+            counts[event.type]++;
+    }
+    printf("%zu events: %zu sent, %zu received, %zu acked, %zu lost, %zu disk reads, %zu disk writes\n", events.size(),
+        counts[TRACE_PACKET_SENT], counts[TRACE_PACKET_RECEIVED], counts[TRACE_PACKET_ACKED], counts[TRACE_PACKET_LOST],
+        counts[TRACE_DISK_READ], counts[TRACE_DISK_WRITE]);
+    return 0;
+}